@@ -0,0 +1,233 @@
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <nil/crypto3/algebra/curves/bls12.hpp>
+#include <nil/crypto3/algebra/fields/bls12/base_field.hpp>
+#include <nil/crypto3/algebra/fields/bls12/scalar_field.hpp>
+#include <nil/crypto3/algebra/fields/arithmetic_params/bls12.hpp>
+#include <nil/crypto3/algebra/curves/params/multiexp/bls12.hpp>
+#include <nil/crypto3/algebra/curves/params/wnaf/bls12.hpp>
+#include <nil/crypto3/algebra/pairing/bls12.hpp>
+
+#include <nil/crypto3/zk/snark/schemes/ppzksnark/r1cs_gg_ppzksnark.hpp>
+#include <nil/crypto3/zk/snark/schemes/ppzksnark/r1cs_gg_ppzksnark/marshalling.hpp>
+
+#include "detail/groth16_setup.hpp"
+#include "detail/multiscore_component.hpp"
+#include "detail/r1cs_examples.hpp"
+#include "prover.hpp"
+#include "verifier.hpp"
+
+// Scaling benchmark: sweeps synthetic R1CS examples over constraint and input counts, optionally
+// followed by every multiscore circuit variant, and writes one JSON record per point.
+
+struct bench_result {
+    std::string scenario;
+    std::size_t constraints = 0;
+    std::size_t inputs = 0;
+    std::size_t variables = 0;
+    std::size_t domain_size = 0;
+    double setup_ms = 0;
+    double witness_ms = 0;
+    double prove_ms = 0;
+    double verify_ms = 0;
+    std::size_t proving_key_bytes = 0;
+    std::size_t mapped_proving_key_bytes = 0;
+    std::size_t verification_key_bytes = 0;
+    std::size_t proof_bytes = 0;
+    std::size_t peak_rss_kb = 0;
+    bool verified = false;
+};
+
+// Linux lets a process reset its peak RSS by writing 5 to clear_refs, which makes the peak per
+// point; elsewhere the figure is the peak of the whole run so far. peak_rss_kb is in metrics.hpp.
+void reset_peak_rss() {
+    boost::filesystem::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+template<typename Function>
+double mean_ms(std::size_t repeat, Function f) {
+    auto started = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < repeat; ++i) {
+        f();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count() / repeat;
+}
+
+bench_result run_point(const std::string &scenario,
+                       const r1cs_constraint_system<field_type> &constraint_system,
+                       const r1cs_primary_input<field_type> &primary_input,
+                       const r1cs_auxiliary_input<field_type> &auxiliary_input,
+                       std::size_t repeat) {
+    bench_result result;
+    result.scenario = scenario;
+    result.constraints = constraint_system.num_constraints();
+    result.inputs = constraint_system.num_inputs();
+    result.variables = constraint_system.num_variables();
+
+    reset_peak_rss();
+
+    auto setup_started = std::chrono::steady_clock::now();
+    scheme_type::keypair_type keypair = groth16_setup(constraint_system);
+    result.setup_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setup_started).count();
+    result.domain_size = keypair.first.H_query.size() + 1;
+
+    result.proving_key_bytes = serializer_tvm::process(keypair.first).size();
+    result.verification_key_bytes = verification_key_to_byteblob(keypair.second).size();
+
+    boost::filesystem::path mapped_path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("bench-%%%%-%%%%.pk");
+    write_proving_key_file(mapped_path, keypair.first, false, circuit_digest(constraint_system));
+    result.mapped_proving_key_bytes = boost::filesystem::file_size(mapped_path);
+    boost::filesystem::remove(mapped_path);
+
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    const groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+
+    scheme_type::proof_type proof;
+    result.prove_ms = mean_ms(repeat, [&]() {
+        proof = groth16_prove(key, constraint_system, primary_input, auxiliary_input);
+    });
+    result.proof_bytes = proof_to_byteblob(proof).size();
+
+    const prepared_verification_key prepared = prepare_verification_key(keypair.second);
+    result.verify_ms = mean_ms(repeat, [&]() { result.verified = verify_proof(prepared, primary_input, proof); });
+
+    result.peak_rss_kb = peak_rss_kb();
+    return result;
+}
+
+bench_result run_multiscore(const std::string &variant, std::size_t repeat) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+    multiscore_widths widths;
+    parse_circuit_variant(variant, widths);
+    const std::string pa_data_hash = field_element_to_hex(multiscore_commitment_hash(widths, pa_id, pa_income));
+    const std::string fi_data_hash =
+        field_element_to_hex(multiscore_commitment_hash(widths, fi_overdue_loans, fi_account_age));
+    const multiscore_circuit<field_type> circuit(widths);
+    multiscore_witness<field_type> witness(circuit);
+    double witness_ms = mean_ms(repeat, [&]() {
+        witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash,
+                                      fi_data_hash);
+    });
+
+    bench_result result = run_point("multiscore-" + variant, circuit.constraint_system, witness.primary_input(),
+                                    witness.auxiliary_input(), repeat);
+    result.witness_ms = witness_ms;
+    return result;
+}
+
+void write_json(std::ostream &os, const std::vector<bench_result> &results, std::size_t threads) {
+    os << "{\n  \"threads\": " << resolve_threads(threads) << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const bench_result &r = results[i];
+        os << (i ? "," : "") << "\n    {"
+           << "\"scenario\": \"" << r.scenario << "\", "
+           << "\"constraints\": " << r.constraints << ", "
+           << "\"inputs\": " << r.inputs << ", "
+           << "\"variables\": " << r.variables << ", "
+           << "\"domain_size\": " << r.domain_size << ", "
+           << "\"setup_ms\": " << r.setup_ms << ", "
+           << "\"witness_ms\": " << r.witness_ms << ", "
+           << "\"prove_ms\": " << r.prove_ms << ", "
+           << "\"verify_ms\": " << r.verify_ms << ", "
+           << "\"proving_key_bytes\": " << r.proving_key_bytes << ", "
+           << "\"mapped_proving_key_bytes\": " << r.mapped_proving_key_bytes << ", "
+           << "\"verification_key_bytes\": " << r.verification_key_bytes << ", "
+           << "\"proof_bytes\": " << r.proof_bytes << ", "
+           << "\"peak_rss_kb\": " << r.peak_rss_kb << ", "
+           << "\"verified\": " << (r.verified ? "true" : "false") << "}";
+    }
+    os << "\n  ]\n}" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t min_log, max_log, repeat, threads;
+    std::vector<std::size_t> input_counts;
+    std::string example, output, scenario;
+
+    boost::program_options::options_description options("Groth16 scaling benchmark");
+    options.add_options()
+    ("help", "Display help message")
+    ("min-log", boost::program_options::value<std::size_t>(&min_log)->default_value(10),
+        "Smallest sweep point is a QAP domain of 2^min-log points")
+    ("max-log", boost::program_options::value<std::size_t>(&max_log)->default_value(20),
+        "Largest sweep point is a QAP domain of 2^max-log points")
+    ("inputs", boost::program_options::value<std::vector<std::size_t>>(&input_counts)->multitoken()
+        ->default_value(std::vector<std::size_t> {1, 64}, "1 64"),
+        "Primary input counts swept at every constraint count")
+    ("example", boost::program_options::value<std::string>(&example)->default_value("field"),
+        "Synthetic R1CS example: field or binary inputs")
+    ("scenario", boost::program_options::value<std::string>(&scenario)->default_value("all"),
+        "sweep, multiscore or all")
+    ("repeat", boost::program_options::value<std::size_t>(&repeat)->default_value(3),
+        "Proofs and verifications averaged per point")
+    ("threads", boost::program_options::value<std::size_t>(&threads)->default_value(0),
+        "Worker threads, 0 for one per core")
+    ("output,o", boost::program_options::value<std::string>(&output)->default_value("bench.json"),
+        "JSON results file");
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(options).run(), vm);
+    boost::program_options::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << options << std::endl;
+        return 0;
+    }
+    if ((example != "field" && example != "binary") ||
+        (scenario != "sweep" && scenario != "multiscore" && scenario != "all") || repeat == 0) {
+        std::cout << options << std::endl;
+        return 1;
+    }
+    worker_threads = threads;
+
+    std::vector<bench_result> results;
+    if (scenario != "multiscore") {
+        for (std::size_t log = min_log; log <= max_log; ++log) {
+            for (std::size_t inputs : input_counts) {
+                // The QAP domain holds one point per constraint and per input plus one, so this many
+                // constraints keep it at 2^log; the result reports the constraints actually proved
+                const std::size_t domain_size = std::size_t(1) << log;
+                if (inputs == 0 || inputs + 2 > domain_size) {
+                    continue;
+                }
+                const std::size_t constraints = domain_size - inputs - 1;
+                if (example == "field" && inputs > constraints + 2) {
+                    continue;
+                }
+                std::cout << "2^" << log << " domain, " << constraints << " constraints, " << inputs << " inputs..."
+                          << std::endl;
+
+                r1cs_example<field_type> r1cs = example == "field" ?
+                                                    generate_r1cs_example_with_field_input<field_type>(constraints, inputs) :
+                                                    generate_r1cs_example_with_binary_input<field_type>(constraints, inputs);
+                pad_to_radix2_domain(r1cs.constraint_system);
+
+                results.push_back(run_point(example, r1cs.constraint_system, r1cs.primary_input,
+                                            r1cs.auxiliary_input, repeat));
+            }
+        }
+    }
+    if (scenario != "sweep") {
+        for (const std::string variant : {"wide", "compact", "poseidon"}) {
+            std::cout << "multiscore, " << variant << " circuit..." << std::endl;
+            results.push_back(run_multiscore(variant, repeat));
+        }
+    }
+
+    boost::filesystem::ofstream stream(output);
+    write_json(stream, results, threads);
+    std::cout << "Results are saved to " << output << std::endl;
+
+    for (const bench_result &r : results) {
+        if (!r.verified) {
+            std::cout << "Proof of " << r.scenario << " with " << r.constraints << " constraints does not verify"
+                      << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1147 @@
+#ifndef CLI_AGGREGATION_HPP
+#define CLI_AGGREGATION_HPP
+
+#include <array>
+#include <chrono>
+#include <cstring>
+
+#include <nil/crypto3/algebra/random_element.hpp>
+#include <nil/crypto3/hash/algorithm/hash.hpp>
+#include <nil/crypto3/hash/sha2.hpp>
+
+#include "verifier.hpp"
+#include "detail/groth16_setup.hpp"
+#include "detail/multiexp.hpp"
+
+// Aggregation of Groth16 proofs of one verification key after SnarkPack
+// (https://eprint.iacr.org/2021/529). With r drawn from a transcript of the proofs' commitments and
+// primary inputs, the n Groth16 equations raised to r^i and multiplied together read
+//
+//   Z_AB = prod e(A_i, r^i B_i) = e(alpha, beta)^(sum r^i) * e(sum r^i acc_i, gamma) * e(Z_C, delta)
+//
+// with Z_C = sum r^i C_i. The aggregate carries Z_AB and Z_C and shows them right for committed A,
+// B and C: a TIPP argument for Z_AB and a MIPP argument for Z_C, run in one GIPA recursion that
+// halves the vectors every round, and KZG openings for the commitment keys the recursion ends with.
+// The proof has O(log n) elements and is checked with O(log n) GT exponentiations and a constant
+// number of pairings; only folding the primary inputs into one stays linear in n.
+//
+// The commitment keys come from two powers of tau, a and b:
+//
+//   v_i = (a^i H, b^i H), w_i = (a^(n+i) G, b^(n+i) G), i < n
+//
+// A G1 vector X is committed as (prod e(X_i, v_i.alpha), prod e(X_i, v_i.beta)) and a G2 vector Y
+// as (prod e(w_i.alpha, Y_i), prod e(w_i.beta, Y_i)). A, B is committed as the product of both.
+
+typedef std::array<gt_value_type, 2> gt_pair;
+
+constexpr const std::size_t gt_bytes = 12 * fp_bytes;
+
+// The twelve base field coefficients of a GT element, big-endian like the points
+void gt_to_bytes(const gt_value_type &x, unsigned char *out) {
+    for (std::size_t i = 0; i < 2; ++i) {
+        for (std::size_t j = 0; j < 3; ++j) {
+            for (std::size_t k = 0; k < 2; ++k) {
+                fp_to_bytes(x.data[i].data[j].data[k], out + ((i * 3 + j) * 2 + k) * fp_bytes);
+            }
+        }
+    }
+}
+
+bool gt_from_bytes(const unsigned char *in, gt_value_type &x) {
+    for (std::size_t i = 0; i < 2; ++i) {
+        for (std::size_t j = 0; j < 3; ++j) {
+            fp_value_type c0, c1;
+            if (!fp_from_bytes(in + (i * 3 + j) * 2 * fp_bytes, c0) ||
+                !fp_from_bytes(in + ((i * 3 + j) * 2 + 1) * fp_bytes, c1)) {
+                return false;
+            }
+            x.data[i].data[j] = fp2_value_type(c0, c1);
+        }
+    }
+    return true;
+}
+
+template<typename PointType>
+PointType affine_point(PointType point) {
+    batch_to_affine(&point, 1);
+    return point;
+}
+
+// Proofs are padded to a power of two by repeating the last one, at least two of them
+std::size_t aggregation_padded_count(std::size_t count) {
+    std::size_t padded = 2;
+    while (padded < count) {
+        padded *= 2;
+    }
+    return padded;
+}
+
+// Structured reference string for up to max_proofs() proofs, a power of two: a^i G and b^i G for
+// i < 2 max_proofs(), a^i H and b^i H for i < max_proofs(). It comes from a local setup like the
+// Groth16 keys, so whoever ran it knows a and b and could forge aggregates.
+struct aggregation_srs {
+    std::vector<g1_value_type> g_alpha_powers, g_beta_powers;
+    std::vector<g2_value_type> h_alpha_powers, h_beta_powers;
+
+    std::size_t max_proofs() const {
+        return h_alpha_powers.size();
+    }
+};
+
+// The part of the SRS the verifier needs
+struct aggregation_verifier_srs {
+    std::uint64_t max_proofs = 0;
+    g1_value_type g, g_alpha, g_beta;
+    g2_value_type h, h_alpha, h_beta;
+};
+
+aggregation_verifier_srs aggregation_verifier_key(const aggregation_srs &srs) {
+    aggregation_verifier_srs verifier_srs;
+    verifier_srs.max_proofs = srs.max_proofs();
+    verifier_srs.g = srs.g_alpha_powers[0];
+    verifier_srs.g_alpha = srs.g_alpha_powers[1];
+    verifier_srs.g_beta = srs.g_beta_powers[1];
+    verifier_srs.h = srs.h_alpha_powers[0];
+    verifier_srs.h_alpha = srs.h_alpha_powers[1];
+    verifier_srs.h_beta = srs.h_beta_powers[1];
+    return verifier_srs;
+}
+
+std::vector<value_type> scalar_powers(const value_type &base, std::size_t count) {
+    std::vector<value_type> powers(count);
+    value_type power = value_type::one();
+    for (value_type &p : powers) {
+        p = power;
+        power = power * base;
+    }
+    return powers;
+}
+
+std::vector<scalar_limbs> to_scalar_limbs(const value_type *scalars, std::size_t count) {
+    std::vector<scalar_limbs> limbs(count);
+    parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            limbs[i] = to_scalar_limbs(scalars[i]);
+        }
+    });
+    return limbs;
+}
+
+// The powers on the fixed-base tables of groth16_setup
+aggregation_srs aggregation_setup(std::size_t max_proofs, std::size_t threads = worker_threads) {
+    scoped_timer timer("aggregation_setup");
+    max_proofs = aggregation_padded_count(max_proofs);
+
+    const std::vector<value_type> a_powers = scalar_powers(algebra::random_element<field_type>(), 2 * max_proofs);
+    const std::vector<value_type> b_powers = scalar_powers(algebra::random_element<field_type>(), 2 * max_proofs);
+
+    const g1_value_type g = algebra::random_element<typename curve_type::g1_type>();
+    const g2_value_type h = algebra::random_element<typename curve_type::g2_type>();
+    const fixed_base_table<g1_value_type> g1_table(g, fixed_base_table<g1_value_type>::window_size(4 * max_proofs),
+                                                   threads);
+    const fixed_base_table<g2_value_type> g2_table(h, fixed_base_table<g2_value_type>::window_size(2 * max_proofs),
+                                                   threads);
+
+    aggregation_srs srs;
+    srs.g_alpha_powers = fixed_base_batch(g1_table, a_powers, threads);
+    srs.g_beta_powers = fixed_base_batch(g1_table, b_powers, threads);
+    srs.h_alpha_powers = fixed_base_batch(
+        g2_table, std::vector<value_type>(a_powers.begin(), a_powers.begin() + max_proofs), threads);
+    srs.h_beta_powers = fixed_base_batch(
+        g2_table, std::vector<value_type>(b_powers.begin(), b_powers.begin() + max_proofs), threads);
+    return srs;
+}
+
+// Fiat-Shamir transcript: every challenge is SHA-256 over the previous one and the canonical
+// encodings of everything appended since, cut to 254 bits
+class aggregation_transcript {
+  public:
+    aggregation_transcript() {
+        const std::string domain = "multiscore-snarkpack-v1";
+        pending.assign(domain.begin(), domain.end());
+    }
+
+    void append(std::uint64_t value) {
+        for (std::size_t i = 0; i < 8; ++i) {
+            pending.push_back(unit_type(value >> (8 * i)));
+        }
+    }
+
+    void append(const std::vector<unit_type> &bytes) {
+        append(std::uint64_t(bytes.size()));
+        pending.insert(pending.end(), bytes.begin(), bytes.end());
+    }
+
+    void append(const value_type &x) {
+        std::vector<unit_type> bytes;
+        nil::crypto3::multiprecision::export_bits(typename field_type::integral_type(x.data),
+                                                  std::back_inserter(bytes), 8);
+        pending.insert(pending.end(), 32 - bytes.size(), 0);
+        pending.insert(pending.end(), bytes.begin(), bytes.end());
+    }
+
+    void append(const g1_value_type &point) {
+        std::array<unit_type, compressed_g1_size> bytes;
+        compress_g1(affine_point(point), bytes.data());
+        pending.insert(pending.end(), bytes.begin(), bytes.end());
+    }
+
+    void append(const g2_value_type &point) {
+        std::array<unit_type, compressed_g2_size> bytes;
+        compress_g2(affine_point(point), bytes.data());
+        pending.insert(pending.end(), bytes.begin(), bytes.end());
+    }
+
+    void append(const gt_value_type &x) {
+        std::array<unit_type, gt_bytes> bytes;
+        gt_to_bytes(x, bytes.data());
+        pending.insert(pending.end(), bytes.begin(), bytes.end());
+    }
+
+    void append(const gt_pair &pair) {
+        append(pair[0]);
+        append(pair[1]);
+    }
+
+    // Nonzero; the digest becomes the start of the next block
+    value_type challenge() {
+        for (;;) {
+            const std::string hex =
+                nil::crypto3::hash<nil::crypto3::hashes::sha2<256>>(pending.begin(), pending.end());
+            pending.clear();
+            boost::algorithm::unhex(hex, std::back_inserter(pending));
+
+            std::vector<unit_type> bytes = pending;
+            bytes[0] &= 0x3f;
+            typename field_type::integral_type value;
+            nil::crypto3::multiprecision::import_bits(value, bytes.begin(), bytes.end(), 8);
+            if (value != 0) {
+                return value_type(value);
+            }
+        }
+    }
+
+  private:
+    std::vector<unit_type> pending;
+};
+
+// What the aggregate is about: the verification key and every primary input, in order
+void append_aggregation_statement(aggregation_transcript &transcript,
+                                  const typename scheme_type::verification_key_type &verification_key,
+                                  const std::vector<typename scheme_type::primary_input_type> &primary_inputs) {
+    transcript.append(verification_key_to_byteblob(verification_key));
+    transcript.append(std::uint64_t(primary_inputs.size()));
+    for (const typename scheme_type::primary_input_type &primary_input : primary_inputs) {
+        transcript.append(std::uint64_t(primary_input.size()));
+        for (const value_type &x : primary_input) {
+            transcript.append(x);
+        }
+    }
+}
+
+// One GIPA round on vectors of size 2s: the cross terms of the left half of one vector with the
+// right half of the other, which the verifier folds into the commitments and inner products with
+// the round challenge x (left terms) and x^-1 (right terms)
+struct aggregation_round {
+    gt_pair tab_left, tab_right;    // commitments to (A, B)
+    gt_value_type zab_left, zab_right;    // prod e(A, B)
+    gt_pair tc_left, tc_right;    // commitments to C
+    g1_value_type zc_left, zc_right;    // sum r^i C
+};
+
+struct aggregate_proof {
+    std::uint64_t count = 0;    // proofs aggregated, before padding
+    gt_pair com_ab, com_c;
+    gt_value_type ip_ab;
+    g1_value_type agg_c;
+    std::vector<aggregation_round> rounds;
+
+    // What the recursion ends with and the KZG openings of the final keys at z
+    g1_value_type final_A, final_C;
+    g2_value_type final_B;
+    std::array<g2_value_type, 2> final_v, v_opening;
+    std::array<g1_value_type, 2> final_w, w_opening;
+};
+
+// prod of the K Miller loop products terms(i, products) adds for i < count, each final
+// exponentiated once. The indices are split over threads with a partial product each.
+template<std::size_t K, typename Terms>
+std::array<gt_value_type, K> pairing_products(std::size_t count, Terms terms, std::size_t threads) {
+    std::array<gt_value_type, K> ones;
+    ones.fill(gt_value_type::one());
+    std::vector<std::array<gt_value_type, K>> partials(resolve_threads(threads), ones);
+
+    parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        for (std::size_t i = begin; i < end; ++i) {
+            terms(i, partials[chunk]);
+        }
+    }, threads);
+
+    std::array<gt_value_type, K> products = ones;
+    for (const std::array<gt_value_type, K> &partial : partials) {
+        for (std::size_t k = 0; k < K; ++k) {
+            products[k] = products[k] * partial[k];
+        }
+    }
+    for (gt_value_type &product : products) {
+        product = pairing_policy::final_exponentiation(product);
+    }
+    return products;
+}
+
+// Coefficients of the commitment keys folded with the round challenges y, as a polynomial in the
+// power of tau: c_i = prod over the bits b of i of y[k - 1 - b] scale^(2^b), k = y.size(), since
+// round j halves at 2^(k - 1 - j). Expanded for the KZG quotient, evaluated for the verifier.
+std::vector<value_type> folded_key_coefficients(const std::vector<value_type> &y, const value_type &scale) {
+    std::vector<value_type> coefficients = {value_type::one()};
+    value_type power = scale;
+    for (std::size_t b = 0; b < y.size(); ++b) {
+        const value_type factor = y[y.size() - 1 - b] * power;
+        const std::size_t size = coefficients.size();
+        coefficients.resize(2 * size);
+        for (std::size_t i = 0; i < size; ++i) {
+            coefficients[size + i] = coefficients[i] * factor;
+        }
+        power = power.squared();
+    }
+    return coefficients;
+}
+
+value_type folded_key_evaluation(const std::vector<value_type> &y, const value_type &scale, const value_type &z) {
+    value_type result = value_type::one();
+    value_type power = scale * z;
+    for (std::size_t b = 0; b < y.size(); ++b) {
+        result = result * (value_type::one() + y[y.size() - 1 - b] * power);
+        power = power.squared();
+    }
+    return result;
+}
+
+// (f(X) - f(z)) / (X - z) by synthetic division
+std::vector<value_type> kzg_quotient(const std::vector<value_type> &f, const value_type &z) {
+    std::vector<value_type> quotient(f.size() - 1);
+    value_type carry = value_type::zero();
+    for (std::size_t i = f.size() - 1; i > 0; --i) {
+        carry = f[i] + z * carry;
+        quotient[i - 1] = carry;
+    }
+    return quotient;
+}
+
+// The opening of sum f_i tau^i P at z, powers holding tau^i P for at least the quotient's degree
+template<typename PointType>
+PointType kzg_opening(const std::vector<PointType> &powers, const std::vector<value_type> &f, const value_type &z,
+                      std::size_t threads) {
+    const std::vector<value_type> quotient = kzg_quotient(f, z);
+    const std::vector<scalar_limbs> limbs = to_scalar_limbs(quotient.data(), quotient.size());
+    return multiexp(powers.begin(), limbs.data(), limbs.size(), threads);
+}
+
+// Aggregates the proofs of the primary inputs; false if there are none or more than the SRS
+// takes. The proofs are not checked, an invalid one makes the aggregate fail verification.
+bool aggregate_proofs(const aggregation_srs &srs,
+                      const typename scheme_type::verification_key_type &verification_key,
+                      const std::vector<typename scheme_type::proof_type> &proofs,
+                      const std::vector<typename scheme_type::primary_input_type> &primary_inputs,
+                      aggregate_proof &aggregate,
+                      std::string &error,
+                      std::size_t threads = worker_threads) {
+    scoped_timer timer("aggregate");
+    const std::size_t count = proofs.size();
+    const std::size_t m = aggregation_padded_count(count);
+    if (count == 0 || count != primary_inputs.size()) {
+        error = "one primary input per proof is needed";
+        return false;
+    }
+    if (m > srs.max_proofs()) {
+        error = "the SRS aggregates up to " + std::to_string(srs.max_proofs()) + " proofs";
+        return false;
+    }
+
+    std::vector<g1_value_type> A(m), C(m);
+    std::vector<g2_value_type> B(m);
+    for (std::size_t i = 0; i < m; ++i) {
+        const typename scheme_type::proof_type &proof = proofs[std::min(i, count - 1)];
+        A[i] = proof.g_A;
+        B[i] = proof.g_B;
+        C[i] = proof.g_C;
+    }
+    std::vector<g2_value_type> v_alpha(srs.h_alpha_powers.begin(), srs.h_alpha_powers.begin() + m);
+    std::vector<g2_value_type> v_beta(srs.h_beta_powers.begin(), srs.h_beta_powers.begin() + m);
+    std::vector<g1_value_type> w_alpha(srs.g_alpha_powers.begin() + m, srs.g_alpha_powers.begin() + 2 * m);
+    std::vector<g1_value_type> w_beta(srs.g_beta_powers.begin() + m, srs.g_beta_powers.begin() + 2 * m);
+
+    aggregate = aggregate_proof();
+    aggregate.count = count;
+
+    aggregation_transcript transcript;
+    append_aggregation_statement(transcript, verification_key, primary_inputs);
+
+    const std::array<gt_value_type, 4> commitments = pairing_products<4>(
+        m,
+        [&](std::size_t i, std::array<gt_value_type, 4> &partial) {
+            const auto A_i = pairing_policy::precompute_g1(A[i]);
+            const auto B_i = pairing_policy::precompute_g2(B[i]);
+            const auto C_i = pairing_policy::precompute_g1(C[i]);
+            const auto v_alpha_i = pairing_policy::precompute_g2(v_alpha[i]);
+            const auto v_beta_i = pairing_policy::precompute_g2(v_beta[i]);
+            partial[0] = partial[0] * pairing_policy::double_miller_loop(
+                                            A_i, v_alpha_i, pairing_policy::precompute_g1(w_alpha[i]), B_i);
+            partial[1] = partial[1] * pairing_policy::double_miller_loop(
+                                            A_i, v_beta_i, pairing_policy::precompute_g1(w_beta[i]), B_i);
+            partial[2] = partial[2] * pairing_policy::miller_loop(C_i, v_alpha_i);
+            partial[3] = partial[3] * pairing_policy::miller_loop(C_i, v_beta_i);
+        },
+        threads);
+    aggregate.com_ab = {commitments[0], commitments[1]};
+    aggregate.com_c = {commitments[2], commitments[3]};
+    transcript.append(aggregate.com_ab);
+    transcript.append(aggregate.com_c);
+    const value_type r = transcript.challenge();
+    const value_type r_inverse = r.inversed();
+
+    // B and w are rescaled by r^i and r^-i, which leaves the commitment to (A, B) as it is
+    std::vector<value_type> r_powers = scalar_powers(r, m);
+    const std::vector<value_type> r_inverse_powers = scalar_powers(r_inverse, m);
+    parallel_for(m, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            B[i] = r_powers[i] * B[i];
+            w_alpha[i] = r_inverse_powers[i] * w_alpha[i];
+            w_beta[i] = r_inverse_powers[i] * w_beta[i];
+        }
+    }, threads);
+
+    aggregate.ip_ab = pairing_products<1>(
+        m,
+        [&](std::size_t i, std::array<gt_value_type, 1> &partial) {
+            partial[0] = partial[0] * pairing_policy::miller_loop(pairing_policy::precompute_g1(A[i]),
+                                                                    pairing_policy::precompute_g2(B[i]));
+        },
+        threads)[0];
+    {
+        const std::vector<scalar_limbs> limbs = to_scalar_limbs(r_powers.data(), m);
+        aggregate.agg_c = multiexp(C.begin(), limbs.data(), m, threads);
+    }
+    transcript.append(aggregate.ip_ab);
+    transcript.append(aggregate.agg_c);
+
+    std::vector<value_type> challenges, challenge_inverses;
+    for (std::size_t size = m; size > 1; size /= 2) {
+        const std::size_t s = size / 2;
+        aggregation_round round;
+
+        const std::array<gt_value_type, 10> products = pairing_products<10>(
+            s,
+            [&](std::size_t i, std::array<gt_value_type, 10> &partial) {
+                const auto A_left = pairing_policy::precompute_g1(A[i]);
+                const auto A_right = pairing_policy::precompute_g1(A[s + i]);
+                const auto B_left = pairing_policy::precompute_g2(B[i]);
+                const auto B_right = pairing_policy::precompute_g2(B[s + i]);
+                const auto C_left = pairing_policy::precompute_g1(C[i]);
+                const auto C_right = pairing_policy::precompute_g1(C[s + i]);
+                const auto v_alpha_left = pairing_policy::precompute_g2(v_alpha[i]);
+                const auto v_alpha_right = pairing_policy::precompute_g2(v_alpha[s + i]);
+                const auto v_beta_left = pairing_policy::precompute_g2(v_beta[i]);
+                const auto v_beta_right = pairing_policy::precompute_g2(v_beta[s + i]);
+
+                partial[0] = partial[0] * pairing_policy::double_miller_loop(
+                                                A_right, v_alpha_left,
+                                                pairing_policy::precompute_g1(w_alpha[s + i]), B_left);
+                partial[1] = partial[1] * pairing_policy::double_miller_loop(
+                                                A_right, v_beta_left,
+                                                pairing_policy::precompute_g1(w_beta[s + i]), B_left);
+                partial[2] = partial[2] * pairing_policy::double_miller_loop(
+                                                A_left, v_alpha_right,
+                                                pairing_policy::precompute_g1(w_alpha[i]), B_right);
+                partial[3] = partial[3] * pairing_policy::double_miller_loop(
+                                                A_left, v_beta_right,
+                                                pairing_policy::precompute_g1(w_beta[i]), B_right);
+                partial[4] = partial[4] * pairing_policy::miller_loop(A_right, B_left);
+                partial[5] = partial[5] * pairing_policy::miller_loop(A_left, B_right);
+                partial[6] = partial[6] * pairing_policy::miller_loop(C_right, v_alpha_left);
+                partial[7] = partial[7] * pairing_policy::miller_loop(C_right, v_beta_left);
+                partial[8] = partial[8] * pairing_policy::miller_loop(C_left, v_alpha_right);
+                partial[9] = partial[9] * pairing_policy::miller_loop(C_left, v_beta_right);
+            },
+            threads);
+        round.tab_left = {products[0], products[1]};
+        round.tab_right = {products[2], products[3]};
+        round.zab_left = products[4];
+        round.zab_right = products[5];
+        round.tc_left = {products[6], products[7]};
+        round.tc_right = {products[8], products[9]};
+
+        const std::vector<scalar_limbs> r_left = to_scalar_limbs(r_powers.data(), s);
+        const std::vector<scalar_limbs> r_right = to_scalar_limbs(r_powers.data() + s, s);
+        round.zc_left = multiexp(C.begin() + s, r_left.data(), s, threads);
+        round.zc_right = multiexp(C.begin(), r_right.data(), s, threads);
+
+        transcript.append(round.tab_left);
+        transcript.append(round.tab_right);
+        transcript.append(round.zab_left);
+        transcript.append(round.zab_right);
+        transcript.append(round.tc_left);
+        transcript.append(round.tc_right);
+        transcript.append(round.zc_left);
+        transcript.append(round.zc_right);
+        const value_type x = transcript.challenge();
+        const value_type x_inverse = x.inversed();
+        challenges.push_back(x);
+        challenge_inverses.push_back(x_inverse);
+        aggregate.rounds.push_back(round);
+
+        // A and C fold with x, B and r with x^-1; the keys the other way round
+        parallel_for(s, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) {
+                A[i] = A[i] + x * A[s + i];
+                B[i] = B[i] + x_inverse * B[s + i];
+                C[i] = C[i] + x * C[s + i];
+                r_powers[i] = r_powers[i] + x_inverse * r_powers[s + i];
+                v_alpha[i] = v_alpha[i] + x_inverse * v_alpha[s + i];
+                v_beta[i] = v_beta[i] + x_inverse * v_beta[s + i];
+                w_alpha[i] = w_alpha[i] + x * w_alpha[s + i];
+                w_beta[i] = w_beta[i] + x * w_beta[s + i];
+            }
+        }, threads);
+        for (auto *points : {&A, &C, &w_alpha, &w_beta}) {
+            points->resize(s);
+        }
+        for (auto *points : {&B, &v_alpha, &v_beta}) {
+            points->resize(s);
+        }
+        r_powers.resize(s);
+    }
+
+    aggregate.final_A = affine_point(A[0]);
+    aggregate.final_B = affine_point(B[0]);
+    aggregate.final_C = affine_point(C[0]);
+    aggregate.final_v = {affine_point(v_alpha[0]), affine_point(v_beta[0])};
+    aggregate.final_w = {affine_point(w_alpha[0]), affine_point(w_beta[0])};
+    transcript.append(aggregate.final_A);
+    transcript.append(aggregate.final_B);
+    transcript.append(aggregate.final_C);
+    for (std::size_t k = 0; k < 2; ++k) {
+        transcript.append(aggregate.final_v[k]);
+        transcript.append(aggregate.final_w[k]);
+    }
+    const value_type z = transcript.challenge();
+
+    // The final v is f_v(a) H and f_v(b) H; the final w is a^m f_w(a) G and b^m f_w(b) G, f_w with
+    // the r^-i of the rescaled key folded in
+    const std::vector<value_type> v_coefficients = folded_key_coefficients(challenge_inverses, value_type::one());
+    std::vector<value_type> w_coefficients(m, value_type::zero());
+    {
+        const std::vector<value_type> folded = folded_key_coefficients(challenges, r_inverse);
+        w_coefficients.insert(w_coefficients.end(), folded.begin(), folded.end());
+    }
+    aggregate.v_opening = {affine_point(kzg_opening(srs.h_alpha_powers, v_coefficients, z, threads)),
+                           affine_point(kzg_opening(srs.h_beta_powers, v_coefficients, z, threads))};
+    aggregate.w_opening = {affine_point(kzg_opening(srs.g_alpha_powers, w_coefficients, z, threads)),
+                           affine_point(kzg_opening(srs.g_beta_powers, w_coefficients, z, threads))};
+    return true;
+}
+
+bool pairing_is(const g1_value_type &p, const g2_value_type &q, const gt_value_type &expected) {
+    return pairing_policy::final_exponentiation(pairing_policy::miller_loop(pairing_policy::precompute_g1(p),
+                                                                            pairing_policy::precompute_g2(q))) ==
+           expected;
+}
+
+bool pairing_product_is(const g1_value_type &p1, const g2_value_type &q1, const g1_value_type &p2,
+                        const g2_value_type &q2, const gt_value_type &expected) {
+    return pairing_policy::final_exponentiation(pairing_policy::double_miller_loop(
+               pairing_policy::precompute_g1(p1), pairing_policy::precompute_g2(q1),
+               pairing_policy::precompute_g1(p2), pairing_policy::precompute_g2(q2))) == expected;
+}
+
+// Replays the transcript, folds the GIPA cross terms into the commitments and inner products and
+// checks them against the final vectors and keys, the keys against the SRS with the KZG openings
+// and the inner products against the Groth16 equation. primary_inputs are those of the aggregated
+// proofs, in their order.
+bool verify_aggregate_proof(const aggregation_verifier_srs &srs,
+                            const prepared_verification_key &prepared,
+                            const std::vector<typename scheme_type::primary_input_type> &primary_inputs,
+                            const aggregate_proof &aggregate) {
+    scoped_timer timer("verify_aggregate");
+    const std::size_t count = primary_inputs.size();
+    const std::size_t m = aggregation_padded_count(count);
+    if (count == 0 || aggregate.count != count || (std::size_t(1) << aggregate.rounds.size()) != m ||
+        m > srs.max_proofs) {
+        return false;
+    }
+    for (const typename scheme_type::primary_input_type &primary_input : primary_inputs) {
+        if (primary_input.size() != prepared.verification_key.gamma_ABC_g1.domain_size()) {
+            return false;
+        }
+    }
+
+    aggregation_transcript transcript;
+    append_aggregation_statement(transcript, prepared.verification_key, primary_inputs);
+    transcript.append(aggregate.com_ab);
+    transcript.append(aggregate.com_c);
+    const value_type r = transcript.challenge();
+    transcript.append(aggregate.ip_ab);
+    transcript.append(aggregate.agg_c);
+
+    gt_pair tab = aggregate.com_ab, tc = aggregate.com_c;
+    gt_value_type zab = aggregate.ip_ab;
+    g1_value_type zc = aggregate.agg_c;
+    std::vector<value_type> challenges, challenge_inverses;
+    for (const aggregation_round &round : aggregate.rounds) {
+        transcript.append(round.tab_left);
+        transcript.append(round.tab_right);
+        transcript.append(round.zab_left);
+        transcript.append(round.zab_right);
+        transcript.append(round.tc_left);
+        transcript.append(round.tc_right);
+        transcript.append(round.zc_left);
+        transcript.append(round.zc_right);
+        const value_type x = transcript.challenge();
+        const value_type x_inverse = x.inversed();
+        challenges.push_back(x);
+        challenge_inverses.push_back(x_inverse);
+
+        const typename field_type::integral_type e(x.data), e_inverse(x_inverse.data);
+        for (std::size_t k = 0; k < 2; ++k) {
+            tab[k] = tab[k] * round.tab_left[k].pow(e) * round.tab_right[k].pow(e_inverse);
+            tc[k] = tc[k] * round.tc_left[k].pow(e) * round.tc_right[k].pow(e_inverse);
+        }
+        zab = zab * round.zab_left.pow(e) * round.zab_right.pow(e_inverse);
+        zc = zc + x * round.zc_left + x_inverse * round.zc_right;
+    }
+
+    transcript.append(aggregate.final_A);
+    transcript.append(aggregate.final_B);
+    transcript.append(aggregate.final_C);
+    for (std::size_t k = 0; k < 2; ++k) {
+        transcript.append(aggregate.final_v[k]);
+        transcript.append(aggregate.final_w[k]);
+    }
+    const value_type z = transcript.challenge();
+
+    // TIPP: the folded commitments and inner product are those of the final A, B under the final keys
+    const g1_value_type &A = aggregate.final_A, &C = aggregate.final_C;
+    const g2_value_type &B = aggregate.final_B;
+    for (std::size_t k = 0; k < 2; ++k) {
+        if (!pairing_product_is(A, aggregate.final_v[k], aggregate.final_w[k], B, tab[k]) ||
+            !pairing_is(C, aggregate.final_v[k], tc[k])) {
+            return false;
+        }
+    }
+    if (!pairing_is(A, B, zab)) {
+        return false;
+    }
+
+    // MIPP: r^i folds to f_v(r) like the v key
+    if (zc != folded_key_evaluation(challenge_inverses, value_type::one(), r) * C) {
+        return false;
+    }
+
+    // The final keys are the folded SRS keys:
+    //   e(aG - zG, pi) = e(G, v - f_v(z) H) and e(w - z^m f_w(z) G, H) = e(pi, aH - zH), and for b
+    const value_type v_at_z = folded_key_evaluation(challenge_inverses, value_type::one(), z);
+    const value_type w_at_z = z.pow(m) * folded_key_evaluation(challenges, r.inversed(), z);
+    const std::array<g1_value_type, 2> g_tau = {srs.g_alpha, srs.g_beta};
+    const std::array<g2_value_type, 2> h_tau = {srs.h_alpha, srs.h_beta};
+    for (std::size_t k = 0; k < 2; ++k) {
+        if (!pairing_product_is(g_tau[k] - z * srs.g, aggregate.v_opening[k], -srs.g,
+                                aggregate.final_v[k] - v_at_z * srs.h, gt_value_type::one()) ||
+            !pairing_product_is(aggregate.final_w[k] - w_at_z * srs.g, srs.h, -aggregate.w_opening[k],
+                                h_tau[k] - z * srs.h, gt_value_type::one())) {
+            return false;
+        }
+    }
+
+    // Groth16 over the padded batch: Z_AB = e(alpha, beta)^R * e(sum r^i acc_i, gamma) * e(Z_C, delta),
+    // R = sum r^i. The inputs are folded as R * acc(sum r^i x_i / R), acc adding gamma_ABC_0 once.
+    const std::size_t num_inputs = primary_inputs[0].size();
+    std::vector<value_type> folded_input(num_inputs, value_type::zero());
+    value_type r_sum = value_type::zero(), r_power = value_type::one();
+    for (std::size_t i = 0; i < m; ++i) {
+        const typename scheme_type::primary_input_type &primary_input = primary_inputs[std::min(i, count - 1)];
+        for (std::size_t j = 0; j < num_inputs; ++j) {
+            folded_input[j] = folded_input[j] + r_power * primary_input[j];
+        }
+        r_sum = r_sum + r_power;
+        r_power = r_power * r;
+    }
+    if (r_sum.is_zero()) {
+        return false;
+    }
+    const value_type r_sum_inverse = r_sum.inversed();
+    for (value_type &x : folded_input) {
+        x = x * r_sum_inverse;
+    }
+    const g1_value_type accumulated_input =
+        r_sum * accumulate_primary_input(prepared.verification_key,
+                                         typename scheme_type::primary_input_type(folded_input));
+
+    const gt_value_type key_pairings = pairing_policy::final_exponentiation(pairing_policy::double_miller_loop(
+        pairing_policy::precompute_g1(accumulated_input), prepared.gamma_g2_precomp,
+        pairing_policy::precompute_g1(aggregate.agg_c), prepared.delta_g2_precomp));
+    return aggregate.ip_ab ==
+           prepared.alpha_g1_beta_g2.pow(typename field_type::integral_type(r_sum.data)) * key_pairings;
+}
+
+// Aggregate file: header, then com_ab, com_c, ip_ab, agg_c, every round in the field order of
+// aggregation_round, the final A, B, C, v, w and the openings of v and w. GT elements are written
+// as their twelve coefficients, points compressed.
+
+constexpr const std::array<char, 8> aggregate_proof_magic = {'M', 'S', 'C', 'O', 'R', 'E', 'A', 'G'};
+constexpr const std::uint32_t aggregate_proof_version = 1;
+
+struct aggregate_proof_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t rounds;
+    std::uint64_t count;
+};
+
+void put_element(std::vector<unit_type> &bytes, const gt_value_type &x) {
+    bytes.resize(bytes.size() + gt_bytes);
+    gt_to_bytes(x, bytes.data() + bytes.size() - gt_bytes);
+}
+
+void put_element(std::vector<unit_type> &bytes, const gt_pair &pair) {
+    put_element(bytes, pair[0]);
+    put_element(bytes, pair[1]);
+}
+
+template<typename PointType>
+void put_element(std::vector<unit_type> &bytes, const PointType &point) {
+    const std::size_t size = compressed_point_size<PointType>();
+    bytes.resize(bytes.size() + size);
+    compress_point(affine_point(point), bytes.data() + bytes.size() - size);
+}
+
+template<typename PointType, std::size_t N>
+void put_element(std::vector<unit_type> &bytes, const std::array<PointType, N> &points) {
+    for (const PointType &point : points) {
+        put_element(bytes, point);
+    }
+}
+
+// GT elements of an aggregate come from the prover too. Outside the order r subgroup they would
+// let the bytes of an aggregate vary without changing what the checks see, so x^r = 1 is required.
+bool get_element(const std::vector<unit_type> &bytes, std::size_t &position, gt_value_type &x) {
+    if (bytes.size() - position < gt_bytes || !gt_from_bytes(bytes.data() + position, x) ||
+        x.pow(typename field_type::integral_type(field_type::modulus)) != gt_value_type::one()) {
+        return false;
+    }
+    position += gt_bytes;
+    return true;
+}
+
+bool get_element(const std::vector<unit_type> &bytes, std::size_t &position, gt_pair &pair) {
+    return get_element(bytes, position, pair[0]) && get_element(bytes, position, pair[1]);
+}
+
+// Points of an aggregate come from the prover, each is checked to be in the subgroup
+template<typename PointType>
+bool get_element(const std::vector<unit_type> &bytes, std::size_t &position, PointType &point) {
+    const std::size_t size = compressed_point_size<PointType>();
+    if (bytes.size() - position < size || !decompress_point(bytes.data() + position, point) ||
+        !mul_by_integral(point, field_type::modulus).is_zero()) {
+        return false;
+    }
+    position += size;
+    return true;
+}
+
+template<typename PointType, std::size_t N>
+bool get_element(const std::vector<unit_type> &bytes, std::size_t &position, std::array<PointType, N> &points) {
+    for (PointType &point : points) {
+        if (!get_element(bytes, position, point)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<unit_type> aggregate_proof_to_byteblob(const aggregate_proof &aggregate) {
+    aggregate_proof_header header {};
+    header.magic = aggregate_proof_magic;
+    header.version = aggregate_proof_version;
+    header.rounds = aggregate.rounds.size();
+    header.count = aggregate.count;
+
+    std::vector<unit_type> bytes;
+    append_raw(bytes, &header, 1);
+    put_element(bytes, aggregate.com_ab);
+    put_element(bytes, aggregate.com_c);
+    put_element(bytes, aggregate.ip_ab);
+    put_element(bytes, aggregate.agg_c);
+    for (const aggregation_round &round : aggregate.rounds) {
+        put_element(bytes, round.tab_left);
+        put_element(bytes, round.tab_right);
+        put_element(bytes, round.zab_left);
+        put_element(bytes, round.zab_right);
+        put_element(bytes, round.tc_left);
+        put_element(bytes, round.tc_right);
+        put_element(bytes, round.zc_left);
+        put_element(bytes, round.zc_right);
+    }
+    put_element(bytes, aggregate.final_A);
+    put_element(bytes, aggregate.final_B);
+    put_element(bytes, aggregate.final_C);
+    put_element(bytes, aggregate.final_v);
+    put_element(bytes, aggregate.final_w);
+    put_element(bytes, aggregate.v_opening);
+    put_element(bytes, aggregate.w_opening);
+    return bytes;
+}
+
+bool byteblob_to_aggregate_proof(const std::vector<unit_type> &bytes, aggregate_proof &aggregate) {
+    aggregate_proof_header header;
+    std::size_t position = 0;
+    if (!read_raw(bytes, position, &header, 1) || header.magic != aggregate_proof_magic ||
+        header.version != aggregate_proof_version || header.rounds > 32) {
+        return false;
+    }
+    aggregate.count = header.count;
+    aggregate.rounds.resize(header.rounds);
+
+    bool ok = get_element(bytes, position, aggregate.com_ab) && get_element(bytes, position, aggregate.com_c) &&
+              get_element(bytes, position, aggregate.ip_ab) && get_element(bytes, position, aggregate.agg_c);
+    for (aggregation_round &round : aggregate.rounds) {
+        ok = ok && get_element(bytes, position, round.tab_left) && get_element(bytes, position, round.tab_right) &&
+             get_element(bytes, position, round.zab_left) && get_element(bytes, position, round.zab_right) &&
+             get_element(bytes, position, round.tc_left) && get_element(bytes, position, round.tc_right) &&
+             get_element(bytes, position, round.zc_left) && get_element(bytes, position, round.zc_right);
+    }
+    ok = ok && get_element(bytes, position, aggregate.final_A) && get_element(bytes, position, aggregate.final_B) &&
+         get_element(bytes, position, aggregate.final_C) && get_element(bytes, position, aggregate.final_v) &&
+         get_element(bytes, position, aggregate.final_w) && get_element(bytes, position, aggregate.v_opening) &&
+         get_element(bytes, position, aggregate.w_opening);
+    return ok && position == bytes.size();
+}
+
+// SRS file: header, the verifier part (G, aG, bG, H, aH, bH), then a^i G, b^i G, a^i H and b^i H,
+// all compressed. The verifier reads the header and its part only, each with its own CRC-32.
+
+constexpr const std::array<char, 8> aggregation_srs_magic = {'M', 'S', 'C', 'O', 'R', 'E', 'A', 'S'};
+constexpr const std::uint32_t aggregation_srs_version = 1;
+constexpr const std::size_t aggregation_verifier_srs_size = 3 * compressed_g1_size + 3 * compressed_g2_size;
+
+// Bytes of the powers for up to n proofs
+std::uint64_t aggregation_srs_powers_size(std::uint64_t n) {
+    return 4 * n * compressed_g1_size + 2 * n * compressed_g2_size;
+}
+
+struct aggregation_srs_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t verifier_checksum;
+    std::uint64_t max_proofs;
+    // CRC-32 of the powers
+    std::uint32_t checksum;
+    std::uint32_t reserved;
+};
+
+std::vector<unit_type> verifier_srs_to_bytes(const aggregation_verifier_srs &srs) {
+    std::vector<unit_type> bytes;
+    const std::array<g1_value_type, 3> g1_points = {srs.g, srs.g_alpha, srs.g_beta};
+    const std::array<g2_value_type, 3> g2_points = {srs.h, srs.h_alpha, srs.h_beta};
+    put_element(bytes, g1_points);
+    put_element(bytes, g2_points);
+    return bytes;
+}
+
+bool write_aggregation_srs(boost::filesystem::path path, const aggregation_srs &srs) {
+    scoped_timer timer("write_aggregation_srs");
+    const std::vector<unit_type> verifier_part = verifier_srs_to_bytes(aggregation_verifier_key(srs));
+    std::vector<unit_type> powers;
+    for (const std::vector<g1_value_type> *points : {&srs.g_alpha_powers, &srs.g_beta_powers}) {
+        const std::vector<unsigned char> compressed = compress_points(points->data(), points->size());
+        powers.insert(powers.end(), compressed.begin(), compressed.end());
+    }
+    for (const std::vector<g2_value_type> *points : {&srs.h_alpha_powers, &srs.h_beta_powers}) {
+        const std::vector<unsigned char> compressed = compress_points(points->data(), points->size());
+        powers.insert(powers.end(), compressed.begin(), compressed.end());
+    }
+
+    aggregation_srs_header header {};
+    header.magic = aggregation_srs_magic;
+    header.version = aggregation_srs_version;
+    header.verifier_checksum = byteblob_checksum(verifier_part);
+    header.max_proofs = srs.max_proofs();
+    header.checksum = byteblob_checksum(powers);
+
+    std::vector<unit_type> bytes;
+    append_raw(bytes, &header, 1);
+    bytes.insert(bytes.end(), verifier_part.begin(), verifier_part.end());
+    bytes.insert(bytes.end(), powers.begin(), powers.end());
+    return writefile(path, bytes);
+}
+
+bool read_aggregation_srs_header(boost::filesystem::ifstream &stream, aggregation_srs_header &header,
+                                 std::vector<unit_type> &verifier_part) {
+    verifier_part.resize(aggregation_verifier_srs_size);
+    stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+    stream.read(reinterpret_cast<char *>(verifier_part.data()), verifier_part.size());
+    return stream.good() && header.magic == aggregation_srs_magic && header.version == aggregation_srs_version &&
+           header.max_proofs >= 2 && header.max_proofs <= (std::uint64_t(1) << 32) &&
+           (header.max_proofs & (header.max_proofs - 1)) == 0 &&
+           header.verifier_checksum == byteblob_checksum(verifier_part);
+}
+
+bool read_aggregation_verifier_srs(boost::filesystem::path path, aggregation_verifier_srs &srs) {
+    boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+    aggregation_srs_header header;
+    std::vector<unit_type> verifier_part;
+    if (!read_aggregation_srs_header(stream, header, verifier_part)) {
+        std::cout << "Aggregation SRS " << path << " is missing or malformed, run --aggregation-setup first"
+                  << std::endl;
+        return false;
+    }
+    std::array<g1_value_type, 3> g1_points;
+    std::array<g2_value_type, 3> g2_points;
+    std::size_t position = 0;
+    if (!get_element(verifier_part, position, g1_points) || !get_element(verifier_part, position, g2_points)) {
+        std::cout << "Aggregation SRS " << path << " is malformed" << std::endl;
+        return false;
+    }
+    srs.max_proofs = header.max_proofs;
+    srs.g = g1_points[0];
+    srs.g_alpha = g1_points[1];
+    srs.g_beta = g1_points[2];
+    srs.h = g2_points[0];
+    srs.h_alpha = g2_points[1];
+    srs.h_beta = g2_points[2];
+    return true;
+}
+
+bool read_aggregation_srs(boost::filesystem::path path, aggregation_srs &srs) {
+    scoped_timer timer("load_aggregation_srs");
+    boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+    aggregation_srs_header header;
+    std::vector<unit_type> verifier_part;
+    if (!read_aggregation_srs_header(stream, header, verifier_part)) {
+        std::cout << "Aggregation SRS " << path << " is missing or malformed, run --aggregation-setup first"
+                  << std::endl;
+        return false;
+    }
+
+    // The size is checked before anything is allocated for the powers
+    const std::size_t n = header.max_proofs;
+    if (boost::filesystem::file_size(path) !=
+        sizeof(header) + aggregation_verifier_srs_size + aggregation_srs_powers_size(n)) {
+        std::cout << "Aggregation SRS " << path << " is truncated or malformed" << std::endl;
+        return false;
+    }
+    std::vector<unit_type> powers(aggregation_srs_powers_size(n));
+    stream.read(reinterpret_cast<char *>(powers.data()), powers.size());
+    if (!stream.good() || header.checksum != byteblob_checksum(powers)) {
+        std::cout << "Aggregation SRS " << path << " is malformed" << std::endl;
+        return false;
+    }
+
+    const unsigned char *bytes = powers.data();
+    const bool decoded = decompress_points(bytes, 2 * n, srs.g_alpha_powers) &&
+                         decompress_points(bytes + 2 * n * compressed_g1_size, 2 * n, srs.g_beta_powers) &&
+                         decompress_points(bytes + 4 * n * compressed_g1_size, n, srs.h_alpha_powers) &&
+                         decompress_points(bytes + 4 * n * compressed_g1_size + n * compressed_g2_size, n,
+                                           srs.h_beta_powers);
+    if (!decoded) {
+        std::cout << "Aggregation SRS " << path << " holds invalid points" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Generates an SRS for up to max_proofs proofs, rounded up to a power of two
+bool aggregation_setup_file(boost::filesystem::path path, std::size_t max_proofs) {
+    auto started = std::chrono::steady_clock::now();
+    const aggregation_srs srs = aggregation_setup(max_proofs);
+    if (!write_aggregation_srs(path, srs)) {
+        std::cout << "Could not write " << path << std::endl;
+        return false;
+    }
+    std::cout << "Aggregation SRS for up to " << srs.max_proofs() << " proofs is saved to " << path << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+                     .count()
+              << " ms" << std::endl;
+    return true;
+}
+
+// Every <name>.pi of the directory in name order, the order --aggregate takes the proofs in
+bool read_primary_inputs(boost::filesystem::path directory,
+                         std::vector<typename scheme_type::primary_input_type> &primary_inputs) {
+    std::vector<boost::filesystem::path> paths;
+    for (const boost::filesystem::directory_entry &entry : boost::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".pi") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    primary_inputs.resize(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (!byteblob_to_primary_input(readfile(paths[i]), primary_inputs[i])) {
+            std::cout << "Primary input " << paths[i] << " is malformed" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The proofs of a --proof-batch directory, all of which have to load
+bool read_aggregation_items(boost::filesystem::path directory,
+                            const typename scheme_type::verification_key_type &verification_key,
+                            std::vector<typename scheme_type::proof_type> &proofs,
+                            std::vector<typename scheme_type::primary_input_type> &primary_inputs) {
+    if (!boost::filesystem::is_directory(directory)) {
+        std::cout << "Proof directory " << directory << " not found" << std::endl;
+        return false;
+    }
+    for (const verification_item &item : read_verification_items(directory, verification_key)) {
+        if (!item.loaded) {
+            std::cout << item.name << ": " << item.reason << std::endl;
+            return false;
+        }
+        proofs.push_back(item.proof);
+        primary_inputs.push_back(item.primary_input);
+    }
+    if (proofs.empty()) {
+        std::cout << "No proofs in " << directory << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Aggregates every proof of the directory into one aggregate file
+bool aggregate_directory(boost::filesystem::path directory,
+                         boost::filesystem::path srs_path,
+                         boost::filesystem::path verification_key_path,
+                         boost::filesystem::path aggregate_path) {
+    prepared_verification_key prepared;
+    std::vector<typename scheme_type::proof_type> proofs;
+    std::vector<typename scheme_type::primary_input_type> primary_inputs;
+    aggregation_srs srs;
+    if (!load_prepared_verification_key(verification_key_path, prepared) ||
+        !read_aggregation_items(directory, prepared.verification_key, proofs, primary_inputs) ||
+        !read_aggregation_srs(srs_path, srs)) {
+        return false;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    aggregate_proof aggregate;
+    std::string error;
+    if (!aggregate_proofs(srs, prepared.verification_key, proofs, primary_inputs, aggregate, error)) {
+        std::cout << "Could not aggregate: " << error << std::endl;
+        return false;
+    }
+    const std::vector<unit_type> bytes = aggregate_proof_to_byteblob(aggregate);
+    if (!writefile(aggregate_path, bytes)) {
+        std::cout << "Could not write " << aggregate_path << std::endl;
+        return false;
+    }
+    std::cout << "Aggregated " << proofs.size() << " proofs into " << bytes.size() << " bytes in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+                     .count()
+              << " ms, saved to " << aggregate_path << std::endl;
+    return true;
+}
+
+// Checks an aggregate against the primary inputs of the directory
+bool verify_aggregate_file(boost::filesystem::path directory,
+                           boost::filesystem::path srs_path,
+                           boost::filesystem::path verification_key_path,
+                           boost::filesystem::path aggregate_path) {
+    prepared_verification_key prepared;
+    aggregation_verifier_srs srs;
+    std::vector<typename scheme_type::primary_input_type> primary_inputs;
+    if (!load_prepared_verification_key(verification_key_path, prepared) ||
+        !read_aggregation_verifier_srs(srs_path, srs) || !read_primary_inputs(directory, primary_inputs)) {
+        return false;
+    }
+    aggregate_proof aggregate;
+    if (!boost::filesystem::exists(aggregate_path) ||
+        !byteblob_to_aggregate_proof(readfile(aggregate_path), aggregate)) {
+        std::cout << "Aggregate " << aggregate_path << " is missing or malformed" << std::endl;
+        return false;
+    }
+    if (aggregate.count != primary_inputs.size()) {
+        std::cout << "The aggregate covers " << aggregate.count << " proofs, " << directory << " holds "
+                  << primary_inputs.size() << " primary inputs" << std::endl;
+        return false;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    const bool verified = verify_aggregate_proof(srs, prepared, primary_inputs, aggregate);
+    std::cout << "Aggregate of " << aggregate.count << " proofs checked in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started)
+                     .count()
+              << " us" << std::endl;
+    std::cout << "Aggregate is verified: " << verified << std::endl;
+    return verified;
+}
+
+// For 2, 4, ... proofs of the directory: aggregation time and size against checking every proof on
+// its own and in one randomized batch (verify_batch_range)
+bool benchmark_aggregation(boost::filesystem::path directory,
+                           boost::filesystem::path srs_path,
+                           boost::filesystem::path verification_key_path) {
+    prepared_verification_key prepared;
+    std::vector<typename scheme_type::proof_type> proofs;
+    std::vector<typename scheme_type::primary_input_type> primary_inputs;
+    aggregation_srs srs;
+    if (!load_prepared_verification_key(verification_key_path, prepared) ||
+        !read_aggregation_items(directory, prepared.verification_key, proofs, primary_inputs) ||
+        !read_aggregation_srs(srs_path, srs)) {
+        return false;
+    }
+    const aggregation_verifier_srs verifier_srs = aggregation_verifier_key(srs);
+    auto elapsed_ms = [](std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    };
+
+    std::cout << "proofs,aggregate_ms,aggregate_bytes,verify_aggregate_ms,verify_each_ms,verify_batch_ms"
+              << std::endl;
+    for (std::size_t n = 2; n <= std::min(proofs.size(), srs.max_proofs()); n *= 2) {
+        const std::vector<typename scheme_type::proof_type> batch_proofs(proofs.begin(), proofs.begin() + n);
+        const std::vector<typename scheme_type::primary_input_type> batch_inputs(primary_inputs.begin(),
+                                                                                 primary_inputs.begin() + n);
+
+        auto started = std::chrono::steady_clock::now();
+        aggregate_proof aggregate;
+        std::string error;
+        if (!aggregate_proofs(srs, prepared.verification_key, batch_proofs, batch_inputs, aggregate, error)) {
+            std::cout << "Could not aggregate: " << error << std::endl;
+            return false;
+        }
+        const double aggregate_ms = elapsed_ms(started);
+
+        started = std::chrono::steady_clock::now();
+        const bool aggregate_valid = verify_aggregate_proof(verifier_srs, prepared, batch_inputs, aggregate);
+        const double verify_aggregate_ms = elapsed_ms(started);
+
+        started = std::chrono::steady_clock::now();
+        bool each_valid = true;
+        for (std::size_t i = 0; i < n; ++i) {
+            each_valid = verify_proof(prepared, batch_inputs[i], batch_proofs[i]) && each_valid;
+        }
+        const double verify_each_ms = elapsed_ms(started);
+
+        std::vector<verification_item> items(n);
+        std::vector<verification_item *> item_pointers;
+        for (std::size_t i = 0; i < n; ++i) {
+            items[i].proof = batch_proofs[i];
+            items[i].accumulated_input = accumulate_primary_input(prepared.verification_key, batch_inputs[i]);
+            item_pointers.push_back(&items[i]);
+        }
+        started = std::chrono::steady_clock::now();
+        const bool batch_valid = verify_batch_range(prepared, item_pointers, 0, n);
+        const double verify_batch_ms = elapsed_ms(started);
+
+        std::cout << n << "," << aggregate_ms << "," << aggregate_proof_to_byteblob(aggregate).size() << ","
+                  << verify_aggregate_ms << "," << verify_each_ms << "," << verify_batch_ms << std::endl;
+        if (!aggregate_valid || !each_valid || !batch_valid) {
+            std::cout << "Verification failed for " << n << " proofs" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif    // CLI_AGGREGATION_HPP
@@ -0,0 +1,253 @@
+#ifndef CLI_BATCH_HPP
+#define CLI_BATCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "proof_archive.hpp"
+#include "prover.hpp"
+
+// Outcome of one line of the applicant file
+struct batch_record_result {
+    std::size_t line = 0;
+    applicant_record applicant;
+    bool parsed = false;
+    bool eligible = false;
+    bool proved = false;
+    long long latency_ms = 0;
+    std::string reason;
+};
+
+// A decimal attribute of uint range. Signs are refused: stoul would wrap a negative value to a
+// large one, which the data provider never committed to.
+bool parse_applicant_field(const std::string &field, uint &value) {
+    if (field.empty() || !std::all_of(field.begin(), field.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+    try {
+        const unsigned long long parsed = std::stoull(field);
+        if (parsed > std::numeric_limits<uint>::max()) {
+            return false;
+        }
+        value = parsed;
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+bool parse_applicant_csv(const std::string &line, applicant_record &applicant) {
+    std::vector<std::string> fields;
+    boost::split(fields, line, boost::is_any_of(","));
+    if (fields.size() != 6) {
+        return false;
+    }
+    for (std::string &field : fields) {
+        boost::trim(field);
+    }
+
+    if (!parse_applicant_field(fields[0], applicant.pa_id) || !parse_applicant_field(fields[1], applicant.pa_income) ||
+        !parse_applicant_field(fields[2], applicant.fi_overdue_loans) ||
+        !parse_applicant_field(fields[3], applicant.fi_account_age)) {
+        return false;
+    }
+    applicant.pa_data_hash = fields[4];
+    applicant.fi_data_hash = fields[5];
+    return true;
+}
+
+bool parse_applicant_json(const std::string &line, applicant_record &applicant) {
+    boost::property_tree::ptree record;
+    try {
+        std::istringstream stream(line);
+        boost::property_tree::read_json(stream, record);
+
+        if (!parse_applicant_field(record.get<std::string>("id"), applicant.pa_id) ||
+            !parse_applicant_field(record.get<std::string>("income"), applicant.pa_income) ||
+            !parse_applicant_field(record.get<std::string>("overdue_loans"), applicant.fi_overdue_loans) ||
+            !parse_applicant_field(record.get<std::string>("account_age"), applicant.fi_account_age)) {
+            return false;
+        }
+        applicant.pa_data_hash = record.get<std::string>("pa_data_hash");
+        applicant.fi_data_hash = record.get<std::string>("fi_data_hash");
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+// Applicant file is either CSV (id,income,overdue_loans,account_age,pa_data_hash,fi_data_hash,
+// optionally with that header line) or JSONL with the same field names.
+std::vector<batch_record_result> read_applicants(boost::filesystem::path path) {
+    std::vector<batch_record_result> records;
+    boost::filesystem::ifstream stream(path);
+
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(stream, line)) {
+        ++line_number;
+        boost::trim(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        batch_record_result record;
+        record.line = line_number;
+        if (line.front() == '{') {
+            record.parsed = parse_applicant_json(line, record.applicant);
+        } else {
+            record.parsed = parse_applicant_csv(line, record.applicant);
+            if (!record.parsed && records.empty() && !std::isdigit(line.front())) {
+                continue;
+            }
+        }
+        if (!record.parsed) {
+            record.reason = "malformed record";
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+// Proves every applicant of the file with one proving key. The compiled circuit is shared by all
+// workers; per record a worker only fills its witness buffer and runs the prover. Proofs go to
+// <id>.proof and <id>.pi files, or to the archive when one is given.
+bool proof_batch(boost::filesystem::path applicants_path,
+                 boost::filesystem::path proving_key_path,
+                 boost::filesystem::path output_dir,
+                 std::size_t threads,
+                 boost::filesystem::path archive_path = boost::filesystem::path()) {
+    std::cout << std::endl;
+    std::cout << "Batch proving..." << std::endl;
+    std::cout << std::endl;
+
+    if (!boost::filesystem::exists(applicants_path)) {
+        std::cout << "Applicant file " << applicants_path << " not found" << std::endl;
+        return false;
+    }
+    std::vector<batch_record_result> records = read_applicants(applicants_path);
+
+    // Ineligible records are rejected natively; only the others need the key and a worker. Proofs are
+    // named by id, so only the first record of an id is proved.
+    std::size_t eligible = 0;
+    std::unordered_set<uint> seen_ids;
+    for (batch_record_result &record : records) {
+        if (record.parsed && !seen_ids.insert(record.applicant.pa_id).second) {
+            record.reason = "duplicate id";
+            continue;
+        }
+        record.eligible = record.parsed && evaluate_applicant(record.applicant, record.reason);
+        eligible += record.eligible;
+    }
+    threads = std::min(resolve_threads(threads), std::max<std::size_t>(eligible, 1));
+
+    // Each worker proves single-threaded, a memory budget is shared by all of them
+    groth16_proving_key proving_key;
+    if (eligible && !load_groth16_proving_key(proving_key_path, proving_key, threads, 1)) {
+        return false;
+    }
+
+    boost::filesystem::create_directories(output_dir);
+    proof_archive_writer archive;
+    if (!archive_path.empty() && !archive.open(archive_path)) {
+        return false;
+    }
+    std::cout << "Proving " << eligible << " eligible of " << records.size() << " records on " << threads
+              << " threads" << std::endl;
+
+    auto started = std::chrono::steady_clock::now();
+    std::atomic<std::size_t> next_record(0);
+
+    auto worker = [&]() {
+        multiscore_witness<field_type> witness(compiled_circuit());
+        std::vector<unit_type> proof_byteblob, primary_input_byteblob;
+        typename scheme_type::proof_type proof;
+        r1cs_primary_input<field_type> primary_input;
+
+        for (std::size_t i = next_record++; i < records.size(); i = next_record++) {
+            batch_record_result &record = records[i];
+            if (!record.eligible) {
+                continue;
+            }
+
+            auto record_started = std::chrono::steady_clock::now();
+            try {
+                // One proof per worker already fills the cores, each proof runs single-threaded
+                if (!archive_path.empty()) {
+                    record.proved = prove_applicant(witness, proving_key, record.applicant, proof, primary_input,
+                                                    false, 1);
+                    if (!record.proved) {
+                        record.reason = "blueprint is not satisfied";
+                    } else if (!archive.append(record.applicant.pa_id, proof, primary_input)) {
+                        record.proved = false;
+                        record.reason = "archive is closed";
+                    }
+                } else if (generate_proof(witness, proving_key, record.applicant, proof_byteblob,
+                                          primary_input_byteblob, false, 1)) {
+                    scoped_timer timer("write_files");
+                    std::string name = std::to_string(record.applicant.pa_id);
+                    record.proved = writefile(output_dir / (name + ".proof"), proof_byteblob) &&
+                                    writefile(output_dir / (name + ".pi"), primary_input_byteblob);
+                    if (!record.proved) {
+                        record.reason = "could not write the proof files";
+                    }
+                } else {
+                    record.reason = "blueprint is not satisfied";
+                }
+            } catch (const std::exception &e) {
+                record.proved = false;
+                record.reason = e.what();
+            }
+            record.latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::steady_clock::now() - record_started)
+                                    .count();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &t : workers) {
+        t.join();
+    }
+    if (!archive_path.empty() && !archive.close()) {
+        std::cout << "Could not write every proof to " << archive_path << std::endl;
+        return false;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    boost::filesystem::path report_path = output_dir / "report.csv";
+    boost::filesystem::ofstream report(report_path);
+    report << "line,id,status,latency_ms,reason" << std::endl;
+
+    std::size_t proved = 0;
+    for (const batch_record_result &record : records) {
+        proved += record.proved;
+        report << record.line << "," << (record.parsed ? std::to_string(record.applicant.pa_id) : "") << ","
+               << (record.proved ? "ok" : "failed") << "," << record.latency_ms << ",\"" << record.reason << "\"" << std::endl;
+    }
+    report.close();
+
+    std::cout << "Proved " << proved << " of " << records.size() << " records in " << elapsed << " s ("
+              << (elapsed > 0 ? proved / elapsed : 0) << " proofs/s, peak RSS " << (peak_rss_kb() >> 10) << " MB)"
+              << std::endl;
+    std::cout << "Proofs are saved to " << (archive_path.empty() ? output_dir : archive_path) << ", report to "
+              << report_path << std::endl;
+
+    return proved == records.size();
+}
+
+#endif    // CLI_BATCH_HPP
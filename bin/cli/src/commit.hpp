@@ -0,0 +1,178 @@
+#ifndef CLI_COMMIT_HPP
+#define CLI_COMMIT_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+
+#include <boost/algorithm/string.hpp>
+
+#include "prover.hpp"
+
+// Knapsack commitment of a pair of uint attributes, as --pa-data-hash and --fi-data-hash expect it.
+// The hash is taken over two 256-bit big-endian words, of which only the low 32 bits can be set, and
+// it is the sum of the coefficients of the set bits. Those sums are tabulated per byte of each
+// attribute, so a commitment costs eight lookups and seven additions instead of a pass over 512 bits.
+class knapsack_commitment_table {
+  public:
+    static constexpr const std::size_t word_bits = 256;
+    static constexpr const std::size_t attribute_bytes = 4;
+
+    static_assert(sizeof(uint) == attribute_bytes, "attributes are 32-bit");
+
+    knapsack_commitment_table() {
+        for (std::size_t word = 0; word < 2; ++word) {
+            for (std::size_t byte = 0; byte < attribute_bytes; ++byte) {
+                std::array<value_type, 256> &table = tables[word * attribute_bytes + byte];
+
+                // Bit j of an attribute sits at position 255 - j of its word
+                std::array<value_type, 8> coefficients;
+                for (std::size_t bit = 0; bit < 8; ++bit) {
+                    const std::size_t position = (word + 1) * word_bits - 1 - (8 * byte + bit);
+                    coefficients[bit] = knapsack_coefficient<field_type>(2 * word_bits, position);
+                }
+
+                // Every byte value adds its lowest set bit to the sum of the remaining ones
+                table[0] = value_type::zero();
+                for (std::size_t value = 1; value < 256; ++value) {
+                    std::size_t lowest = 0;
+                    while (!((value >> lowest) & 1)) {
+                        ++lowest;
+                    }
+                    table[value] = table[value & (value - 1)] + coefficients[lowest];
+                }
+            }
+        }
+    }
+
+    value_type operator()(uint left, uint right) const {
+        value_type sum = tables[0][left & 0xff];
+        for (std::size_t byte = 1; byte < attribute_bytes; ++byte) {
+            sum = sum + tables[byte][(left >> (8 * byte)) & 0xff];
+        }
+        for (std::size_t byte = 0; byte < attribute_bytes; ++byte) {
+            sum = sum + tables[attribute_bytes + byte][(right >> (8 * byte)) & 0xff];
+        }
+        return sum;
+    }
+
+  private:
+    std::array<std::array<value_type, 256>, 2 * attribute_bytes> tables;
+};
+
+// <reference>,<left>,<right>; the reference is passed through untouched
+bool parse_commitment_record(const std::string &line, std::string &reference, uint &left, uint &right) {
+    const std::size_t first = line.find(',');
+    const std::size_t second = first == std::string::npos ? first : line.find(',', first + 1);
+    if (second == std::string::npos) {
+        return false;
+    }
+    reference = boost::trim_copy(line.substr(0, first));
+
+    const char *begin = line.c_str() + first + 1;
+    char *end = nullptr;
+    const unsigned long left_value = std::strtoul(begin, &end, 10);
+    if (end == begin || *end != ',' || left_value > std::numeric_limits<uint>::max()) {
+        return false;
+    }
+    begin = end + 1;
+    const unsigned long right_value = std::strtoul(begin, &end, 10);
+    if (end == begin || right_value > std::numeric_limits<uint>::max()) {
+        return false;
+    }
+    while (*end == ' ' || *end == '\t' || *end == '\r') {
+        ++end;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+
+    left = left_value;
+    right = right_value;
+    return true;
+}
+
+// Streams a CSV of <reference>,<left>,<right> records (an optional header line is skipped) and
+// writes <reference>,<hash> lines in the same order, with the hash in the hex form
+// hex_to_field_element reads. Records are read in chunks and every chunk is hashed on all threads.
+// Knapsack variants use the byte tables, the poseidon variant hashes natively.
+bool commit_batch(boost::filesystem::path input_path, boost::filesystem::path output_path, std::size_t threads) {
+    static constexpr const std::size_t chunk_records = std::size_t(1) << 16;
+
+    boost::filesystem::ifstream input(input_path);
+    if (!input) {
+        std::cout << "Record file " << input_path << " not found" << std::endl;
+        return false;
+    }
+    boost::filesystem::ofstream output(output_path, std::ios::out | std::ios::trunc);
+    if (!output) {
+        std::cout << "Could not write " << output_path << std::endl;
+        return false;
+    }
+
+    const bool poseidon = circuit_widths.commitment == multiscore_commitment::poseidon;
+    std::unique_ptr<knapsack_commitment_table> table;
+    if (!poseidon) {
+        table.reset(new knapsack_commitment_table());
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::string> lines(chunk_records), results(chunk_records);
+    std::size_t committed = 0, malformed = 0;
+    bool first_chunk = true;
+
+    for (;;) {
+        std::size_t count = 0;
+        while (count < chunk_records && std::getline(input, lines[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t) {
+            std::string reference;
+            uint left, right;
+            for (std::size_t i = begin; i < end; ++i) {
+                if (!parse_commitment_record(lines[i], reference, left, right)) {
+                    results[i].clear();
+                    continue;
+                }
+                const value_type hash = poseidon ? poseidon_hash(value_type(left), value_type(right)) :
+                                                   (*table)(left, right);
+                results[i] = reference + "," + field_element_to_hex(hash) + "\n";
+            }
+        }, threads);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (results[i].empty()) {
+                // A first line that is not a record is the header
+                if (!boost::trim_copy(lines[i]).empty() && !(first_chunk && i == 0)) {
+                    ++malformed;
+                }
+                continue;
+            }
+            output << results[i];
+            ++committed;
+        }
+        first_chunk = false;
+    }
+
+    if (!output.good()) {
+        std::cout << "Could not write " << output_path << std::endl;
+        return false;
+    }
+    const auto elapsed_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Committed " << committed << " records in " << elapsed_ms << " ms";
+    if (elapsed_ms > 0) {
+        std::cout << " (" << committed * 1000 / elapsed_ms << " records/s)";
+    }
+    std::cout << ", " << malformed << " malformed" << std::endl;
+    std::cout << "Commitments are saved to " << output_path << std::endl;
+    return malformed == 0;
+}
+
+#endif    // CLI_COMMIT_HPP
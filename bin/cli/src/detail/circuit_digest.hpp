@@ -0,0 +1,59 @@
+#ifndef CLI_CIRCUIT_DIGEST_HPP
+#define CLI_CIRCUIT_DIGEST_HPP
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <nil/crypto3/hash/algorithm/hash.hpp>
+#include <nil/crypto3/hash/sha2.hpp>
+
+#include <nil/crypto3/zk/snark/relations/constraint_satisfaction_problems/r1cs.hpp>
+
+using namespace nil::crypto3::zk::snark;
+
+// Bumped whenever the encoding below changes
+constexpr const char *circuit_digest_version = "r1cs-digest-v1";
+
+// SHA-256, in hex, over a canonical encoding of a constraint system: the input and auxiliary
+// sizes, then every constraint as its A, B and C terms, each an index and a coefficient in
+// canonical big-endian form. Two systems have the same digest exactly when they have the same
+// constraints in the same order, so the digest identifies the keys generated for a circuit
+// across builds and machines.
+template<typename FieldT>
+std::string circuit_digest(const r1cs_constraint_system<FieldT> &constraint_system) {
+    std::vector<std::uint8_t> encoding(circuit_digest_version,
+                                       circuit_digest_version + std::char_traits<char>::length(circuit_digest_version));
+
+    auto put_size = [&](std::uint64_t value) {
+        for (std::size_t i = 0; i < 8; ++i) {
+            encoding.push_back(std::uint8_t(value >> (8 * i)));
+        }
+    };
+    auto put_combination = [&](const linear_combination<FieldT> &lc) {
+        put_size(lc.terms.size());
+        std::vector<std::uint8_t> coefficient;
+        for (const auto &term : lc.terms) {
+            put_size(term.index);
+            coefficient.clear();
+            nil::crypto3::multiprecision::export_bits(typename FieldT::integral_type(term.coeff.data),
+                                                      std::back_inserter(coefficient), 8);
+            encoding.push_back(std::uint8_t(coefficient.size()));
+            encoding.insert(encoding.end(), coefficient.begin(), coefficient.end());
+        }
+    };
+
+    put_size(constraint_system.primary_input_size);
+    put_size(constraint_system.auxiliary_input_size);
+    put_size(constraint_system.constraints.size());
+    for (const r1cs_constraint<FieldT> &constraint : constraint_system.constraints) {
+        put_combination(constraint.a);
+        put_combination(constraint.b);
+        put_combination(constraint.c);
+    }
+
+    std::string digest = nil::crypto3::hash<nil::crypto3::hashes::sha2<256>>(encoding.begin(), encoding.end());
+    return digest;
+}
+
+#endif    // CLI_CIRCUIT_DIGEST_HPP
@@ -0,0 +1,350 @@
+#ifndef CLI_GROTH16_PROVER_HPP
+#define CLI_GROTH16_PROVER_HPP
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+#include <nil/crypto3/algebra/random_element.hpp>
+#include <nil/crypto3/zk/snark/reductions/r1cs_to_qap.hpp>
+
+#include "../proving_key_file.hpp"
+#include "metrics.hpp"
+#include "multiexp.hpp"
+#include "radix2_domain.hpp"
+
+// Proving key as the native prover reads it: flat runs of points with the B query split into its G2
+// and G1 halves. The runs either point into a mapped proving key file, which is then kept open for
+// as long as the key lives, or into vectors owned by the key. Copying would leave the runs pointing
+// at the source, so the key can only be moved.
+//
+// A streamed key holds the single points and the B query indices only. Its query sections have
+// sizes but no data; the prover reads them from the file chunk by chunk as every
+// multi-exponentiation consumes them, see groth16_stream_chunk_points.
+class groth16_proving_key {
+  public:
+    groth16_proving_key() = default;
+    groth16_proving_key(groth16_proving_key &&) = default;
+    groth16_proving_key &operator=(groth16_proving_key &&) = default;
+    groth16_proving_key(const groth16_proving_key &) = delete;
+    groth16_proving_key &operator=(const groth16_proving_key &) = delete;
+
+    // Uses the sections of an uncompressed mapped file in place, nothing is copied
+    static groth16_proving_key from_mapping(std::shared_ptr<const mapped_proving_key> mapping) {
+        groth16_proving_key key;
+        key.alpha_g1 = mapping->alpha_g1;
+        key.beta_g1 = mapping->beta_g1;
+        key.beta_g2 = mapping->beta_g2;
+        key.delta_g1 = mapping->delta_g1;
+        key.delta_g2 = mapping->delta_g2;
+        key.A_query = mapping->A_query;
+        key.B_query_indices = mapping->B_query_indices;
+        key.B_query_g = mapping->B_query_g;
+        key.B_query_h = mapping->B_query_h;
+        key.H_query = mapping->H_query;
+        key.L_query = mapping->L_query;
+        key.num_inputs = mapping->header.num_inputs;
+        key.num_variables = mapping->header.num_variables;
+        key.mapping = std::move(mapping);
+        return key;
+    }
+
+    // Reads the single points and the B query indices; the queries are left in the file. Their
+    // sizes are the section counts, which the reader checked against the circuit sizes on open
+    // (check_proving_key_file_counts); the indices are checked here as they are read.
+    static bool from_stream(std::shared_ptr<const proving_key_file_reader> reader,
+                            std::size_t chunk_points,
+                            groth16_proving_key &key) {
+        auto read_point = [&](proving_key_file_section_id id, auto &point) {
+            std::vector<typename std::decay<decltype(point)>::type> points;
+            if (reader->count(id) != 1 || !reader->read(id, 0, 1, points) || points.size() != 1) {
+                return false;
+            }
+            point = points[0];
+            return true;
+        };
+        if (!read_point(section_alpha_g1, key.alpha_g1) || !read_point(section_beta_g1, key.beta_g1) ||
+            !read_point(section_beta_g2, key.beta_g2) || !read_point(section_delta_g1, key.delta_g1) ||
+            !read_point(section_delta_g2, key.delta_g2) ||
+            !reader->read(section_B_query_indices, 0, reader->count(section_B_query_indices),
+                          key.owned_B_query_indices)) {
+            return false;
+        }
+        std::string error;
+        if (!check_proving_key_file_indices(reader->header, key.owned_B_query_indices.data(),
+                                            key.owned_B_query_indices.size(), error)) {
+            return false;
+        }
+
+        key.B_query_indices = view(key.owned_B_query_indices);
+        key.A_query.size = reader->count(section_A_query);
+        key.B_query_g.size = reader->count(section_B_query_g);
+        key.B_query_h.size = reader->count(section_B_query_h);
+        key.H_query.size = reader->count(section_H_query);
+        key.L_query.size = reader->count(section_L_query);
+        key.num_inputs = reader->header.num_inputs;
+        key.num_variables = reader->header.num_variables;
+        key.reader = std::move(reader);
+        key.chunk_points = chunk_points;
+        return true;
+    }
+
+    static groth16_proving_key from_proving_key(typename scheme_type::proving_key_type &&proving_key) {
+        groth16_proving_key key;
+        key.alpha_g1 = proving_key.alpha_g1;
+        key.beta_g1 = proving_key.beta_g1;
+        key.beta_g2 = proving_key.beta_g2;
+        key.delta_g1 = proving_key.delta_g1;
+        key.delta_g2 = proving_key.delta_g2;
+        key.num_inputs = proving_key.constraint_system.num_inputs();
+        key.num_variables = proving_key.constraint_system.num_variables();
+
+        key.owned_B_query_indices.assign(proving_key.B_query.indices.begin(), proving_key.B_query.indices.end());
+        key.owned_B_query_g.reserve(proving_key.B_query.values.size());
+        key.owned_B_query_h.reserve(proving_key.B_query.values.size());
+        for (const auto &value : proving_key.B_query.values) {
+            key.owned_B_query_g.push_back(value.g);
+            key.owned_B_query_h.push_back(value.h);
+        }
+        key.owned_A_query = std::move(proving_key.A_query);
+        key.owned_H_query = std::move(proving_key.H_query);
+        key.owned_L_query = std::move(proving_key.L_query);
+
+        key.A_query = view(key.owned_A_query);
+        key.B_query_indices = view(key.owned_B_query_indices);
+        key.B_query_g = view(key.owned_B_query_g);
+        key.B_query_h = view(key.owned_B_query_h);
+        key.H_query = view(key.owned_H_query);
+        key.L_query = view(key.owned_L_query);
+        return key;
+    }
+
+    g1_value_type alpha_g1, beta_g1, delta_g1;
+    g2_value_type beta_g2, delta_g2;
+    mapped_section<g1_value_type> A_query;
+    mapped_section<std::uint64_t> B_query_indices;
+    mapped_section<g2_value_type> B_query_g;
+    mapped_section<g1_value_type> B_query_h;
+    mapped_section<g1_value_type> H_query;
+    mapped_section<g1_value_type> L_query;
+
+    std::size_t num_inputs = 0;
+    std::size_t num_variables = 0;
+
+    bool streamed() const {
+        return reader != nullptr;
+    }
+
+    // sum scalars[i] * query[i] over the first count points of a query section. A streamed key
+    // reads the next chunk on another thread while the current one is multiplied, so two chunks
+    // are held at a time.
+    template<typename PointType>
+    PointType query_multiexp(proving_key_file_section_id id,
+                             const mapped_section<PointType> &query,
+                             const scalar_limbs *scalars,
+                             std::size_t count,
+                             std::size_t threads) const {
+        if (!streamed()) {
+            return multiexp(query.begin(), scalars, count, threads);
+        }
+
+        std::vector<PointType> current, next;
+        auto read_chunk = [&](std::size_t begin) {
+            return reader->read(id, begin, std::min(chunk_points, count - begin), next);
+        };
+        std::future<bool> pending;
+        if (count > 0) {
+            pending = std::async(std::launch::async, read_chunk, 0);
+        }
+
+        PointType result = PointType::zero();
+        for (std::size_t begin = 0; begin < count; begin += chunk_points) {
+            if (!pending.get()) {
+                throw std::runtime_error("cannot read section " + std::to_string(id) + " of the proving key");
+            }
+            std::swap(current, next);
+            if (begin + chunk_points < count) {
+                pending = std::async(std::launch::async, read_chunk, begin + chunk_points);
+            }
+            result = result + multiexp(current.data(), scalars + begin, current.size(), threads);
+        }
+        return result;
+    }
+
+  private:
+    template<typename T>
+    static mapped_section<T> view(const std::vector<T> &owned) {
+        mapped_section<T> result;
+        result.data = owned.data();
+        result.size = owned.size();
+        return result;
+    }
+
+    std::shared_ptr<const mapped_proving_key> mapping;
+    std::shared_ptr<const proving_key_file_reader> reader;
+    std::size_t chunk_points = 0;
+    std::vector<g1_value_type> owned_A_query, owned_B_query_h, owned_H_query, owned_L_query;
+    std::vector<g2_value_type> owned_B_query_g;
+    std::vector<std::uint64_t> owned_B_query_indices;
+};
+
+// Bytes one proof of a key holds besides its query points: the witness and its copy, the scalars,
+// the three quotient buffers and the B query indices
+std::size_t groth16_proof_buffer_bytes(std::size_t num_variables, std::size_t H_size, std::size_t B_size) {
+    return num_variables * (3 * sizeof(value_type) + sizeof(scalar_limbs)) + (H_size + 1) * 3 * sizeof(value_type) +
+           H_size * sizeof(scalar_limbs) + B_size * (sizeof(scalar_limbs) + sizeof(std::uint64_t));
+}
+
+// Points per chunk that keep a proof streaming its key within memory_budget bytes: what the
+// buffers of the proof leave, split between the chunk being multiplied, the chunk being read and
+// the compressed bytes of the latter, less the buckets every thread of the multi-exponentiation
+// keeps. Sized for G2, the larger points. 0 if the budget does not leave a useful chunk.
+std::size_t groth16_stream_chunk_points(std::size_t memory_budget, std::size_t buffer_bytes, bool compressed,
+                                        std::size_t threads = worker_threads) {
+    constexpr std::size_t min_chunk_points = 1024;
+    if (memory_budget <= buffer_bytes) {
+        return 0;
+    }
+    const std::size_t available = memory_budget - buffer_bytes;
+    const std::size_t point_bytes = 2 * sizeof(g2_value_type) + (compressed ? compressed_g2_size : 0);
+
+    std::size_t chunk_points = available / point_bytes;
+    const std::size_t bucket_bytes =
+        resolve_threads(threads) * (std::size_t(1) << multiexp_window_size(chunk_points)) * sizeof(g2_value_type);
+    chunk_points = available > bucket_bytes ? (available - bucket_bytes) / point_bytes : 0;
+    return chunk_points < min_chunk_points ? 0 : chunk_points;
+}
+
+// Coefficients of the quotient polynomial H = (A * B - C) / Z, the same values r1cs_to_qap's witness
+// map gives without zero-knowledge randomization. domain_size is the one the key was generated
+// for. Power-of-two domains are evaluated on the cached radix2_domain, in place in coefficients,
+// which keeps its capacity across calls; other sizes go through the library reduction.
+void groth16_quotient(const r1cs_constraint_system<field_type> &constraint_system,
+                      const r1cs_primary_input<field_type> &primary_input,
+                      const r1cs_auxiliary_input<field_type> &auxiliary_input,
+                      std::size_t domain_size,
+                      std::vector<value_type> &coefficients,
+                      std::size_t threads = worker_threads) {
+    if (!radix2_domain::is_supported(domain_size)) {
+        coefficients = reductions::r1cs_to_qap<field_type>::witness_map(constraint_system, primary_input,
+                                                                        auxiliary_input, value_type::zero(),
+                                                                        value_type::zero(), value_type::zero())
+                           .coefficients_for_H;
+        return;
+    }
+
+    const std::shared_ptr<const radix2_domain> domain = radix2_domain::get(domain_size);
+    const std::size_t num_constraints = constraint_system.num_constraints();
+    assert(num_constraints + primary_input.size() < domain_size);
+
+    r1cs_variable_assignment<field_type> full_variable_assignment(primary_input);
+    full_variable_assignment.insert(full_variable_assignment.end(), auxiliary_input.begin(), auxiliary_input.end());
+
+    // A, B and C evaluated on the domain: one point per constraint, then one per input for the
+    // constraints input_i * 0 = 0 the reduction adds. The buffers are reused by the proofs of the
+    // calling thread; the workers see them through the references, not as their own thread_locals.
+    thread_local std::vector<value_type> B_buffer, C_buffer;
+    std::vector<value_type> &A = coefficients;
+    std::vector<value_type> &B = B_buffer;
+    std::vector<value_type> &C = C_buffer;
+    A.assign(domain_size, value_type::zero());
+    B.assign(domain_size, value_type::zero());
+    C.assign(domain_size, value_type::zero());
+
+    parallel_for(num_constraints, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const r1cs_constraint<field_type> &constraint = constraint_system.constraints[i];
+            A[i] = constraint.a.evaluate(full_variable_assignment);
+            B[i] = constraint.b.evaluate(full_variable_assignment);
+            C[i] = constraint.c.evaluate(full_variable_assignment);
+        }
+    }, threads);
+    A[num_constraints] = value_type::one();
+    for (std::size_t i = 0; i < primary_input.size(); ++i) {
+        A[num_constraints + 1 + i] = primary_input[i];
+    }
+
+    for (std::vector<value_type> *evaluations : {&A, &B, &C}) {
+        domain->ifft(*evaluations, threads);
+        domain->coset_fft(*evaluations, threads);
+    }
+
+    parallel_for(domain_size, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            A[i] = A[i] * B[i] - C[i];
+        }
+    }, threads);
+    domain->divide_by_vanishing_on_coset(A, threads);
+    domain->icoset_fft(A, threads);
+}
+
+// Groth16 prover of r1cs_gg_ppzksnark, with the four query multi-exponentiations on the parallel
+// bucket method. With z = (1, primary input, auxiliary input) and random r, s:
+//   A = alpha + sum z_i A_i + r delta
+//   B = beta + sum z_i B_i + s delta (in G2 and in G1)
+//   C = sum h_i H_i + sum_{aux} z_i L_i + s A + r B_G1 - r s delta
+// threads is the parallelism of this one proof; callers proving several at once pass 1.
+typename scheme_type::proof_type groth16_prove(const groth16_proving_key &key,
+                                               const r1cs_constraint_system<field_type> &constraint_system,
+                                               const r1cs_primary_input<field_type> &primary_input,
+                                               const r1cs_auxiliary_input<field_type> &auxiliary_input,
+                                               std::size_t threads = worker_threads) {
+    assert(primary_input.size() == key.num_inputs);
+    assert(primary_input.size() + auxiliary_input.size() == key.num_variables);
+    scoped_timer timer("prove");
+
+    thread_local std::vector<value_type> coefficients_buffer;
+    std::vector<value_type> &coefficients_for_H = coefficients_buffer;
+    {
+        scoped_timer quotient_timer("prove.quotient");
+        groth16_quotient(constraint_system, primary_input, auxiliary_input, key.H_query.size + 1,
+                         coefficients_for_H, threads);
+    }
+
+    std::vector<scalar_limbs> assignment(key.num_variables + 1);
+    assignment[0] = to_scalar_limbs(value_type::one());
+    parallel_for(key.num_variables, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            assignment[i + 1] = to_scalar_limbs(i < primary_input.size() ? primary_input[i] :
+                                                                           auxiliary_input[i - primary_input.size()]);
+        }
+    }, threads);
+
+    std::vector<scalar_limbs> H_scalars(key.H_query.size);
+    parallel_for(H_scalars.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            H_scalars[i] = to_scalar_limbs(coefficients_for_H[i]);
+        }
+    }, threads);
+
+    std::vector<scalar_limbs> B_scalars(key.B_query_indices.size);
+    for (std::size_t i = 0; i < B_scalars.size(); ++i) {
+        B_scalars[i] = assignment[key.B_query_indices[i]];
+    }
+
+    // Each multi-exponentiation is parallel on its own, so they run one after another
+    scoped_timer msm_timer("prove.msm");
+    const g1_value_type evaluation_At = key.query_multiexp(section_A_query, key.A_query, assignment.data(),
+                                                           std::min(key.A_query.size, assignment.size()), threads);
+    const g2_value_type evaluation_Bt_g =
+        key.query_multiexp(section_B_query_g, key.B_query_g, B_scalars.data(), B_scalars.size(), threads);
+    const g1_value_type evaluation_Bt_h =
+        key.query_multiexp(section_B_query_h, key.B_query_h, B_scalars.data(), B_scalars.size(), threads);
+    const g1_value_type evaluation_Ht =
+        key.query_multiexp(section_H_query, key.H_query, H_scalars.data(), H_scalars.size(), threads);
+    const g1_value_type evaluation_Lt = key.query_multiexp(section_L_query, key.L_query,
+                                                           assignment.data() + key.num_inputs + 1, key.L_query.size,
+                                                           threads);
+
+    const value_type r = algebra::random_element<field_type>();
+    const value_type s = algebra::random_element<field_type>();
+
+    const g1_value_type g1_A = key.alpha_g1 + evaluation_At + r * key.delta_g1;
+    const g1_value_type g1_B = key.beta_g1 + evaluation_Bt_h + s * key.delta_g1;
+    const g2_value_type g2_B = key.beta_g2 + evaluation_Bt_g + s * key.delta_g2;
+    const g1_value_type g1_C = evaluation_Ht + evaluation_Lt + s * g1_A + r * g1_B - (r * s) * key.delta_g1;
+
+    return typename scheme_type::proof_type(g1_A, g2_B, g1_C);
+}
+
+#endif    // CLI_GROTH16_PROVER_HPP
@@ -0,0 +1,234 @@
+#ifndef CLI_GROTH16_SETUP_HPP
+#define CLI_GROTH16_SETUP_HPP
+
+#include <chrono>
+
+#include <nil/crypto3/algebra/random_element.hpp>
+#include <nil/crypto3/zk/snark/reductions/r1cs_to_qap.hpp>
+
+#include "metrics.hpp"
+#include "multiexp.hpp"
+#include "point_encoding.hpp"
+
+// Multiples d * 2^(c * w) * base of a fixed base for every c-bit window w and digit d, so that a
+// scalar multiplication is one addition per window and no doubling. The rows are built in
+// parallel and normalized to affine coordinates.
+template<typename PointType>
+class fixed_base_table {
+  public:
+    fixed_base_table(const PointType &base, std::size_t window_bits, std::size_t threads = worker_threads) :
+        window_bits(window_bits), windows((field_type::modulus_bits + window_bits - 1) / window_bits),
+        row_size(std::size_t(1) << window_bits), table(windows * row_size) {
+        std::vector<PointType> row_bases(windows);
+        row_bases[0] = base;
+        for (std::size_t w = 1; w < windows; ++w) {
+            row_bases[w] = row_bases[w - 1];
+            for (std::size_t i = 0; i < window_bits; ++i) {
+                row_bases[w] = row_bases[w].doubled();
+            }
+        }
+
+        parallel_for(windows, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t w = begin; w < end; ++w) {
+                PointType *row = table.data() + w * row_size;
+                row[0] = PointType::zero();
+                for (std::size_t digit = 1; digit < row_size; ++digit) {
+                    row[digit] = row[digit - 1] + row_bases[w];
+                }
+                batch_to_affine(row, row_size);
+            }
+        }, threads);
+    }
+
+    PointType multiply(const scalar_limbs &scalar) const {
+        PointType result = PointType::zero();
+        for (std::size_t w = 0; w < windows; ++w) {
+            const std::size_t digit = scalar_digit(scalar, w * window_bits, window_bits);
+            if (digit != 0) {
+                result = result + table[w * row_size + digit];
+            }
+        }
+        return result;
+    }
+
+    PointType multiply(const value_type &scalar) const {
+        return multiply(to_scalar_limbs(scalar));
+    }
+
+    // Window minimizing table construction plus count multiplications, capped to keep the table
+    // of G2 points below about 100 MB
+    static std::size_t window_size(std::size_t count) {
+        std::size_t best = 1;
+        double best_cost = 0;
+        for (std::size_t c = 1; c <= 14; ++c) {
+            const double windows = double((field_type::modulus_bits + c - 1) / c);
+            const double cost = windows * (double(std::size_t(1) << c) + double(count));
+            if (c == 1 || cost < best_cost) {
+                best = c;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+  private:
+    std::size_t window_bits;
+    std::size_t windows;
+    std::size_t row_size;
+    std::vector<PointType> table;
+};
+
+// scalars[i] * base for every scalar, split into one chunk per thread. Every chunk is normalized
+// to affine coordinates with a single inversion.
+template<typename PointType>
+std::vector<PointType> fixed_base_batch(const fixed_base_table<PointType> &table,
+                                        const std::vector<value_type> &scalars,
+                                        std::size_t threads = worker_threads) {
+    std::vector<PointType> points(scalars.size());
+    parallel_for(scalars.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            points[i] = table.multiply(scalars[i]);
+        }
+        batch_to_affine(points.data() + begin, end - begin);
+    }, threads);
+    return points;
+}
+
+// Key generator of r1cs_gg_ppzksnark producing the same key pair as generate<scheme_type>, with
+// every query computed on the fixed-base tables above and spread over threads. With the QAP
+// evaluated at a random t and random alpha, beta, gamma, delta:
+//   A_i = A_i(t) G1, B_i = B_i(t) (G2, G1), H_i = t^i Z(t) / delta G1,
+//   L_i = (beta A_i(t) + alpha B_i(t) + C_i(t)) / delta G1 for the auxiliary variables and the same
+//   over gamma in the verification key for the constant and the primary input.
+typename scheme_type::keypair_type groth16_setup(const r1cs_constraint_system<field_type> &constraint_system,
+                                                 bool verbose = false,
+                                                 std::size_t threads = worker_threads) {
+    scoped_timer timer("setup");
+    typedef typename curve_type::g1_type g1_type;
+    typedef typename curve_type::g2_type g2_type;
+    typedef typename curve_type::pairing pairing;
+
+    auto stage_started = std::chrono::steady_clock::now();
+    auto progress = [&](const std::string &stage, std::size_t points) {
+        const auto now = std::chrono::steady_clock::now();
+        if (verbose) {
+            std::cout << "Setup: " << stage;
+            if (points) {
+                std::cout << " (" << points << " points)";
+            }
+            std::cout << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(now - stage_started).count()
+                      << " ms" << std::endl;
+        }
+        stage_started = now;
+    };
+
+    // The library generator makes the B query, which lives in G2, the sparser one as well
+    r1cs_constraint_system<field_type> key_constraint_system(constraint_system);
+    key_constraint_system.swap_AB_if_beneficial();
+
+    const value_type t = algebra::random_element<field_type>();
+    const value_type alpha = algebra::random_element<field_type>();
+    const value_type beta = algebra::random_element<field_type>();
+    const value_type gamma = algebra::random_element<field_type>();
+    const value_type delta = algebra::random_element<field_type>();
+    const value_type gamma_inverse = gamma.inversed();
+    const value_type delta_inverse = delta.inversed();
+
+    auto qap = reductions::r1cs_to_qap<field_type>::instance_map_with_evaluation(key_constraint_system, t);
+    const std::size_t num_inputs = key_constraint_system.num_inputs();
+    const std::size_t num_variables = key_constraint_system.num_variables();
+    progress("QAP evaluated", 0);
+
+    // Scalars of every query
+    std::vector<value_type> gamma_ABC(num_inputs + 1), L(num_variables - num_inputs);
+    parallel_for(num_variables + 1, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const value_type abc = beta * qap.At[i] + alpha * qap.Bt[i] + qap.Ct[i];
+            if (i <= num_inputs) {
+                gamma_ABC[i] = abc * gamma_inverse;
+            } else {
+                L[i - num_inputs - 1] = abc * delta_inverse;
+            }
+        }
+    }, threads);
+
+    // H is of degree d - 2 in Groth16, the reduction gives the powers up to d
+    std::vector<value_type> H(qap.Ht.begin(), qap.Ht.end() - 2);
+    const value_type Zt_over_delta = qap.Zt * delta_inverse;
+    parallel_for(H.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            H[i] = H[i] * Zt_over_delta;
+        }
+    }, threads);
+
+    std::vector<std::uint64_t> B_indices;
+    std::vector<value_type> B;
+    for (std::size_t i = 0; i < qap.Bt.size(); ++i) {
+        if (!qap.Bt[i].is_zero()) {
+            B_indices.push_back(i);
+            B.push_back(qap.Bt[i]);
+        }
+    }
+
+    const g1_value_type g1_generator = algebra::random_element<g1_type>();
+    const g2_value_type g2_generator = algebra::random_element<g2_type>();
+    const std::size_t g1_count = qap.At.size() + B.size() + H.size() + L.size() + gamma_ABC.size();
+    const fixed_base_table<g1_value_type> g1_table(g1_generator, fixed_base_table<g1_value_type>::window_size(g1_count),
+                                                   threads);
+    const fixed_base_table<g2_value_type> g2_table(g2_generator, fixed_base_table<g2_value_type>::window_size(B.size()),
+                                                   threads);
+    progress("fixed-base tables built", 0);
+
+    std::vector<g1_value_type> A_query = fixed_base_batch(g1_table, qap.At, threads);
+    progress("A query", A_query.size());
+
+    knowledge_commitment_vector<g2_type, g1_type> B_query;
+    {
+        std::vector<g2_value_type> B_g = fixed_base_batch(g2_table, B, threads);
+        std::vector<g1_value_type> B_h = fixed_base_batch(g1_table, B, threads);
+        B_query.domain_size_ = qap.Bt.size();
+        B_query.indices = std::move(B_indices);
+        B_query.values.reserve(B.size());
+        for (std::size_t i = 0; i < B.size(); ++i) {
+            B_query.values.emplace_back(B_g[i], B_h[i]);
+        }
+    }
+    progress("B query", B.size());
+
+    std::vector<g1_value_type> H_query = fixed_base_batch(g1_table, H, threads);
+    progress("H query", H_query.size());
+
+    std::vector<g1_value_type> L_query = fixed_base_batch(g1_table, L, threads);
+    progress("L query", L_query.size());
+
+    std::vector<g1_value_type> gamma_ABC_g1 = fixed_base_batch(g1_table, gamma_ABC, threads);
+    g1_value_type gamma_ABC_g1_0 = gamma_ABC_g1.front();
+    gamma_ABC_g1.erase(gamma_ABC_g1.begin());
+
+    g1_value_type alpha_g1 = g1_table.multiply(alpha);
+    g1_value_type beta_g1 = g1_table.multiply(beta);
+    g1_value_type delta_g1 = g1_table.multiply(delta);
+    g2_value_type beta_g2 = g2_table.multiply(beta);
+    g2_value_type delta_g2 = g2_table.multiply(delta);
+    g2_value_type gamma_g2 = g2_table.multiply(gamma);
+
+    // e(alpha, beta) the way the verifier compares it
+    const typename curve_type::gt_type::value_type alpha_g1_beta_g2 = pairing::final_exponentiation(
+        pairing::miller_loop(pairing::precompute_g1(alpha_g1), pairing::precompute_g2(beta_g2)));
+    progress("verification key", gamma_ABC_g1.size() + 1);
+
+    typedef typename scheme_type::verification_key_type verification_key_type;
+    typedef decltype(std::declval<verification_key_type>().gamma_ABC_g1) accumulation_vector_type;
+    verification_key_type verification_key(
+        alpha_g1_beta_g2, gamma_g2, delta_g2,
+        accumulation_vector_type(std::move(gamma_ABC_g1_0), std::move(gamma_ABC_g1)));
+
+    typename scheme_type::proving_key_type proving_key(
+        std::move(alpha_g1), std::move(beta_g1), std::move(beta_g2), std::move(delta_g1), std::move(delta_g2),
+        std::move(A_query), std::move(B_query), std::move(H_query), std::move(L_query),
+        std::move(key_constraint_system));
+
+    return typename scheme_type::keypair_type(std::move(proving_key), std::move(verification_key));
+}
+
+#endif    // CLI_GROTH16_SETUP_HPP
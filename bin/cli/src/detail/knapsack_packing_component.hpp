@@ -1,3 +1,6 @@
+#ifndef CLI_KNAPSACK_PACKING_COMPONENT_HPP
+#define CLI_KNAPSACK_PACKING_COMPONENT_HPP
+
 #include <nil/crypto3/zk/components/hashes/knapsack/knapsack_component.hpp>
 #include <nil/crypto3/zk/components/hashes/hash_io.hpp>
 
@@ -70,3 +73,13 @@ class knapsack_field_packing_component : public component<FieldT> {
       f->generate_r1cs_witness();
   }
 };
+
+// Coefficient of position k of an input_len bit input: the hash of the k-th unit vector
+template<typename FieldT>
+typename FieldT::value_type knapsack_coefficient(std::size_t input_len, std::size_t k) {
+  std::vector<bool> unit(input_len, false);
+  unit[k] = true;
+  return knapsack_crh_with_field_out_component<FieldT>::get_hash(unit)[0];
+}
+
+#endif    // CLI_KNAPSACK_PACKING_COMPONENT_HPP
@@ -0,0 +1,219 @@
+#ifndef CLI_METRICS_HPP
+#define CLI_METRICS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include <sys/resource.h>
+
+#include <boost/filesystem/fstream.hpp>
+
+// Per-phase timing and resource counters. A scoped_timer around a phase adds one sample to the
+// process-wide registry: wall time, process CPU time, heap allocations made meanwhile and the peak
+// RSS seen when the phase ends. CPU time and allocations are process-wide, so phases running
+// concurrently (batch workers, served requests) are charged for each other's work.
+//
+// Allocations are counted by replacing the global operator new, so this header has to be part of
+// every binary that uses it exactly once, like the rest of the headers here.
+
+std::atomic<std::uint64_t> allocation_count(0);
+std::atomic<std::uint64_t> allocation_bytes(0);
+
+void *operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+// Peak resident set of the process in kB
+std::size_t peak_rss_kb() {
+    boost::filesystem::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoul(line.substr(6));
+        }
+    }
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+double process_cpu_ms() {
+    timespec time {};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+}
+
+struct phase_metrics {
+    std::uint64_t count = 0;
+    double wall_ms = 0;
+    double wall_ms_max = 0;
+    double cpu_ms = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t allocated_bytes = 0;
+    std::size_t peak_rss_kb = 0;
+};
+
+class metrics_registry {
+  public:
+    static metrics_registry &instance() {
+        static metrics_registry registry;
+        return registry;
+    }
+
+    void record(const std::string &phase, double wall_ms, double cpu_ms, std::uint64_t allocations,
+                std::uint64_t allocated_bytes, std::size_t rss_kb) {
+        std::lock_guard<std::mutex> lock(mutex);
+        phase_metrics &m = phases[phase];
+        ++m.count;
+        m.wall_ms += wall_ms;
+        m.wall_ms_max = std::max(m.wall_ms_max, wall_ms);
+        m.cpu_ms += cpu_ms;
+        m.allocations += allocations;
+        m.allocated_bytes += allocated_bytes;
+        m.peak_rss_kb = std::max(m.peak_rss_kb, rss_kb);
+    }
+
+    void increment(const std::string &counter, std::uint64_t value = 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters[counter] += value;
+    }
+
+    std::string to_json() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream os;
+        os << "{\n  \"peak_rss_kb\": " << peak_rss_kb() << ",\n  \"phases\": {";
+        const char *separator = "";
+        for (const auto &phase : phases) {
+            const phase_metrics &m = phase.second;
+            os << separator << "\n    \"" << phase.first << "\": {"
+               << "\"count\": " << m.count << ", "
+               << "\"wall_ms\": " << m.wall_ms << ", "
+               << "\"wall_ms_max\": " << m.wall_ms_max << ", "
+               << "\"cpu_ms\": " << m.cpu_ms << ", "
+               << "\"allocations\": " << m.allocations << ", "
+               << "\"allocated_bytes\": " << m.allocated_bytes << ", "
+               << "\"peak_rss_kb\": " << m.peak_rss_kb << "}";
+            separator = ",";
+        }
+        os << "\n  },\n  \"counters\": {";
+        separator = "";
+        for (const auto &counter : counters) {
+            os << separator << "\n    \"" << counter.first << "\": " << counter.second;
+            separator = ",";
+        }
+        os << "\n  }\n}\n";
+        return os.str();
+    }
+
+    // Prometheus text exposition format, phase names become a label
+    std::string to_prometheus() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream os;
+        os << "# TYPE multiscore_phase_count counter\n";
+        for (const auto &phase : phases) {
+            os << "multiscore_phase_count{phase=\"" << phase.first << "\"} " << phase.second.count << "\n";
+        }
+        os << "# TYPE multiscore_phase_wall_seconds_total counter\n";
+        for (const auto &phase : phases) {
+            os << "multiscore_phase_wall_seconds_total{phase=\"" << phase.first << "\"} "
+               << phase.second.wall_ms / 1e3 << "\n";
+        }
+        os << "# TYPE multiscore_phase_wall_seconds_max gauge\n";
+        for (const auto &phase : phases) {
+            os << "multiscore_phase_wall_seconds_max{phase=\"" << phase.first << "\"} "
+               << phase.second.wall_ms_max / 1e3 << "\n";
+        }
+        os << "# TYPE multiscore_phase_cpu_seconds_total counter\n";
+        for (const auto &phase : phases) {
+            os << "multiscore_phase_cpu_seconds_total{phase=\"" << phase.first << "\"} "
+               << phase.second.cpu_ms / 1e3 << "\n";
+        }
+        os << "# TYPE multiscore_phase_allocations_total counter\n";
+        for (const auto &phase : phases) {
+            os << "multiscore_phase_allocations_total{phase=\"" << phase.first << "\"} "
+               << phase.second.allocations << "\n";
+        }
+        os << "# TYPE multiscore_phase_allocated_bytes_total counter\n";
+        for (const auto &phase : phases) {
+            os << "multiscore_phase_allocated_bytes_total{phase=\"" << phase.first << "\"} "
+               << phase.second.allocated_bytes << "\n";
+        }
+        for (const auto &counter : counters) {
+            os << "# TYPE multiscore_" << counter.first << " counter\n";
+            os << "multiscore_" << counter.first << " " << counter.second << "\n";
+        }
+        os << "# TYPE multiscore_peak_rss_bytes gauge\n";
+        os << "multiscore_peak_rss_bytes " << peak_rss_kb() * 1024 << "\n";
+        return os.str();
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::map<std::string, phase_metrics> phases;
+    std::map<std::string, std::uint64_t> counters;
+};
+
+class scoped_timer {
+  public:
+    explicit scoped_timer(std::string phase) :
+        phase(std::move(phase)), wall_started(std::chrono::steady_clock::now()), cpu_started(process_cpu_ms()),
+        allocations_started(allocation_count.load(std::memory_order_relaxed)),
+        bytes_started(allocation_bytes.load(std::memory_order_relaxed)) {
+    }
+
+    scoped_timer(const scoped_timer &) = delete;
+    scoped_timer &operator=(const scoped_timer &) = delete;
+
+    ~scoped_timer() {
+        metrics_registry::instance().record(
+            phase,
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_started).count(),
+            process_cpu_ms() - cpu_started,
+            allocation_count.load(std::memory_order_relaxed) - allocations_started,
+            allocation_bytes.load(std::memory_order_relaxed) - bytes_started,
+            peak_rss_kb());
+    }
+
+  private:
+    std::string phase;
+    std::chrono::steady_clock::time_point wall_started;
+    double cpu_started;
+    std::uint64_t allocations_started;
+    std::uint64_t bytes_started;
+};
+
+#endif    // CLI_METRICS_HPP
@@ -0,0 +1,116 @@
+#ifndef CLI_MULTIEXP_HPP
+#define CLI_MULTIEXP_HPP
+
+#include <array>
+#include <iterator>
+
+#include "../utils.hpp"
+#include "parallel.hpp"
+
+// Bucket (Pippenger) multi-scalar multiplication sum(scalars[i] * bases[i]) for G1 and G2.
+//
+// Scalars are cut into windows of c bits. For every window each base is added to the bucket of its
+// digit, and the buckets are folded with a running sum into sum(digit * bucket); the window sums
+// are then combined with c doublings each. The work is split into (window, chunk of bases) tasks
+// so that all threads stay busy even when there are fewer windows than threads.
+
+typedef std::array<std::uint64_t, 4> scalar_limbs;
+
+static_assert(field_type::modulus_bits <= 256, "scalars have to fit four limbs");
+
+// Canonical (non-Montgomery) little-endian limbs of a scalar
+scalar_limbs to_scalar_limbs(const value_type &scalar) {
+    std::vector<std::uint64_t> words;
+    nil::crypto3::multiprecision::export_bits(typename field_type::integral_type(scalar.data),
+                                              std::back_inserter(words), 64);
+    scalar_limbs limbs {};
+    for (std::size_t i = 0; i < words.size() && i < limbs.size(); ++i) {
+        limbs[i] = words[words.size() - 1 - i];
+    }
+    return limbs;
+}
+
+std::size_t scalar_digit(const scalar_limbs &scalar, std::size_t offset, std::size_t c) {
+    const std::size_t limb = offset / 64;
+    const std::size_t shift = offset % 64;
+    if (limb >= scalar.size()) {
+        return 0;
+    }
+    std::uint64_t digit = scalar[limb] >> shift;
+    if (shift + c > 64 && limb + 1 < scalar.size()) {
+        digit |= scalar[limb + 1] << (64 - shift);
+    }
+    return digit & ((std::uint64_t(1) << c) - 1);
+}
+
+// About ln(count) + 2, the usual optimum of bucket count against additions per window
+std::size_t multiexp_window_size(std::size_t count) {
+    if (count < 32) {
+        return 3;
+    }
+    std::size_t log2_count = 0;
+    while ((std::size_t(1) << (log2_count + 1)) <= count) {
+        ++log2_count;
+    }
+    return log2_count * 69 / 100 + 2;
+}
+
+// bases is any random access iterator over points, so the B query halves can be read in place
+template<typename BaseIterator>
+auto multiexp(BaseIterator bases, const scalar_limbs *scalars, std::size_t count,
+              std::size_t threads = worker_threads) ->
+    typename std::decay<decltype(*bases)>::type {
+    typedef typename std::decay<decltype(*bases)>::type point_type;
+
+    if (count == 0) {
+        return point_type::zero();
+    }
+
+    const std::size_t c = multiexp_window_size(count);
+    const std::size_t windows = (field_type::modulus_bits + c - 1) / c;
+    threads = resolve_threads(threads);
+    const std::size_t chunks = std::min(count, (threads + windows - 1) / windows);
+    const std::size_t chunk_size = (count + chunks - 1) / chunks;
+
+    std::vector<point_type> window_sums(windows * chunks, point_type::zero());
+    parallel_for(
+        windows * chunks,
+        [&](std::size_t task_begin, std::size_t task_end, std::size_t) {
+            std::vector<point_type> buckets((std::size_t(1) << c) - 1);
+            for (std::size_t task = task_begin; task < task_end; ++task) {
+                const std::size_t window = task / chunks;
+                const std::size_t begin = (task % chunks) * chunk_size;
+                const std::size_t end = std::min(count, begin + chunk_size);
+
+                std::fill(buckets.begin(), buckets.end(), point_type::zero());
+                for (std::size_t i = begin; i < end; ++i) {
+                    const std::size_t digit = scalar_digit(scalars[i], window * c, c);
+                    if (digit != 0) {
+                        buckets[digit - 1] = buckets[digit - 1] + bases[i];
+                    }
+                }
+
+                point_type running_sum = point_type::zero();
+                point_type sum = point_type::zero();
+                for (std::size_t b = buckets.size(); b-- > 0;) {
+                    running_sum = running_sum + buckets[b];
+                    sum = sum + running_sum;
+                }
+                window_sums[task] = sum;
+            }
+        },
+        threads);
+
+    point_type result = point_type::zero();
+    for (std::size_t window = windows; window-- > 0;) {
+        for (std::size_t i = 0; i < c; ++i) {
+            result = result.doubled();
+        }
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            result = result + window_sums[window * chunks + chunk];
+        }
+    }
+    return result;
+}
+
+#endif    // CLI_MULTIEXP_HPP
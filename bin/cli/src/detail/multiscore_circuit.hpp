@@ -0,0 +1,230 @@
+#ifndef CLI_MULTISCORE_CIRCUIT_HPP
+#define CLI_MULTISCORE_CIRCUIT_HPP
+
+#include "multiscore_component.hpp"
+#include "r1cs_optimizer.hpp"
+#include "radix2_domain.hpp"
+
+// multiscore compiled once: the constraint system and the variable layout. Nothing in it changes
+// after construction, so a single instance is shared by every witness and every thread.
+//
+// Linear constraints are eliminated from the constraint system first, see r1cs_optimizer.hpp. The
+// layout keeps the indices of the blueprint; witnesses are filled in that layout and reduced to
+// the remaining auxiliary variables on the way out.
+//
+// The constraint system is then padded with empty constraints until the QAP domain (one point per
+// constraint and per input, plus one) is a power of two. Setup then picks the basic radix-2
+// domain, which the prover evaluates on its cached radix2_domain.
+template<typename FieldT>
+class multiscore_circuit {
+  public:
+    explicit multiscore_circuit(multiscore_widths widths = multiscore_widths::wide()) : widths(widths) {
+        blueprint<FieldT> bp;
+        multiscore<FieldT> component(bp, widths);
+        component.verbose = false;
+        component.generate_r1cs_constraints();
+
+        constraint_system = bp.get_constraint_system();
+        layout = component.layout();
+
+        reduction = eliminate_linear_constraints(constraint_system);
+
+        padding_constraints = pad_to_radix2_domain(constraint_system);
+    }
+
+    multiscore_widths widths;
+    r1cs_constraint_system<FieldT> constraint_system;
+    multiscore_layout layout;
+    r1cs_reduction<FieldT> reduction;
+    std::size_t padding_constraints = 0;
+};
+
+// Witness of comparison(x, y) of size n, whose variables start at alpha: alpha_packed = y - x + 2^n
+// at alpha + n, and alpha holds its n + 1 bits with the top one being x <= y. A disjunction over
+// the low n bits gives x < y; alpha + n + 1 and alpha + n + 2 are its flag and inverse. x and y
+// come as integers for the bits and as field elements for alpha_packed. A y outside the comparison
+// leaves the system unsatisfied whatever the bits are; they are taken from alpha_packed modulo
+// 2^(n + 1) then.
+template<typename FieldT>
+void generate_comparison_witness(r1cs_variable_assignment<FieldT> &assignment,
+                                 std::size_t alpha,
+                                 std::size_t n,
+                                 std::size_t less,
+                                 std::size_t less_or_equal,
+                                 std::uint64_t x,
+                                 score_type y,
+                                 const typename FieldT::value_type &x_value,
+                                 const typename FieldT::value_type &y_value) {
+    typedef typename FieldT::value_type field_value_type;
+    assert(n < 63);
+    auto val = [&](std::size_t index) -> field_value_type & { return assignment[index - 1]; };
+
+    const score_type modulus = score_type(1) << (n + 1);
+    score_type alpha_value = ((score_type(1) << n) + y - x) % modulus;
+    if (alpha_value < 0) {
+        alpha_value += modulus;
+    }
+    const std::uint64_t alpha_packed = static_cast<std::uint64_t>(alpha_value);
+    val(alpha + n) = field_value_type(std::uint64_t(1) << n) + y_value - x_value;
+
+    std::size_t low_bits_set = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const bool bit = (alpha_packed >> i) & 1;
+        low_bits_set += bit;
+        val(alpha + i) = bit ? field_value_type::one() : field_value_type::zero();
+    }
+    const bool is_less_or_equal = (alpha_packed >> n) & 1;
+    val(less_or_equal) = is_less_or_equal ? field_value_type::one() : field_value_type::zero();
+
+    if (low_bits_set == 0) {
+        val(alpha + n + 1) = field_value_type::zero();
+        val(alpha + n + 2) = field_value_type::zero();
+    } else {
+        val(alpha + n + 1) = field_value_type::one();
+        val(alpha + n + 2) = field_value_type(low_bits_set).inversed();
+    }
+
+    val(less) = (is_less_or_equal && low_bits_set) ? field_value_type::one() : field_value_type::zero();
+}
+
+// Values of one applicant laid out for a compiled multiscore circuit. Filling it computes the
+// same assignment multiscore::generate_r1cs_witness produces, without a blueprint and without
+// creating any constraint; the buffer is reused across applicants.
+template<typename FieldT>
+class multiscore_witness {
+    typedef typename FieldT::value_type field_value_type;
+
+  public:
+    explicit multiscore_witness(const multiscore_circuit<FieldT> &circuit) :
+        circuit(circuit), assignment(circuit.layout.num_variables, field_value_type::zero()) {
+    }
+
+    void generate_r1cs_witness(uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age,
+                               std::string pa_data_hash, std::string fi_data_hash,
+                               const scoring_policy &policy = scoring_policy()) {
+        scoped_timer timer("generate_r1cs_witness");
+        const multiscore_layout &l = circuit.layout;
+
+        std::vector<bool> pa_id_bv = uint_to_bitvector(pa_id);
+        std::vector<bool> pa_income_bv = uint_to_bitvector(pa_income);
+
+        std::vector<bool> fi_overdue_loans_bv = uint_to_bitvector(fi_overdue_loans);
+        std::vector<bool> fi_account_age_bv = uint_to_bitvector(fi_account_age);
+
+        set_bits(l.PA_id_bits, pa_id_bv);
+        set_bits(l.PA_income_bits, pa_income_bv);
+        set_bits(l.FI_overdue_loans_bits, fi_overdue_loans_bv);
+        set_bits(l.FI_account_age_bits, fi_account_age_bv);
+
+        if (circuit.widths.commitment == multiscore_commitment::poseidon) {
+            priv_hash_pa_data =
+                poseidon_witness(l.PA_data_poseidon, field_value_type(pa_id), field_value_type(pa_income));
+            priv_hash_fi_data = poseidon_witness(l.FI_data_poseidon, field_value_type(fi_overdue_loans),
+                                                 field_value_type(fi_account_age));
+        } else {
+            priv_hash_pa_data = multiscore_commitment_hash(circuit.widths, pa_id, pa_income);
+            priv_hash_fi_data = multiscore_commitment_hash(circuit.widths, fi_overdue_loans, fi_account_age);
+        }
+        pub_hash_pa_data = hex_to_field_element(pa_data_hash);
+        pub_hash_fi_data = hex_to_field_element(fi_data_hash);
+
+        val(l.PRIV_HASH_PA_data) = priv_hash_pa_data;
+        val(l.PUB_HASH_PA_data) = pub_hash_pa_data;
+        val(l.PRIV_HASH_FI_data) = priv_hash_fi_data;
+        val(l.PUB_HASH_FI_data) = pub_hash_fi_data;
+
+        const field_value_type w_pa_income(policy.w_income);
+        const field_value_type w_fi_overdue_loans(policy.w_overdue_loans);
+        const field_value_type w_fi_account_age(policy.w_account_age);
+        const field_value_type score_base(policy.score_base);
+
+        val(l.interm0) = field_value_type(pa_income) * w_pa_income;
+        val(l.interm1) = field_value_type(fi_account_age) * w_fi_account_age;
+        val(l.interm2) = field_value_type(fi_overdue_loans) * field_value_type(fi_overdue_loans);
+        val(l.interm3) = val(l.interm2) * w_fi_overdue_loans;
+        val(l.score) = score_base + val(l.interm0) + val(l.interm1) - val(l.interm3);
+        val(l.score_min) = field_value_type(policy.score_min);
+        score = policy.score(pa_income, fi_overdue_loans, fi_account_age);
+
+        val(l.score_base) = score_base;
+        val(l.W_PA_income) = w_pa_income;
+        val(l.W_FI_overdue_loans) = w_fi_overdue_loans;
+        val(l.W_FI_account_age) = w_fi_account_age;
+
+        val(l.PA_id) = pa_id;
+        val(l.PA_income) = pa_income;
+        val(l.FI_overdue_loans) = fi_overdue_loans;
+        val(l.FI_account_age) = fi_account_age;
+
+        val(l.HASH_PA_validation_result) = field_value_type::zero();
+        val(l.HASH_FI_validation_result) = field_value_type::zero();
+        val(l.out) = 1;
+
+        generate_comparison_witness(assignment, l.comparison_alpha, l.comparison_size, l.score_min_lt, l.score_min_lte,
+                                    policy.score_min, score, val(l.score_min), val(l.score));
+
+        // The chain of the packed public input, once every public value is set
+        for (std::size_t i = 0; i < l.packing_poseidon.size(); ++i) {
+            const field_value_type &digest = i == 0 ? val(l.public_values[0]) : val(l.packing_digests[i - 1]);
+            val(l.packing_digests[i]) = poseidon_witness(l.packing_poseidon[i], digest, val(l.public_values[i + 1]));
+        }
+    }
+
+    r1cs_primary_input<FieldT> primary_input() const {
+        return r1cs_primary_input<FieldT>(assignment.begin(), assignment.begin() + circuit.layout.num_inputs);
+    }
+
+    // Auxiliary input of the compiled, reduced constraint system
+    r1cs_auxiliary_input<FieldT> auxiliary_input() const {
+        return circuit.reduction.reduce(assignment);
+    }
+
+    bool is_satisfied() const {
+        scoped_timer timer("is_satisfied");
+        return circuit.constraint_system.is_satisfied(primary_input(), auxiliary_input());
+    }
+
+    // Same diagnostics multiscore prints while generating its witness
+    void print(std::ostream &os) const {
+        os << "PA data calculated hash: " << field_element_to_hex(priv_hash_pa_data) << std::endl;
+        os << "PA data public hash: " << field_element_to_hex(pub_hash_pa_data) << std::endl;
+
+        os << "FI data calculated hash: " << field_element_to_hex(priv_hash_fi_data) << std::endl;
+        os << "FI data public hash: " << field_element_to_hex(pub_hash_fi_data) << std::endl;
+        os << std::endl;
+
+        os << "Score: " << score << std::endl;
+    }
+
+    const multiscore_circuit<FieldT> &circuit;
+    r1cs_variable_assignment<FieldT> assignment;
+
+    score_type score = 0;
+    field_value_type priv_hash_pa_data, pub_hash_pa_data, priv_hash_fi_data, pub_hash_fi_data;
+
+  private:
+    std::vector<field_value_type> trace;
+
+    field_value_type &val(std::size_t index) {
+        return assignment[index - 1];
+    }
+
+    // bits is a full word from uint_to_bitvector; a compact circuit takes its low end
+    void set_bits(const std::vector<std::size_t> &indices, const std::vector<bool> &bits) {
+        assert(indices.size() <= bits.size());
+        const std::size_t offset = bits.size() - indices.size();
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            val(indices[i]) = bits[offset + i] ? field_value_type::one() : field_value_type::zero();
+        }
+    }
+
+    // Hashes and writes the S-box trace to the variables of the Poseidon component starting at first
+    field_value_type poseidon_witness(std::size_t first, const field_value_type &left, const field_value_type &right) {
+        trace.clear();
+        const field_value_type digest = poseidon_hash(left, right, &trace);
+        std::copy(trace.begin(), trace.end(), assignment.begin() + (first - 1));
+        return digest;
+    }
+};
+
+#endif    // CLI_MULTISCORE_CIRCUIT_HPP
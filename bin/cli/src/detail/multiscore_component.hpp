@@ -1,5 +1,11 @@
+#ifndef CLI_MULTISCORE_COMPONENT_HPP
+#define CLI_MULTISCORE_COMPONENT_HPP
+
+#include <cassert>
 #include <iostream>
 
+#include <boost/multiprecision/cpp_int.hpp>
+
 #include <nil/crypto3/algebra/curves/bls12.hpp>
 #include <nil/crypto3/algebra/fields/bls12/base_field.hpp>
 #include <nil/crypto3/algebra/fields/bls12/scalar_field.hpp>
@@ -18,6 +24,8 @@
 
 #include "../utils.hpp"
 #include "knapsack_packing_component.hpp"
+#include "metrics.hpp"
+#include "poseidon_component.hpp"
 
 using namespace nil::crypto3;
 using namespace nil::crypto3::zk;
@@ -30,6 +38,209 @@ typedef curve_type::scalar_field_type field_type;
 typedef field_type::value_type value_type;
 
 
+// Bit widths of the multiscore attributes. The wide circuit decomposes every attribute into a
+// 256-bit word for the knapsack commitments and leaves the words unconstrained; the compact one
+// decomposes each attribute to its declared width only and range checks it: the bits are boolean
+// and pack to the attribute.
+//
+// Both commit to the same knapsack hash. The commitment is taken over two 256-bit big-endian words
+// and knapsack is linear, so the compact circuit sums the coefficients of the low bits of each word
+// only, which gives the wide hash of any attribute that fits its width. Commitments issued for the
+// wide circuit stay valid; only the keys change.
+//
+// The poseidon circuit commits to the attributes themselves, poseidon_hash(id, income) and
+// poseidon_hash(overdue loans, account age), and decomposes nothing. Its commitments differ from
+// the knapsack ones, so data providers have to issue new hashes (see --commit).
+enum class multiscore_commitment { knapsack, poseidon };
+
+struct multiscore_widths {
+    std::size_t id;
+    std::size_t income;
+    std::size_t overdue_loans;
+    std::size_t account_age;
+
+    // Bits of the score comparison, enough for the largest score the attribute widths allow
+    std::size_t comparison;
+    bool range_checked;
+    multiscore_commitment commitment;
+
+    // Commit the public values to a single public input, see packed_public_input
+    bool packed_inputs = false;
+
+    static multiscore_widths wide() {
+        return {256, 256, 256, 256, 50, false, multiscore_commitment::knapsack};
+    }
+
+    // Attributes are uints; 2^48 bounds the largest score a scoring_policy allows
+    static multiscore_widths compact() {
+        return {32, 32, 32, 32, 48, true, multiscore_commitment::knapsack};
+    }
+
+    static multiscore_widths poseidon() {
+        return {0, 0, 0, 0, 48, false, multiscore_commitment::poseidon};
+    }
+};
+
+bool parse_circuit_variant(const std::string &name, multiscore_widths &widths) {
+    if (name == "wide") {
+        widths = multiscore_widths::wide();
+    } else if (name == "compact") {
+        widths = multiscore_widths::compact();
+    } else if (name == "poseidon") {
+        widths = multiscore_widths::poseidon();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Lender's scoring policy: score = score_base + income * w_income + account_age * w_account_age
+// - overdue_loans^2 * w_overdue_loans, accepted when score_min <= score. All five values are public
+// inputs, so one setup serves every policy and a verifier reads the policy a proof was made under
+// from its primary input.
+//
+// The bounds keep every score of uint attributes below 2^48, inside the score comparison of all
+// circuit variants: 2^32 + 2 * 2^32 * 2^14 < 2^48. Scores below zero wrap around in the field and
+// fail the comparison.
+typedef boost::multiprecision::int128_t score_type;
+
+struct scoring_policy {
+    static constexpr std::uint64_t max_weight = std::uint64_t(1) << 14;
+    static constexpr std::uint64_t max_score = 0xffffffff;
+
+    std::uint64_t score_base = 100000;
+    std::uint64_t score_min = 70000;
+    std::uint64_t w_income = 1;
+    std::uint64_t w_overdue_loans = 10000;
+    std::uint64_t w_account_age = 5000;
+
+    bool validate(std::string &error) const {
+        if (score_base > max_score || score_min > max_score) {
+            error = "score_base and score_min must be below 2^32";
+            return false;
+        }
+        if (w_income > max_weight || w_overdue_loans > max_weight || w_account_age > max_weight) {
+            error = "weights must not exceed 2^14";
+            return false;
+        }
+        return true;
+    }
+
+    score_type score(uint income, uint overdue_loans, uint account_age) const {
+        return score_type(score_base) + score_type(income) * w_income + score_type(account_age) * w_account_age -
+               score_type(overdue_loans) * overdue_loans * w_overdue_loans;
+    }
+
+    bool operator==(const scoring_policy &other) const {
+        return score_base == other.score_base && score_min == other.score_min && w_income == other.w_income &&
+               w_overdue_loans == other.w_overdue_loans && w_account_age == other.w_account_age;
+    }
+};
+
+// Commitment to a pair of attributes as the circuit variant computes it
+value_type multiscore_commitment_hash(const multiscore_widths &widths, uint left, uint right) {
+    if (widths.commitment == multiscore_commitment::poseidon) {
+        return poseidon_hash(value_type(left), value_type(right));
+    }
+    return knapsack_crh_with_field_out_component<field_type>::get_hash(
+        merge_vectors(uint_to_bitvector(left), uint_to_bitvector(right)))[0];
+}
+
+// Public values of an accepted applicant in the order the circuit packs them: the policy, the
+// published data hashes, both validation results (zero) and out (one)
+std::vector<value_type> multiscore_public_values(const scoring_policy &policy, const value_type &pub_hash_pa_data,
+                                                 const value_type &pub_hash_fi_data) {
+    return {value_type(policy.score_base), value_type(policy.score_min), pub_hash_pa_data, pub_hash_fi_data,
+            value_type::zero(), value_type::zero(), value_type::one(), value_type(policy.w_income),
+            value_type(policy.w_overdue_loans), value_type(policy.w_account_age)};
+}
+
+// Poseidon chain over the values: h = poseidon_hash(v0, v1), then h = poseidon_hash(h, v) for the
+// rest. With --pack-inputs the circuit computes this chain over its public values and exposes
+// only the result, so the verifier accumulates one input instead of ten, and the verification key
+// and the primary input shrink to match. The verifier no longer reads the values from the primary
+// input; it recomputes the one element from the values it expects.
+value_type pack_public_values(const std::vector<value_type> &values) {
+    assert(values.size() >= 2);
+    value_type packed = poseidon_hash(values[0], values[1]);
+    for (std::size_t i = 2; i < values.size(); ++i) {
+        packed = poseidon_hash(packed, values[i]);
+    }
+    return packed;
+}
+
+// The primary input of a packed circuit for an applicant accepted under policy with these hashes
+r1cs_primary_input<field_type> packed_public_input(const scoring_policy &policy, const value_type &pub_hash_pa_data,
+                                                   const value_type &pub_hash_fi_data) {
+    return r1cs_primary_input<field_type>(
+        1, pack_public_values(multiscore_public_values(policy, pub_hash_pa_data, pub_hash_fi_data)));
+}
+
+// Variable indices of a multiscore blueprint once its constraints are generated. Index 0 is the
+// constant one, so the value of index i lives at position i - 1 of the full variable assignment.
+struct multiscore_layout {
+    std::size_t num_inputs = 0;
+    std::size_t num_variables = 0;
+
+    std::size_t out, score_base, score_min, score, score_min_lt, score_min_lte;
+    std::size_t W_PA_income, W_FI_overdue_loans, W_FI_account_age;
+    std::size_t PA_id, PA_income, FI_overdue_loans, FI_account_age;
+    std::size_t PRIV_HASH_PA_data, PUB_HASH_PA_data, PRIV_HASH_FI_data, PUB_HASH_FI_data;
+    std::size_t HASH_PA_validation_result, HASH_FI_validation_result;
+    std::size_t interm0, interm1, interm2, interm3;
+
+    // Bit decompositions feeding the knapsack commitments, most significant bit first. The wide
+    // circuit has all 256 bits of each word, the compact one the low bits of its width.
+    std::vector<std::size_t> PA_id_bits, PA_income_bits, FI_overdue_loans_bits, FI_account_age_bits;
+
+    // First S-box variable of each Poseidon commitment, 0 for knapsack commitments
+    std::size_t PA_data_poseidon = 0, FI_data_poseidon = 0;
+
+    // Packed public input, 0 unless the inputs are packed. The public values are then auxiliary,
+    // and the chain has one Poseidon component and one digest per value after the first; the last
+    // digest is packed_inputs itself.
+    std::size_t packed_inputs = 0;
+    std::vector<std::size_t> public_values;
+    std::vector<std::size_t> packing_poseidon, packing_digests;
+
+    // Variables allocated by the score_min comparison component: alpha bits, alpha packed,
+    // not-all-zeros flag and the inverse used by its disjunction
+    std::size_t comparison_size;
+    std::size_t comparison_alpha;
+    std::size_t comparison_alpha_packed;
+    std::size_t comparison_not_all_zeros;
+    std::size_t comparison_not_all_zeros_inv;
+};
+
+// Whether a primary input of the circuit states an applicant accepted under policy with matching
+// data hashes; a verifier checks this next to the proof itself. The circuit also proves rejected
+// applicants (out = 0) and mismatching hashes, so out and both validation results are checked
+// like the policy. A packed primary input does not show the values, see packed_public_input.
+bool primary_input_has_policy(const multiscore_layout &l, const r1cs_primary_input<field_type> &primary_input,
+                              const scoring_policy &policy) {
+    if (l.packed_inputs || primary_input.size() != l.num_inputs) {
+        return false;
+    }
+    return primary_input[l.score_base - 1] == value_type(policy.score_base) &&
+           primary_input[l.score_min - 1] == value_type(policy.score_min) &&
+           primary_input[l.W_PA_income - 1] == value_type(policy.w_income) &&
+           primary_input[l.W_FI_overdue_loans - 1] == value_type(policy.w_overdue_loans) &&
+           primary_input[l.W_FI_account_age - 1] == value_type(policy.w_account_age) &&
+           primary_input[l.HASH_PA_validation_result - 1] == value_type::zero() &&
+           primary_input[l.HASH_FI_validation_result - 1] == value_type::zero() &&
+           primary_input[l.out - 1] == value_type::one();
+}
+
+// The same for the published data hashes of one applicant, the statement packed_public_input
+// commits to
+bool primary_input_has_policy(const multiscore_layout &l, const r1cs_primary_input<field_type> &primary_input,
+                              const scoring_policy &policy, const value_type &pub_hash_pa_data,
+                              const value_type &pub_hash_fi_data) {
+    return primary_input_has_policy(l, primary_input, policy) &&
+           primary_input[l.PUB_HASH_PA_data - 1] == pub_hash_pa_data &&
+           primary_input[l.PUB_HASH_FI_data - 1] == pub_hash_fi_data;
+}
+
 
 template<typename FieldT>
 class multiscore : public component<FieldT> {
@@ -64,6 +275,7 @@ class multiscore : public component<FieldT> {
     blueprint_variable<FieldT> PUB_HASH_FI_data;
 
     // Intermediate variables
+    blueprint_variable<FieldT> interm0;
     blueprint_variable<FieldT> interm1;
     blueprint_variable<FieldT> interm2;
     blueprint_variable<FieldT> interm3;
@@ -77,13 +289,42 @@ class multiscore : public component<FieldT> {
     std::shared_ptr<digest_variable<FieldT>> bits_FI_overdue_loans;
     std::shared_ptr<digest_variable<FieldT>> bits_FI_account_age;
 
+    // Range checked decompositions of the compact circuit
+    blueprint_variable_vector<FieldT> PA_id_bits;
+    blueprint_variable_vector<FieldT> PA_income_bits;
+    blueprint_variable_vector<FieldT> FI_overdue_loans_bits;
+    blueprint_variable_vector<FieldT> FI_account_age_bits;
+
     std::shared_ptr<comparison<FieldT>> score_min_comparator;
 
     std::shared_ptr<knapsack_field_packing_component<FieldT>> pa_data_knapsack;
     std::shared_ptr<knapsack_field_packing_component<FieldT>> fi_data_knapsack;
 
-  multiscore(blueprint<FieldT> &bp): component<FieldT>(bp) {
-    // Public inputs
+    std::shared_ptr<poseidon_component<FieldT>> pa_data_poseidon;
+    std::shared_ptr<poseidon_component<FieldT>> fi_data_poseidon;
+
+    // Single public input of the packed circuit and the chain computing it
+    blueprint_variable<FieldT> packed_inputs;
+    blueprint_variable_vector<FieldT> packing_digests;
+    std::vector<std::shared_ptr<poseidon_component<FieldT>>> public_packing;
+
+    // Print constraint counts, hashes and the score while generating
+    bool verbose = true;
+
+    // Width of the words the knapsack commitments are taken over
+    static constexpr std::size_t commitment_word_bits = 256;
+
+    const multiscore_widths widths;
+    const std::size_t comparison_size;
+    std::size_t comparator_first_variable = 0;
+
+  multiscore(blueprint<FieldT> &bp, multiscore_widths widths = multiscore_widths::wide()) :
+    component<FieldT>(bp), widths(widths), comparison_size(widths.comparison) {
+    if (widths.packed_inputs) {
+      packed_inputs.allocate(this->bp);
+    }
+
+    // Public inputs, unless packed
     score_base.allocate(this->bp);
     score_min.allocate(this->bp);
 
@@ -94,7 +335,7 @@ class multiscore : public component<FieldT> {
     HASH_FI_validation_result.allocate(this->bp);
     out.allocate(this->bp);
 
-    // Weights
+    // Weights, public inputs as well
     W_PA_income.allocate(this->bp);
     W_FI_overdue_loans.allocate(this->bp);
     W_FI_account_age.allocate(this->bp);
@@ -111,6 +352,7 @@ class multiscore : public component<FieldT> {
     PRIV_HASH_FI_data.allocate(this->bp);
 
     // Intermediate variables
+    interm0.allocate(this->bp);
     interm1.allocate(this->bp);
     interm2.allocate(this->bp);
     interm3.allocate(this->bp);
@@ -120,7 +362,18 @@ class multiscore : public component<FieldT> {
 
     score.allocate(this->bp);
 
-    this->bp.set_input_sizes(7);
+    this->bp.set_input_sizes(widths.packed_inputs ? 1 : 10);
+  }
+
+  // The values packed_public_input commits to, in its order
+  blueprint_variable_vector<FieldT> public_values() const {
+    blueprint_variable_vector<FieldT> values;
+    for (const blueprint_variable<FieldT> &value : {score_base, score_min, PUB_HASH_PA_data, PUB_HASH_FI_data,
+                                                    HASH_PA_validation_result, HASH_FI_validation_result, out,
+                                                    W_PA_income, W_FI_overdue_loans, W_FI_account_age}) {
+      values.emplace_back(value);
+    }
+    return values;
   }
 
 
@@ -129,52 +382,151 @@ class multiscore : public component<FieldT> {
 
 
   void generate_r1cs_constraints() {
+    scoped_timer timer("generate_r1cs_constraints");
+    comparator_first_variable = this->bp.num_variables() + 1;
     score_min_comparator.reset(new comparison<FieldT>(this->bp,
-      50, // size
+      comparison_size, // size
       score_min, // X
       score, // Y
       score_min_lt, // X > Y
       score_min_lte)); // X >= Y
+    // The native witness in multiscore_circuit.hpp relies on this allocation layout
+    assert(this->bp.num_variables() + 1 - comparator_first_variable == comparison_size + 3);
     score_min_comparator.get()->generate_r1cs_constraints();
 
     // Ensure score validity
+    this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(PA_income, W_PA_income, interm0));
     this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(FI_account_age, W_FI_account_age, interm1));
     this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(FI_overdue_loans, FI_overdue_loans, interm2));
     this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(interm2, W_FI_overdue_loans, interm3));
-    this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(score_base + PA_income + interm1 - interm3, 1, score));
+    this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(score_base + interm0 + interm1 - interm3, 1, score));
 
     // Check comparison
     this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(score_min_lte, 1, out));
 
-    digest_PA_id.reset(new digest_variable(this->bp, 256));
-    digest_PA_income.reset(new digest_variable(this->bp, 256));
-    bits_FI_overdue_loans.reset(new digest_variable(this->bp, 256));
-    bits_FI_account_age.reset(new digest_variable(this->bp, 256));
-
-    pa_data_knapsack.reset(new knapsack_field_packing_component<FieldT>(this->bp,
-          256 * 2,
-          *digest_PA_id,
-          *digest_PA_income,
-          blueprint_variable_vector<FieldT>(1, PRIV_HASH_PA_data)));
-    pa_data_knapsack.get()->generate_r1cs_constraints();
-
-    fi_data_knapsack.reset(new knapsack_field_packing_component<FieldT>(this->bp,
-          256 * 2,
-          *bits_FI_overdue_loans,
-          *bits_FI_account_age,
-          blueprint_variable_vector<FieldT>(1, PRIV_HASH_FI_data)));
-    fi_data_knapsack.get()->generate_r1cs_constraints();
+    if (widths.commitment == multiscore_commitment::poseidon) {
+      pa_data_poseidon.reset(new poseidon_component<FieldT>(this->bp, PA_id, PA_income, PRIV_HASH_PA_data));
+      pa_data_poseidon.get()->generate_r1cs_constraints();
+
+      fi_data_poseidon.reset(new poseidon_component<FieldT>(this->bp, FI_overdue_loans, FI_account_age, PRIV_HASH_FI_data));
+      fi_data_poseidon.get()->generate_r1cs_constraints();
+    } else if (widths.range_checked) {
+      generate_range_check(PA_id, PA_id_bits, widths.id);
+      generate_range_check(PA_income, PA_income_bits, widths.income);
+      generate_range_check(FI_overdue_loans, FI_overdue_loans_bits, widths.overdue_loans);
+      generate_range_check(FI_account_age, FI_account_age_bits, widths.account_age);
+
+      this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(1, knapsack_sum(PA_id_bits, PA_income_bits), PRIV_HASH_PA_data));
+      this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(1, knapsack_sum(FI_overdue_loans_bits, FI_account_age_bits), PRIV_HASH_FI_data));
+    } else {
+      digest_PA_id.reset(new digest_variable(this->bp, 256));
+      digest_PA_income.reset(new digest_variable(this->bp, 256));
+      bits_FI_overdue_loans.reset(new digest_variable(this->bp, 256));
+      bits_FI_account_age.reset(new digest_variable(this->bp, 256));
+
+      pa_data_knapsack.reset(new knapsack_field_packing_component<FieldT>(this->bp,
+            256 * 2,
+            *digest_PA_id,
+            *digest_PA_income,
+            blueprint_variable_vector<FieldT>(1, PRIV_HASH_PA_data)));
+      pa_data_knapsack.get()->generate_r1cs_constraints();
+
+      fi_data_knapsack.reset(new knapsack_field_packing_component<FieldT>(this->bp,
+            256 * 2,
+            *bits_FI_overdue_loans,
+            *bits_FI_account_age,
+            blueprint_variable_vector<FieldT>(1, PRIV_HASH_FI_data)));
+      fi_data_knapsack.get()->generate_r1cs_constraints();
+    }
 
     this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(PRIV_HASH_PA_data - PUB_HASH_PA_data, 1, HASH_PA_validation_result));
 
     this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(PRIV_HASH_FI_data - PUB_HASH_FI_data, 1, HASH_FI_validation_result));
 
-    std::cout << "Constraints: " << this->bp.num_constraints() << std::endl;
+    if (widths.packed_inputs) {
+      generate_packing_constraints();
+    }
+
+    if (verbose) {
+      std::cout << "Constraints: " << this->bp.num_constraints() << std::endl;
+    }
   }
 
 
 
-  void generate_r1cs_witness(uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age, std::string pa_data_hash, std::string fi_data_hash) {
+  // Only valid after generate_r1cs_constraints()
+  multiscore_layout layout() const {
+    multiscore_layout l;
+    l.num_inputs = this->bp.num_inputs();
+    l.num_variables = this->bp.num_variables();
+
+    l.out = out.index;
+    l.score_base = score_base.index;
+    l.score_min = score_min.index;
+    l.score = score.index;
+    l.score_min_lt = score_min_lt.index;
+    l.score_min_lte = score_min_lte.index;
+    l.W_PA_income = W_PA_income.index;
+    l.W_FI_overdue_loans = W_FI_overdue_loans.index;
+    l.W_FI_account_age = W_FI_account_age.index;
+    l.PA_id = PA_id.index;
+    l.PA_income = PA_income.index;
+    l.FI_overdue_loans = FI_overdue_loans.index;
+    l.FI_account_age = FI_account_age.index;
+    l.PRIV_HASH_PA_data = PRIV_HASH_PA_data.index;
+    l.PUB_HASH_PA_data = PUB_HASH_PA_data.index;
+    l.PRIV_HASH_FI_data = PRIV_HASH_FI_data.index;
+    l.PUB_HASH_FI_data = PUB_HASH_FI_data.index;
+    l.HASH_PA_validation_result = HASH_PA_validation_result.index;
+    l.HASH_FI_validation_result = HASH_FI_validation_result.index;
+    l.interm0 = interm0.index;
+    l.interm1 = interm1.index;
+    l.interm2 = interm2.index;
+    l.interm3 = interm3.index;
+
+    if (widths.commitment == multiscore_commitment::poseidon) {
+      l.PA_data_poseidon = pa_data_poseidon->first_variable();
+      l.FI_data_poseidon = fi_data_poseidon->first_variable();
+    } else {
+      const bool range_checked = widths.range_checked;
+      for (const auto &bit : range_checked ? PA_id_bits : digest_PA_id->bits) {
+        l.PA_id_bits.push_back(bit.index);
+      }
+      for (const auto &bit : range_checked ? PA_income_bits : digest_PA_income->bits) {
+        l.PA_income_bits.push_back(bit.index);
+      }
+      for (const auto &bit : range_checked ? FI_overdue_loans_bits : bits_FI_overdue_loans->bits) {
+        l.FI_overdue_loans_bits.push_back(bit.index);
+      }
+      for (const auto &bit : range_checked ? FI_account_age_bits : bits_FI_account_age->bits) {
+        l.FI_account_age_bits.push_back(bit.index);
+      }
+    }
+
+    if (widths.packed_inputs) {
+      l.packed_inputs = packed_inputs.index;
+      for (const auto &value : public_values()) {
+        l.public_values.push_back(value.index);
+      }
+      for (std::size_t i = 0; i < public_packing.size(); ++i) {
+        l.packing_poseidon.push_back(public_packing[i]->first_variable());
+        l.packing_digests.push_back(i + 1 < public_packing.size() ? packing_digests[i].index : packed_inputs.index);
+      }
+    }
+
+    // comparison allocates alpha[0..n), alpha_packed, not_all_zeros and the disjunction inverse
+    l.comparison_size = comparison_size;
+    l.comparison_alpha = comparator_first_variable;
+    l.comparison_alpha_packed = comparator_first_variable + comparison_size;
+    l.comparison_not_all_zeros = comparator_first_variable + comparison_size + 1;
+    l.comparison_not_all_zeros_inv = comparator_first_variable + comparison_size + 2;
+
+    return l;
+  }
+
+  void generate_r1cs_witness(uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age, std::string pa_data_hash, std::string fi_data_hash,
+                             const scoring_policy &policy = scoring_policy()) {
+    scoped_timer timer("generate_r1cs_witness");
 
     std::vector<bool> pa_id_bv = uint_to_bitvector(pa_id);
     std::vector<bool> pa_income_bv = uint_to_bitvector(pa_income);
@@ -182,19 +534,25 @@ class multiscore : public component<FieldT> {
     std::vector<bool> fi_overdue_loans_bv = uint_to_bitvector(fi_overdue_loans);
     std::vector<bool> fi_account_age_bv = uint_to_bitvector(fi_account_age);
 
-    std::vector<bool> pa_data_bv = merge_vectors(pa_id_bv, pa_income_bv);
-    std::vector<bool> fi_data_bv = merge_vectors(fi_overdue_loans_bv, fi_account_age_bv);
-
-    digest_PA_id.get()->generate_r1cs_witness(pa_id_bv);
-    digest_PA_income.get()->generate_r1cs_witness(pa_income_bv);
+    if (widths.commitment == multiscore_commitment::poseidon) {
+      // The Poseidon components read the attributes, they are filled in once those are set
+    } else if (widths.range_checked) {
+      generate_bits_witness(PA_id_bits, pa_id_bv);
+      generate_bits_witness(PA_income_bits, pa_income_bv);
+      generate_bits_witness(FI_overdue_loans_bits, fi_overdue_loans_bv);
+      generate_bits_witness(FI_account_age_bits, fi_account_age_bv);
+    } else {
+      digest_PA_id.get()->generate_r1cs_witness(pa_id_bv);
+      digest_PA_income.get()->generate_r1cs_witness(pa_income_bv);
 
-    bits_FI_overdue_loans.get()->generate_r1cs_witness(fi_overdue_loans_bv);
-    bits_FI_account_age.get()->generate_r1cs_witness(fi_account_age_bv);
+      bits_FI_overdue_loans.get()->generate_r1cs_witness(fi_overdue_loans_bv);
+      bits_FI_account_age.get()->generate_r1cs_witness(fi_account_age_bv);
 
-    pa_data_knapsack.get()->generate_r1cs_witness();
+      pa_data_knapsack.get()->generate_r1cs_witness();
+    }
 
     // Set private hash of Public Agency data
-    value_type _PRIV_HASH_PA_data = knapsack_crh_with_field_out_component<FieldT>::get_hash(pa_data_bv)[0];
+    value_type _PRIV_HASH_PA_data = multiscore_commitment_hash(widths, pa_id, pa_income);
     this->bp.val(PRIV_HASH_PA_data) = _PRIV_HASH_PA_data;
 
     // Set public hash of Public Agency data (public input)
@@ -202,57 +560,58 @@ class multiscore : public component<FieldT> {
     this->bp.val(PUB_HASH_PA_data) = _PUB_HASH_PA_data;
 
     // Set private hash of Financial Institution's data
-    value_type _PRIV_HASH_FI_data = knapsack_crh_with_field_out_component<FieldT>::get_hash(fi_data_bv)[0];
+    value_type _PRIV_HASH_FI_data = multiscore_commitment_hash(widths, fi_overdue_loans, fi_account_age);
     this->bp.val(PRIV_HASH_FI_data) = _PRIV_HASH_FI_data;
 
     // Set public hash of Financial Institution's data (public input)
     value_type _PUB_HASH_FI_data = hex_to_field_element(fi_data_hash);
     this->bp.val(PUB_HASH_FI_data) = _PUB_HASH_FI_data;
 
-    std::cout << "PA data calculated hash: " << field_element_to_hex(_PRIV_HASH_PA_data) << std::endl;
-    std::cout << "PA data public hash: " << field_element_to_hex(_PUB_HASH_PA_data) << std::endl;
+    if (verbose) {
+      std::cout << "PA data calculated hash: " << field_element_to_hex(_PRIV_HASH_PA_data) << std::endl;
+      std::cout << "PA data public hash: " << field_element_to_hex(_PUB_HASH_PA_data) << std::endl;
 
-    std::cout << "FI data calculated hash: " << field_element_to_hex(_PRIV_HASH_FI_data) << std::endl;
-    std::cout << "FI data public hash: " << field_element_to_hex(_PUB_HASH_FI_data) << std::endl;
-    std::cout << std::endl;
+      std::cout << "FI data calculated hash: " << field_element_to_hex(_PRIV_HASH_FI_data) << std::endl;
+      std::cout << "FI data public hash: " << field_element_to_hex(_PUB_HASH_FI_data) << std::endl;
+      std::cout << std::endl;
+    }
 
     // ------------------------------------------------------------------------------------------------------
     // ------------------------------------------------------------------------------------------------------
 
-    uint _w_fi_overdue_loans = 10000;
-    uint _w_fi_account_age = 5000;
-    uint _score_base = 100000;
-
-    uint _interm1 = fi_account_age * _w_fi_account_age;
-    uint _interm2 = fi_overdue_loans * fi_overdue_loans;
-    uint _interm3 = _interm2 * _w_fi_overdue_loans;
-    uint _score = _score_base + pa_income + _interm1 - _interm3;
-
-    /* std::cout << "_w_fi_overdue_loans: " << _w_fi_overdue_loans << std::endl; */
-    /* std::cout << "_w_fi_account_age: " << _w_fi_account_age << std::endl; */
-    /* std::cout << "_score_base: " << _score_base << std::endl; */
-
-    std::cout << "ID: " << pa_id << std::endl;
-    std::cout << "Income: " << pa_income << std::endl;
-    std::cout << "Account_age: " << fi_account_age << std::endl;
-    std::cout << "Overdue loans: " << fi_overdue_loans << std::endl;
-    std::cout << std::endl;
-
-    /* std::cout << "interm1: " << _interm1 << std::endl; */
-    /* std::cout << "interm2: " << _interm2 << std::endl; */
-    /* std::cout << "interm3: " << _interm3 << std::endl; */
-
-    std::cout << "Score: " << _score << std::endl;
-
+    // Field values are exact; the integer score is for display
+    value_type _w_pa_income = value_type(policy.w_income);
+    value_type _w_fi_overdue_loans = value_type(policy.w_overdue_loans);
+    value_type _w_fi_account_age = value_type(policy.w_account_age);
+    value_type _score_base = value_type(policy.score_base);
+
+    value_type _interm0 = value_type(pa_income) * _w_pa_income;
+    value_type _interm1 = value_type(fi_account_age) * _w_fi_account_age;
+    value_type _interm2 = value_type(fi_overdue_loans) * value_type(fi_overdue_loans);
+    value_type _interm3 = _interm2 * _w_fi_overdue_loans;
+    value_type _score = _score_base + _interm0 + _interm1 - _interm3;
+
+    if (verbose) {
+      std::cout << "ID: " << pa_id << std::endl;
+      std::cout << "Income: " << pa_income << std::endl;
+      std::cout << "Account_age: " << fi_account_age << std::endl;
+      std::cout << "Overdue loans: " << fi_overdue_loans << std::endl;
+      std::cout << std::endl;
+
+      std::cout << "Score: " << policy.score(pa_income, fi_overdue_loans, fi_account_age) << std::endl;
+    }
+
+    this->bp.val(interm0) = _interm0;
     this->bp.val(interm1) = _interm1;
     this->bp.val(interm2) = _interm2;
     this->bp.val(interm3) = _interm3;
 
     this->bp.val(score) = _score;
 
-    this->bp.val(score_min) = 70000;
+    this->bp.val(score_min) = value_type(policy.score_min);
 
     this->bp.val(score_base) = _score_base;
+    this->bp.val(W_PA_income) = _w_pa_income;
     this->bp.val(W_FI_overdue_loans) = _w_fi_overdue_loans;
     this->bp.val(W_FI_account_age) = _w_fi_account_age;
 
@@ -266,5 +625,67 @@ class multiscore : public component<FieldT> {
     this->bp.val(out) = 1;
 
     score_min_comparator.get()->generate_r1cs_witness();
+
+    if (widths.commitment == multiscore_commitment::poseidon) {
+      pa_data_poseidon.get()->generate_r1cs_witness();
+      fi_data_poseidon.get()->generate_r1cs_witness();
+    }
+
+    // In chain order, every digest feeds the next component
+    for (const auto &packing : public_packing) {
+      packing.get()->generate_r1cs_witness();
+    }
+  }
+
+ private:
+  // packed_inputs = pack_public_values(public_values()), one Poseidon hash per value after the first
+  void generate_packing_constraints() {
+    const blueprint_variable_vector<FieldT> values = public_values();
+    packing_digests.allocate(this->bp, values.size() - 2);
+
+    blueprint_variable<FieldT> digest = values[0];
+    for (std::size_t i = 1; i < values.size(); ++i) {
+      const blueprint_variable<FieldT> &next = i + 1 < values.size() ? packing_digests[i - 1] : packed_inputs;
+      public_packing.emplace_back(new poseidon_component<FieldT>(this->bp, digest, values[i], next));
+      public_packing.back().get()->generate_r1cs_constraints();
+      digest = next;
+    }
+  }
+
+  // width boolean bits, most significant first, packing to value
+  void generate_range_check(const blueprint_variable<FieldT> &value, blueprint_variable_vector<FieldT> &bits,
+                            std::size_t width) {
+    assert(width <= commitment_word_bits);
+    bits.allocate(this->bp, width);
+
+    linear_combination<FieldT> packed;
+    for (std::size_t i = 0; i < width; ++i) {
+      this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(bits[i], 1 - bits[i], 0));
+      packed.add_term(bits[i], typename FieldT::value_type(2).pow(width - 1 - i));
+    }
+    this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(packed, 1, value));
+  }
+
+  // The wide knapsack over the words left || right, with each word reduced to its low bits
+  linear_combination<FieldT> knapsack_sum(const blueprint_variable_vector<FieldT> &left,
+                                          const blueprint_variable_vector<FieldT> &right) const {
+    linear_combination<FieldT> sum;
+    for (std::size_t i = 0; i < left.size(); ++i) {
+      sum.add_term(left[i], knapsack_coefficient<FieldT>(2 * commitment_word_bits, commitment_word_bits - left.size() + i));
+    }
+    for (std::size_t i = 0; i < right.size(); ++i) {
+      sum.add_term(right[i], knapsack_coefficient<FieldT>(2 * commitment_word_bits, 2 * commitment_word_bits - right.size() + i));
+    }
+    return sum;
+  }
+
+  // bv is a full word from uint_to_bitvector, bits take its low end
+  void generate_bits_witness(const blueprint_variable_vector<FieldT> &bits, const std::vector<bool> &bv) {
+    const std::size_t offset = bv.size() - bits.size();
+    for (std::size_t i = 0; i < bits.size(); ++i) {
+      this->bp.val(bits[i]) = bv[offset + i] ? FieldT::value_type::one() : FieldT::value_type::zero();
+    }
   }
 };
+
+#endif    // CLI_MULTISCORE_COMPONENT_HPP
@@ -0,0 +1,37 @@
+#ifndef CLI_PARALLEL_HPP
+#define CLI_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Thread count used when a caller does not ask for one; 0 is one per core. Set by --threads.
+std::size_t worker_threads = 0;
+
+std::size_t resolve_threads(std::size_t threads = worker_threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return threads;
+}
+
+// Splits [0, count) into one contiguous chunk per thread and calls f(begin, end, chunk) on each.
+// The calling thread runs the last chunk itself.
+template<typename Function>
+void parallel_for(std::size_t count, Function f, std::size_t threads = worker_threads) {
+    threads = std::min(resolve_threads(threads), std::max<std::size_t>(count, 1));
+    const std::size_t chunk = (count + threads - 1) / threads;
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t + 1 < threads; ++t) {
+        workers.emplace_back(f, t * chunk, std::min(count, (t + 1) * chunk), t);
+    }
+    f(std::min(count, (threads - 1) * chunk), count, threads - 1);
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+#endif    // CLI_PARALLEL_HPP
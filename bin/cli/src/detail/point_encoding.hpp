@@ -0,0 +1,280 @@
+#ifndef CLI_POINT_ENCODING_HPP
+#define CLI_POINT_ENCODING_HPP
+
+#include <atomic>
+#include <random>
+#include <type_traits>
+
+#include "../utils.hpp"
+#include "parallel.hpp"
+
+// Compressed BLS12-381 points in the usual ZCash layout: the big-endian x coordinate (x.c1 || x.c0
+// for G2) with the three top bits of the first byte holding the compression, infinity and
+// "y is the lexicographically largest root" flags. Decoding recomputes y with a square root.
+
+typedef typename curve_type::g1_type::value_type g1_value_type;
+typedef typename curve_type::g2_type::value_type g2_value_type;
+typedef typename curve_type::base_field_type base_field_type;
+typedef typename base_field_type::value_type fp_value_type;
+typedef typename base_field_type::integral_type fp_integral_type;
+typedef typename g2_value_type::underlying_field_value_type fp2_value_type;
+
+constexpr const std::size_t fp_bytes = 48;
+constexpr const std::size_t compressed_g1_size = fp_bytes;
+constexpr const std::size_t compressed_g2_size = 2 * fp_bytes;
+
+constexpr const unsigned char point_flag_compressed = 0x80;
+constexpr const unsigned char point_flag_infinity = 0x40;
+constexpr const unsigned char point_flag_y_largest = 0x20;
+constexpr const unsigned char point_flags = point_flag_compressed | point_flag_infinity | point_flag_y_largest;
+
+void fp_to_bytes(const fp_value_type &x, unsigned char *out) {
+    std::vector<unsigned char> bytes;
+    nil::crypto3::multiprecision::export_bits(fp_integral_type(x.data), std::back_inserter(bytes), 8);
+    std::fill(out, out + fp_bytes - bytes.size(), 0);
+    std::copy(bytes.begin(), bytes.end(), out + fp_bytes - bytes.size());
+}
+
+// Flag bits have to be masked by the caller; fails on non-canonical encodings
+bool fp_from_bytes(const unsigned char *in, fp_value_type &x) {
+    fp_integral_type value;
+    nil::crypto3::multiprecision::import_bits(value, in, in + fp_bytes, 8);
+    if (value >= base_field_type::modulus) {
+        return false;
+    }
+    x = fp_value_type(value);
+    return true;
+}
+
+bool fp_is_largest(const fp_value_type &y) {
+    return fp_integral_type(y.data) > (base_field_type::modulus - 1) / 2;
+}
+
+bool fp2_is_largest(const fp2_value_type &y) {
+    return y.data[1].is_zero() ? fp_is_largest(y.data[0]) : fp_is_largest(y.data[1]);
+}
+
+// Points have to be affine (Z = 1) or zero
+void compress_g1(const g1_value_type &point, unsigned char *out) {
+    if (point.is_zero()) {
+        std::fill(out, out + compressed_g1_size, 0);
+        out[0] = point_flag_compressed | point_flag_infinity;
+        return;
+    }
+    fp_to_bytes(point.X, out);
+    out[0] |= point_flag_compressed | (fp_is_largest(point.Y) ? point_flag_y_largest : 0);
+}
+
+void compress_g2(const g2_value_type &point, unsigned char *out) {
+    if (point.is_zero()) {
+        std::fill(out, out + compressed_g2_size, 0);
+        out[0] = point_flag_compressed | point_flag_infinity;
+        return;
+    }
+    fp_to_bytes(point.X.data[1], out);
+    fp_to_bytes(point.X.data[0], out + fp_bytes);
+    out[0] |= point_flag_compressed | (fp2_is_largest(point.Y) ? point_flag_y_largest : 0);
+}
+
+// Checks the encoding and that the point is on the curve; subgroup membership is left to
+// batch_subgroup_check
+bool decompress_g1(const unsigned char *in, g1_value_type &point) {
+    const unsigned char flags = in[0] & point_flags;
+    if (!(flags & point_flag_compressed)) {
+        return false;
+    }
+    if (flags & point_flag_infinity) {
+        point = g1_value_type::zero();
+        return true;
+    }
+
+    std::array<unsigned char, fp_bytes> x_bytes;
+    std::copy(in, in + fp_bytes, x_bytes.begin());
+    x_bytes[0] &= ~point_flags;
+
+    fp_value_type x;
+    if (!fp_from_bytes(x_bytes.data(), x)) {
+        return false;
+    }
+
+    // y^2 = x^3 + 4
+    const fp_value_type y2 = x.squared() * x + fp_value_type(4);
+    fp_value_type y = y2.sqrt();
+    if (y.squared() != y2) {
+        return false;
+    }
+    if (fp_is_largest(y) != bool(flags & point_flag_y_largest)) {
+        y = -y;
+    }
+
+    point = g1_value_type(x, y, fp_value_type::one());
+    return true;
+}
+
+bool decompress_g2(const unsigned char *in, g2_value_type &point) {
+    const unsigned char flags = in[0] & point_flags;
+    if (!(flags & point_flag_compressed)) {
+        return false;
+    }
+    if (flags & point_flag_infinity) {
+        point = g2_value_type::zero();
+        return true;
+    }
+
+    std::array<unsigned char, fp_bytes> c1_bytes;
+    std::copy(in, in + fp_bytes, c1_bytes.begin());
+    c1_bytes[0] &= ~point_flags;
+
+    fp_value_type c0, c1;
+    if (!fp_from_bytes(c1_bytes.data(), c1) || !fp_from_bytes(in + fp_bytes, c0)) {
+        return false;
+    }
+    const fp2_value_type x(c0, c1);
+
+    // y^2 = x^3 + 4(u + 1)
+    const fp2_value_type y2 = x.squared() * x + fp2_value_type(fp_value_type(4), fp_value_type(4));
+    fp2_value_type y = y2.sqrt();
+    if (y.squared() != y2) {
+        return false;
+    }
+    if (fp2_is_largest(y) != bool(flags & point_flag_y_largest)) {
+        y = -y;
+    }
+
+    point = g2_value_type(x, y, fp2_value_type::one());
+    return true;
+}
+
+void compress_point(const g1_value_type &point, unsigned char *out) {
+    compress_g1(point, out);
+}
+
+void compress_point(const g2_value_type &point, unsigned char *out) {
+    compress_g2(point, out);
+}
+
+bool decompress_point(const unsigned char *in, g1_value_type &point) {
+    return decompress_g1(in, point);
+}
+
+bool decompress_point(const unsigned char *in, g2_value_type &point) {
+    return decompress_g2(in, point);
+}
+
+template<typename PointType>
+constexpr std::size_t compressed_point_size() {
+    return std::is_same<PointType, g1_value_type>::value ? compressed_g1_size : compressed_g2_size;
+}
+
+// Jacobian to affine for a range of points with a single field inversion (Montgomery's trick)
+template<typename PointType>
+void batch_to_affine(PointType *points, std::size_t count) {
+    typedef typename PointType::underlying_field_value_type coordinate_type;
+
+    std::vector<coordinate_type> prefix(count);
+    coordinate_type accumulator = coordinate_type::one();
+    for (std::size_t i = 0; i < count; ++i) {
+        prefix[i] = accumulator;
+        if (!points[i].is_zero()) {
+            accumulator = accumulator * points[i].Z;
+        }
+    }
+
+    coordinate_type inverse = accumulator.inversed();
+    for (std::size_t i = count; i-- > 0;) {
+        if (points[i].is_zero()) {
+            continue;
+        }
+        const coordinate_type z_inverse = inverse * prefix[i];
+        inverse = inverse * points[i].Z;
+
+        const coordinate_type z2_inverse = z_inverse.squared();
+        points[i] = PointType(points[i].X * z2_inverse, points[i].Y * z2_inverse * z_inverse, coordinate_type::one());
+    }
+}
+
+template<typename PointType, typename IntegralType>
+PointType mul_by_integral(const PointType &point, const IntegralType &scalar) {
+    PointType result = PointType::zero();
+    if (scalar == 0) {
+        return result;
+    }
+    for (std::size_t i = nil::crypto3::multiprecision::msb(scalar) + 1; i-- > 0;) {
+        result = result.doubled();
+        if (nil::crypto3::multiprecision::bit_test(scalar, i)) {
+            result = result + point;
+        }
+    }
+    return result;
+}
+
+template<typename PointType>
+PointType mul_by_integral(const PointType &point, std::uint64_t scalar) {
+    PointType result = PointType::zero();
+    for (std::size_t i = 64; i-- > 0;) {
+        result = result.doubled();
+        if ((scalar >> i) & 1) {
+            result = result + point;
+        }
+    }
+    return result;
+}
+
+// Checks [r] sum(rho_i * P_i) = 0 for random 64-bit rho_i instead of [r] P_i = 0 for every point.
+// A point outside the subgroup slips through only if rho_i annihilates its cofactor component,
+// so this is a consistency check of keys we produced ourselves: a bad proving key can only make
+// this prover emit proofs that fail verification.
+template<typename PointType>
+bool batch_subgroup_check(const PointType *points, std::size_t count) {
+    std::vector<PointType> partial(resolve_threads(), PointType::zero());
+
+    parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+        std::mt19937_64 rho_generator(std::random_device {}());
+        PointType sum = PointType::zero();
+        for (std::size_t i = begin; i < end; ++i) {
+            sum = sum + mul_by_integral(points[i], std::uint64_t(rho_generator()));
+        }
+        partial[chunk] = sum;
+    });
+
+    PointType sum = PointType::zero();
+    for (const PointType &p : partial) {
+        sum = sum + p;
+    }
+    return mul_by_integral(sum, field_type::modulus).is_zero();
+}
+
+template<typename PointType>
+std::vector<unsigned char> compress_points(const PointType *points, std::size_t count) {
+    const std::size_t size = compressed_point_size<PointType>();
+    std::vector<unsigned char> bytes(count * size);
+
+    parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t) {
+        std::vector<PointType> affine(points + begin, points + end);
+        batch_to_affine(affine.data(), affine.size());
+        for (std::size_t i = begin; i < end; ++i) {
+            compress_point(affine[i - begin], bytes.data() + i * size);
+        }
+    });
+    return bytes;
+}
+
+// Square roots are computed in parallel, subgroup membership is checked once for the whole run
+template<typename PointType>
+bool decompress_points(const unsigned char *bytes, std::size_t count, std::vector<PointType> &points) {
+    const std::size_t size = compressed_point_size<PointType>();
+    points.resize(count);
+
+    std::atomic<bool> well_formed(true);
+    parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!decompress_point(bytes + i * size, points[i])) {
+                well_formed = false;
+                return;
+            }
+        }
+    });
+    return well_formed && batch_subgroup_check(points.data(), count);
+}
+
+#endif    // CLI_POINT_ENCODING_HPP
@@ -0,0 +1,128 @@
+#ifndef CLI_POSEIDON_COMPONENT_HPP
+#define CLI_POSEIDON_COMPONENT_HPP
+
+#include <map>
+
+#include <nil/crypto3/zk/components/blueprint.hpp>
+#include <nil/crypto3/zk/components/blueprint_variable.hpp>
+
+#include "poseidon.hpp"
+
+using namespace nil::crypto3;
+using namespace nil::crypto3::zk;
+using namespace nil::crypto3::zk::snark;
+using namespace components;
+
+// poseidon_hash(left, right) == output in R1CS. Field elements go in as they are, no bit
+// decomposition. Every S-box costs three constraints (x^2, x^4, x^5) and three variables; the
+// round constants and the MDS matrix are linear and folded into the linear combinations, so a
+// hash costs 3 * 81 + 1 constraints.
+//
+// The variables are allocated contiguously in the order poseidon_permute traces them, which lets
+// a native witness fill them from a trace without a blueprint.
+template<typename FieldT>
+class poseidon_component : public component<FieldT> {
+    typedef typename FieldT::value_type field_value_type;
+
+    // Linear combination with its terms merged by variable index, 0 being the constant one.
+    // Partial rounds keep two state elements linear for many rounds; unmerged, their terms would
+    // triple with every MDS multiplication.
+    typedef std::map<std::size_t, field_value_type> sparse_combination;
+
+  public:
+    static constexpr const std::size_t num_variables = 3 * poseidon_parameters::sboxes;
+
+    blueprint_variable<FieldT> left;
+    blueprint_variable<FieldT> right;
+    blueprint_variable<FieldT> output;
+
+    blueprint_variable_vector<FieldT> sbox_values;
+
+    poseidon_component(blueprint<FieldT> &bp,
+                       const blueprint_variable<FieldT> &left,
+                       const blueprint_variable<FieldT> &right,
+                       const blueprint_variable<FieldT> &output) :
+        component<FieldT>(bp), left(left), right(right), output(output) {
+        sbox_values.allocate(bp, num_variables);
+    }
+
+    // Index of the first traced variable
+    std::size_t first_variable() const {
+        return sbox_values[0].index;
+    }
+
+    void generate_r1cs_constraints() {
+        const poseidon_parameters &parameters = poseidon_parameters::instance();
+        constexpr std::size_t width = poseidon_parameters::width;
+
+        std::array<sparse_combination, width> state;
+        state[0][0] = poseidon_domain_tag();
+        state[1][left.index] = field_value_type::one();
+        state[2][right.index] = field_value_type::one();
+
+        std::size_t next = 0;
+        auto sbox = [&](sparse_combination &x) {
+            const blueprint_variable<FieldT> &x2 = sbox_values[next];
+            const blueprint_variable<FieldT> &x4 = sbox_values[next + 1];
+            const blueprint_variable<FieldT> &x5 = sbox_values[next + 2];
+            next += 3;
+
+            const linear_combination<FieldT> lc = to_linear_combination(x);
+            this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(lc, lc, x2));
+            this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(x2, x2, x4));
+            this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(x4, lc, x5));
+
+            x.clear();
+            x[x5.index] = field_value_type::one();
+        };
+
+        for (std::size_t round = 0; round < poseidon_parameters::rounds; ++round) {
+            for (std::size_t i = 0; i < width; ++i) {
+                state[i][0] = state[i][0] + parameters.round_constants[round * width + i];
+            }
+            if (poseidon_parameters::is_full_round(round)) {
+                for (std::size_t i = 0; i < width; ++i) {
+                    sbox(state[i]);
+                }
+            } else {
+                sbox(state[0]);
+            }
+
+            std::array<sparse_combination, width> mixed;
+            for (std::size_t i = 0; i < width; ++i) {
+                for (std::size_t j = 0; j < width; ++j) {
+                    for (const auto &term : state[j]) {
+                        field_value_type &coefficient = mixed[i][term.first];
+                        coefficient = coefficient + parameters.mds[i][j] * term.second;
+                    }
+                }
+            }
+            state = mixed;
+        }
+        assert(next == num_variables);
+
+        this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(1, to_linear_combination(state[1]), output));
+    }
+
+    void generate_r1cs_witness() {
+        std::vector<field_value_type> trace;
+        trace.reserve(num_variables);
+        this->bp.val(output) = poseidon_hash(this->bp.val(left), this->bp.val(right), &trace);
+        for (std::size_t i = 0; i < num_variables; ++i) {
+            this->bp.val(sbox_values[i]) = trace[i];
+        }
+    }
+
+  private:
+    static linear_combination<FieldT> to_linear_combination(const sparse_combination &x) {
+        linear_combination<FieldT> result;
+        for (const auto &term : x) {
+            if (!term.second.is_zero()) {
+                result.add_term(variable<FieldT>(term.first), term.second);
+            }
+        }
+        return result;
+    }
+};
+
+#endif    // CLI_POSEIDON_COMPONENT_HPP
@@ -0,0 +1,250 @@
+#ifndef CLI_R1CS_OPTIMIZER_HPP
+#define CLI_R1CS_OPTIMIZER_HPP
+
+#include <deque>
+#include <map>
+#include <set>
+
+#include <nil/crypto3/zk/snark/relations/constraint_satisfaction_problems/r1cs.hpp>
+
+using namespace nil::crypto3::zk::snark;
+
+// What eliminate_linear_constraints kept of the original variables. Primary inputs are never
+// touched; the auxiliary variables left are a subset of the original ones, renumbered in order,
+// so a witness of the original system maps to the reduced one by selection.
+template<typename FieldT>
+struct r1cs_reduction {
+    std::size_t num_inputs = 0;
+
+    // Original index of every remaining auxiliary variable, in their new order
+    std::vector<std::size_t> retained;
+
+    std::size_t eliminated_constraints = 0;
+    std::size_t eliminated_variables = 0;
+
+    // Auxiliary input of the reduced system from the full original variable assignment, in which
+    // the value of variable i is at position i - 1
+    template<typename Assignment>
+    r1cs_auxiliary_input<FieldT> reduce(const Assignment &full_variable_assignment) const {
+        r1cs_auxiliary_input<FieldT> result;
+        result.reserve(retained.size());
+        for (std::size_t index : retained) {
+            result.push_back(full_variable_assignment[index - 1]);
+        }
+        return result;
+    }
+};
+
+// Removes the constraints that are linear equations, k * b = c or a * k = c with a constant k, by
+// solving each for one auxiliary variable and substituting it into the constraints it occurs in,
+// then drops the auxiliary variables no constraint refers to any more. The reduced system is
+// satisfied by the primary input and the retained auxiliary values exactly when the original
+// one is satisfiable with them.
+//
+// A substitution copies the other terms of the equation into every constraint of the variable.
+// Equations whose substitution would add more terms than removing them saves are kept, so the
+// pass never makes the system denser.
+template<typename FieldT>
+r1cs_reduction<FieldT> eliminate_linear_constraints(r1cs_constraint_system<FieldT> &constraint_system) {
+    typedef typename FieldT::value_type field_value_type;
+    typedef std::map<std::size_t, field_value_type> sparse_combination;
+
+    struct sparse_constraint {
+        sparse_combination a, b, c;
+        bool removed = false;
+    };
+
+    auto to_sparse = [](const linear_combination<FieldT> &lc) {
+        sparse_combination result;
+        for (const auto &term : lc.terms) {
+            field_value_type &coeff = result[term.index];
+            coeff = coeff + term.coeff;
+        }
+        for (auto it = result.begin(); it != result.end();) {
+            it = it->second.is_zero() ? result.erase(it) : std::next(it);
+        }
+        return result;
+    };
+
+    // Constant of a combination that has no variable terms
+    auto constant_of = [](const sparse_combination &x, field_value_type &k) {
+        if (x.empty()) {
+            k = field_value_type::zero();
+            return true;
+        }
+        if (x.size() == 1 && x.begin()->first == 0) {
+            k = x.begin()->second;
+            return true;
+        }
+        return false;
+    };
+
+    const std::size_t num_inputs = constraint_system.num_inputs();
+    const std::size_t num_variables = constraint_system.num_variables();
+
+    std::vector<sparse_constraint> constraints(constraint_system.constraints.size());
+    std::vector<std::set<std::size_t>> occurrences(num_variables + 1);
+    for (std::size_t i = 0; i < constraints.size(); ++i) {
+        constraints[i].a = to_sparse(constraint_system.constraints[i].a);
+        constraints[i].b = to_sparse(constraint_system.constraints[i].b);
+        constraints[i].c = to_sparse(constraint_system.constraints[i].c);
+        for (const sparse_combination *x : {&constraints[i].a, &constraints[i].b, &constraints[i].c}) {
+            for (const auto &term : *x) {
+                occurrences[term.first].insert(i);
+            }
+        }
+    }
+
+    r1cs_reduction<FieldT> reduction;
+    reduction.num_inputs = num_inputs;
+
+    std::deque<std::size_t> pending;
+    for (std::size_t i = 0; i < constraints.size(); ++i) {
+        pending.push_back(i);
+    }
+
+    while (!pending.empty()) {
+        const std::size_t i = pending.front();
+        pending.pop_front();
+        sparse_constraint &constraint = constraints[i];
+        if (constraint.removed) {
+            continue;
+        }
+
+        // The equation k * other - c = 0
+        field_value_type k;
+        const sparse_combination *other;
+        if (constant_of(constraint.a, k)) {
+            other = &constraint.b;
+        } else if (constant_of(constraint.b, k)) {
+            other = &constraint.a;
+        } else {
+            continue;
+        }
+        sparse_combination equation = constraint.c;
+        for (auto &term : equation) {
+            term.second = field_value_type::zero() - term.second;
+        }
+        for (const auto &term : *other) {
+            field_value_type &coeff = equation[term.first];
+            coeff = coeff + k * term.second;
+        }
+        for (auto it = equation.begin(); it != equation.end();) {
+            it = it->second.is_zero() ? equation.erase(it) : std::next(it);
+        }
+
+        // Pivot: the auxiliary variable occurring in the fewest other constraints
+        std::size_t pivot = 0, pivot_occurrences = 0;
+        for (const auto &term : equation) {
+            if (term.first <= num_inputs) {
+                continue;
+            }
+            const std::size_t others = occurrences[term.first].size() - 1;
+            if (pivot == 0 || others < pivot_occurrences) {
+                pivot = term.first;
+                pivot_occurrences = others;
+            }
+        }
+
+        // An empty equation is 0 = 0 and just goes. Otherwise every other occurrence of the pivot
+        // gains the remaining terms of the equation, while the equation and the pivot's terms go.
+        if (!equation.empty()) {
+            const std::size_t added = pivot_occurrences * (equation.size() - 1);
+            if (pivot == 0 || added > equation.size() + pivot_occurrences) {
+                continue;
+            }
+        }
+
+        for (const sparse_combination *x : {&constraint.a, &constraint.b, &constraint.c}) {
+            for (const auto &term : *x) {
+                occurrences[term.first].erase(i);
+            }
+        }
+        constraint.removed = true;
+        ++reduction.eliminated_constraints;
+        if (equation.empty()) {
+            continue;
+        }
+
+        // pivot = -1/coeff * (equation - coeff * pivot)
+        const field_value_type scale = field_value_type::zero() - equation[pivot].inversed();
+        equation.erase(pivot);
+        for (auto &term : equation) {
+            term.second = term.second * scale;
+        }
+
+        const std::set<std::size_t> users = occurrences[pivot];
+        for (std::size_t j : users) {
+            sparse_constraint &user = constraints[j];
+            for (sparse_combination *x : {&user.a, &user.b, &user.c}) {
+                auto found = x->find(pivot);
+                if (found == x->end()) {
+                    continue;
+                }
+                const field_value_type factor = found->second;
+                x->erase(found);
+                for (const auto &term : equation) {
+                    field_value_type &coeff = (*x)[term.first];
+                    coeff = coeff + factor * term.second;
+                    if (coeff.is_zero()) {
+                        x->erase(term.first);
+                    }
+                }
+            }
+
+            // Terms may have cancelled, so the constraint's variables are recounted
+            std::set<std::size_t> variables;
+            for (const sparse_combination *x : {&user.a, &user.b, &user.c}) {
+                for (const auto &term : *x) {
+                    variables.insert(term.first);
+                }
+            }
+            for (const auto &term : equation) {
+                if (!variables.count(term.first)) {
+                    occurrences[term.first].erase(j);
+                }
+            }
+            for (std::size_t variable : variables) {
+                occurrences[variable].insert(j);
+            }
+            // Substituting a constant can leave a side constant
+            pending.push_back(j);
+        }
+        occurrences[pivot].clear();
+    }
+
+    // Renumber the auxiliary variables still in use
+    std::vector<std::size_t> new_index(num_variables + 1, 0);
+    for (std::size_t index = 0; index <= num_inputs; ++index) {
+        new_index[index] = index;
+    }
+    for (std::size_t index = num_inputs + 1; index <= num_variables; ++index) {
+        if (!occurrences[index].empty()) {
+            reduction.retained.push_back(index);
+            new_index[index] = num_inputs + reduction.retained.size();
+        }
+    }
+    reduction.eliminated_variables = num_variables - num_inputs - reduction.retained.size();
+
+    auto to_linear_combination = [&](const sparse_combination &x) {
+        linear_combination<FieldT> result;
+        for (const auto &term : x) {
+            result.add_term(variable<FieldT>(new_index[term.first]), term.second);
+        }
+        return result;
+    };
+
+    std::vector<r1cs_constraint<FieldT>> reduced;
+    for (const sparse_constraint &constraint : constraints) {
+        if (!constraint.removed) {
+            reduced.emplace_back(to_linear_combination(constraint.a), to_linear_combination(constraint.b),
+                                 to_linear_combination(constraint.c));
+        }
+    }
+    constraint_system.constraints = std::move(reduced);
+    constraint_system.auxiliary_input_size = reduction.retained.size();
+
+    return reduction;
+}
+
+#endif    // CLI_R1CS_OPTIMIZER_HPP
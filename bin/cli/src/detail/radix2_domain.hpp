@@ -0,0 +1,202 @@
+#ifndef CLI_RADIX2_DOMAIN_HPP
+#define CLI_RADIX2_DOMAIN_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <nil/crypto3/math/algorithms/unity_root.hpp>
+
+#include "../utils.hpp"
+#include "parallel.hpp"
+
+// Multiplicative subgroup of size 2^k of the scalar field with everything the QAP reduction needs
+// computed once: the twiddle factors of the forward and inverse transforms, and the powers of the
+// coset shift. Domains are immutable and shared, radix2_domain::get caches one per size.
+//
+// The root of unity is the one the library's basic_radix2_domain uses, so evaluations line up
+// with keys produced by groth16_setup or generate<scheme_type> on a power-of-two domain.
+class radix2_domain {
+  public:
+    // Any element outside the subgroup works as a coset shift; 7 generates the multiplicative group
+    static constexpr const unsigned coset_shift = 7;
+
+    // Elements per block of the first transform stages, so a block stays in the L2 cache
+    static constexpr const std::size_t cache_block = std::size_t(1) << 12;
+
+    static bool is_supported(std::size_t size) {
+        return size > 1 && (size & (size - 1)) == 0;
+    }
+
+    static std::shared_ptr<const radix2_domain> get(std::size_t size) {
+        static std::mutex cache_mutex;
+        static std::map<std::size_t, std::shared_ptr<const radix2_domain>> cache;
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        std::shared_ptr<const radix2_domain> &domain = cache[size];
+        if (!domain) {
+            domain.reset(new radix2_domain(size));
+        }
+        return domain;
+    }
+
+    void fft(std::vector<value_type> &a, std::size_t threads = worker_threads) const {
+        transform(a, twiddles, threads);
+    }
+
+    void ifft(std::vector<value_type> &a, std::size_t threads = worker_threads) const {
+        transform(a, inverse_twiddles, threads);
+        parallel_for(size, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) {
+                a[i] = a[i] * size_inverse;
+            }
+        }, threads);
+    }
+
+    void coset_fft(std::vector<value_type> &a, std::size_t threads = worker_threads) const {
+        multiply_pointwise(a, coset_powers, threads);
+        fft(a, threads);
+    }
+
+    void icoset_fft(std::vector<value_type> &a, std::size_t threads = worker_threads) const {
+        ifft(a, threads);
+        multiply_pointwise(a, inverse_coset_powers, threads);
+    }
+
+    // The vanishing polynomial x^size - 1 is the constant shift^size - 1 on the whole coset
+    void divide_by_vanishing_on_coset(std::vector<value_type> &a, std::size_t threads = worker_threads) const {
+        parallel_for(size, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) {
+                a[i] = a[i] * vanishing_on_coset_inverse;
+            }
+        }, threads);
+    }
+
+    const std::size_t size;
+    const std::size_t log_size;
+
+  private:
+    explicit radix2_domain(std::size_t size) : size(size), log_size(log2(size)) {
+        assert(is_supported(size));
+
+        const value_type omega = nil::crypto3::math::unity_root<field_type>(size);
+        twiddles = powers(omega, size / 2);
+        inverse_twiddles = powers(omega.inversed(), size / 2);
+
+        const value_type shift(coset_shift);
+        coset_powers = powers(shift, size);
+        inverse_coset_powers = powers(shift.inversed(), size);
+
+        size_inverse = value_type(size).inversed();
+        vanishing_on_coset_inverse = (shift.pow(size) - value_type::one()).inversed();
+    }
+
+    static std::size_t log2(std::size_t size) {
+        std::size_t result = 0;
+        while ((std::size_t(1) << result) < size) {
+            ++result;
+        }
+        return result;
+    }
+
+    static std::vector<value_type> powers(const value_type &base, std::size_t count) {
+        std::vector<value_type> result(count);
+        parallel_for(count, [&](std::size_t begin, std::size_t end, std::size_t) {
+            value_type power = base.pow(begin);
+            for (std::size_t i = begin; i < end; ++i) {
+                result[i] = power;
+                power = power * base;
+            }
+        });
+        return result;
+    }
+
+    void multiply_pointwise(std::vector<value_type> &a, const std::vector<value_type> &factors,
+                            std::size_t threads) const {
+        parallel_for(size, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) {
+                a[i] = a[i] * factors[i];
+            }
+        }, threads);
+    }
+
+    // Iterative decimation in time. The stages with butterflies shorter than cache_block run block
+    // by block, each block on one thread; the longer stages split their butterflies across threads.
+    void transform(std::vector<value_type> &a, const std::vector<value_type> &roots, std::size_t threads) const {
+        assert(a.size() == size);
+
+        // Every swapped pair is owned by its smaller index, so chunks never touch the same element twice
+        parallel_for(size, [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t j = reverse_bits(i);
+                if (i < j) {
+                    std::swap(a[i], a[j]);
+                }
+            }
+        }, threads);
+
+        const std::size_t block = std::min(size, cache_block);
+        parallel_for(size / block, [&](std::size_t block_begin, std::size_t block_end, std::size_t) {
+            for (std::size_t b = block_begin; b < block_end; ++b) {
+                for (std::size_t half = 1; half < block; half *= 2) {
+                    butterflies(a, roots, half, b * block, (b + 1) * block);
+                }
+            }
+        }, threads);
+
+        for (std::size_t half = block; half < size; half *= 2) {
+            // Butterfly k of the stage pairs a[group + j] and a[group + j + half]
+            parallel_for(size / 2, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t k = begin; k < end; ++k) {
+                    const std::size_t group = (k / half) * 2 * half;
+                    butterfly(a, roots, half, group, k % half);
+                }
+            }, threads);
+        }
+    }
+
+    void butterflies(std::vector<value_type> &a, const std::vector<value_type> &roots, std::size_t half,
+                     std::size_t begin, std::size_t end) const {
+        for (std::size_t group = begin; group < end; group += 2 * half) {
+            for (std::size_t j = 0; j < half; ++j) {
+                butterfly(a, roots, half, group, j);
+            }
+        }
+    }
+
+    void butterfly(std::vector<value_type> &a, const std::vector<value_type> &roots, std::size_t half,
+                   std::size_t group, std::size_t j) const {
+        // roots holds omega^i for the full size, a stage of length 2 * half uses every (size / 2 / half)-th
+        const value_type t = roots[j * (size / (2 * half))] * a[group + j + half];
+        a[group + j + half] = a[group + j] - t;
+        a[group + j] = a[group + j] + t;
+    }
+
+    std::size_t reverse_bits(std::size_t i) const {
+        std::size_t result = 0;
+        for (std::size_t bit = 0; bit < log_size; ++bit) {
+            result = (result << 1) | ((i >> bit) & 1);
+        }
+        return result;
+    }
+
+    std::vector<value_type> twiddles, inverse_twiddles;
+    std::vector<value_type> coset_powers, inverse_coset_powers;
+    value_type size_inverse;
+    value_type vanishing_on_coset_inverse;
+};
+
+// Appends empty constraints until the QAP domain (one point per constraint and per input, plus one)
+// is a power of two, so setup picks the basic radix-2 domain. Returns the number appended.
+template<typename FieldT>
+std::size_t pad_to_radix2_domain(r1cs_constraint_system<FieldT> &constraint_system) {
+    const std::size_t domain_points = constraint_system.num_constraints() + constraint_system.num_inputs() + 1;
+    std::size_t domain_size = 1;
+    while (domain_size < domain_points) {
+        domain_size <<= 1;
+    }
+    constraint_system.constraints.resize(constraint_system.constraints.size() + domain_size - domain_points);
+    return domain_size - domain_points;
+}
+
+#endif    // CLI_RADIX2_DOMAIN_HPP
@@ -0,0 +1,485 @@
+#ifndef CLI_SCORING_CIRCUIT_HPP
+#define CLI_SCORING_CIRCUIT_HPP
+
+#include <array>
+#include <tuple>
+#include <utility>
+
+#include "multiscore_circuit.hpp"
+
+// Scoring circuit over an attribute list fixed at compile time. A lender describes its attributes
+// and how they are committed as a scoring_spec; one proof then covers all of them:
+//
+//   score = score_base + sum (+/-) w_i * term_i(x_i),  accepted when score_min <= score
+//
+// where term_i is x_i or x_i^2, or nothing for an attribute that is only committed (an id). Every
+// attribute is range checked to its width and belongs to exactly one commitment group, whose data
+// hash is the Poseidon chain over the attributes of the group (see scoring_commitment). The
+// policy, the published hashes, their validation results and out are public inputs, in the order
+// of multiscore.
+//
+// Every variable index follows from the spec, so the spec is the layout: the component asserts its
+// allocation matches, and the native witness writes to constant indices, unrolled over the
+// attributes with no per-attribute branching at run time.
+
+enum class scoring_term { none, linear, quadratic };
+
+template<std::size_t Width, scoring_term Term = scoring_term::none, bool Subtract = false>
+struct scoring_attribute {
+    static_assert(Width > 0 && Width <= 32, "attributes are uints");
+    static_assert(Term != scoring_term::none || !Subtract, "an attribute without a term has nothing to subtract");
+
+    static constexpr std::size_t width = Width;
+    static constexpr scoring_term term = Term;
+    static constexpr bool subtract = Subtract;
+
+    static constexpr bool weighted = Term != scoring_term::none;
+    // x * w, or x * x and x^2 * w
+    static constexpr std::size_t intermediates = Term == scoring_term::quadratic ? 2 : weighted ? 1 : 0;
+    // Bits of the weighted term, weights being below 2^14 as in scoring_policy
+    static constexpr std::size_t term_bits = (Term == scoring_term::quadratic ? 2 * Width : Width) + 14;
+};
+
+// Attributes committed together, by their position in the attribute list
+template<std::size_t... Attributes>
+struct commitment_group {
+    static_assert(sizeof...(Attributes) >= 2, "a commitment hashes at least two attributes");
+
+    static constexpr std::size_t size = sizeof...(Attributes);
+    static constexpr std::array<std::size_t, size> attributes = {Attributes...};
+
+    static constexpr std::size_t count(std::size_t attribute) {
+        std::size_t found = 0;
+        for (std::size_t a : attributes) {
+            found += a == attribute;
+        }
+        return found;
+    }
+};
+
+template<typename... Attributes>
+struct attribute_list { };
+
+template<typename... Groups>
+struct commitment_groups { };
+
+// Sum of the first count values
+template<std::size_t N>
+constexpr std::size_t scoring_prefix_sum(const std::array<std::size_t, N> &values, std::size_t count) {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+// The largest score is below 2^bits: the base and every added term, each below 2^max_bits, with
+// the bits of the terms that are not added left 0
+template<std::size_t N>
+constexpr std::size_t scoring_score_bits(const std::array<std::size_t, N> &added_term_bits) {
+    std::size_t max_bits = 32, added = 1;
+    for (std::size_t bits : added_term_bits) {
+        if (bits) {
+            max_bits = bits > max_bits ? bits : max_bits;
+            ++added;
+        }
+    }
+    std::size_t bits = max_bits;
+    while ((std::size_t(1) << (bits - max_bits)) < added) {
+        ++bits;
+    }
+    return bits;
+}
+
+template<std::size_t NumAttributes, typename... Groups>
+constexpr bool scoring_commits_every_attribute_once() {
+    for (std::size_t i = 0; i < NumAttributes; ++i) {
+        if ((Groups::count(i) + ...) != 1) {
+            return false;
+        }
+    }
+    // No group names an attribute past the list
+    return (Groups::size + ...) == NumAttributes;
+}
+
+template<std::size_t ComparisonBits, typename Attributes, typename Groups>
+struct scoring_spec;
+
+template<std::size_t ComparisonBits, typename... Attributes, typename... Groups>
+struct scoring_spec<ComparisonBits, attribute_list<Attributes...>, commitment_groups<Groups...>> {
+    typedef std::tuple<Attributes...> attributes;
+    typedef std::tuple<Groups...> groups;
+
+    static constexpr std::size_t num_attributes = sizeof...(Attributes);
+    static constexpr std::size_t num_groups = sizeof...(Groups);
+    static constexpr std::size_t comparison_bits = ComparisonBits;
+    static constexpr std::size_t poseidon_variables = 3 * poseidon_parameters::sboxes;
+
+    static constexpr std::array<std::size_t, num_attributes> widths = {Attributes::width...};
+    static constexpr std::array<std::size_t, num_attributes> intermediates = {Attributes::intermediates...};
+    static constexpr std::array<std::size_t, num_attributes> weighted = {std::size_t(Attributes::weighted)...};
+    static constexpr std::array<bool, num_attributes> subtracted = {Attributes::subtract...};
+    static constexpr std::array<std::size_t, num_groups> group_sizes = {Groups::size...};
+    // A group of s attributes has s - 2 intermediate digests, then s - 1 Poseidon components; the
+    // last digest is priv_hash
+    static constexpr std::array<std::size_t, num_groups> group_variables = {
+        (Groups::size - 2 + (Groups::size - 1) * poseidon_variables)...};
+
+    static constexpr std::size_t num_weights = scoring_prefix_sum(weighted, num_attributes);
+
+    // Public inputs
+    static constexpr std::size_t score_base = 1;
+    static constexpr std::size_t score_min = 2;
+    static constexpr std::size_t pub_hash(std::size_t group) {
+        return 3 + group;
+    }
+    static constexpr std::size_t validation_result(std::size_t group) {
+        return 3 + num_groups + group;
+    }
+    static constexpr std::size_t out = 3 + 2 * num_groups;
+    static constexpr std::size_t weight(std::size_t k) {
+        return out + 1 + k;
+    }
+    static constexpr std::size_t num_inputs = out + num_weights;
+
+    // Weight of attribute i among the weighted ones
+    static constexpr std::size_t weight_of(std::size_t i) {
+        return scoring_prefix_sum(weighted, i);
+    }
+
+    // Auxiliary variables, allocated in this order
+    static constexpr std::size_t attribute(std::size_t i) {
+        return num_inputs + 1 + i;
+    }
+    // The last intermediate of an attribute is its weighted term
+    static constexpr std::size_t intermediate(std::size_t i) {
+        return num_inputs + 1 + num_attributes + scoring_prefix_sum(intermediates, i);
+    }
+    static constexpr std::size_t priv_hash(std::size_t group) {
+        return num_inputs + 1 + num_attributes + scoring_prefix_sum(intermediates, num_attributes) + group;
+    }
+    static constexpr std::size_t score =
+        num_inputs + 1 + num_attributes + scoring_prefix_sum(intermediates, num_attributes) + num_groups;
+    static constexpr std::size_t score_min_lt = score + 1;
+    static constexpr std::size_t score_min_lte = score + 2;
+    // Range check of attribute i, most significant bit first
+    static constexpr std::size_t bits(std::size_t i) {
+        return score_min_lte + 1 + scoring_prefix_sum(widths, i);
+    }
+    // comparison allocates alpha[0..n), alpha_packed, not_all_zeros and the disjunction inverse
+    static constexpr std::size_t comparison_alpha = score_min_lte + 1 + scoring_prefix_sum(widths, num_attributes);
+    static constexpr std::size_t group_digest(std::size_t group) {
+        return comparison_alpha + comparison_bits + 3 + scoring_prefix_sum(group_variables, group);
+    }
+    static constexpr std::size_t group_poseidon(std::size_t group, std::size_t hash) {
+        return group_digest(group) + group_sizes[group] - 2 + hash * poseidon_variables;
+    }
+    static constexpr std::size_t num_variables =
+        comparison_alpha + comparison_bits + 2 + scoring_prefix_sum(group_variables, num_groups);
+
+    static_assert(num_attributes > 0 && num_groups > 0, "nothing to score");
+    static_assert(scoring_commits_every_attribute_once<num_attributes, Groups...>(),
+                  "every attribute has to be in exactly one commitment group");
+    static_assert(comparison_bits < 63, "the native comparison witness works on 64-bit integers");
+    static_assert(scoring_score_bits(std::array<std::size_t, num_attributes> {
+                      (Attributes::weighted && !Attributes::subtract ? Attributes::term_bits : 0)...}) <=
+                      comparison_bits,
+                  "the comparison is too narrow for the largest score");
+};
+
+// Score base, threshold and the weights of the weighted attributes in their order, bounded like
+// scoring_policy
+template<std::size_t NumWeights>
+struct scoring_weights {
+    std::uint64_t score_base = 0;
+    std::uint64_t score_min = 0;
+    std::array<std::uint64_t, NumWeights> weights {};
+
+    bool validate(std::string &error) const {
+        if (score_base > scoring_policy::max_score || score_min > scoring_policy::max_score) {
+            error = "score_base and score_min must be below 2^32";
+            return false;
+        }
+        for (std::uint64_t weight : weights) {
+            if (weight > scoring_policy::max_weight) {
+                error = "weights must not exceed 2^14";
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Data hash a provider publishes for a group: poseidon_hash over the first two attributes of the
+// group, then over the digest and each further one
+template<typename Spec, std::size_t Group>
+value_type scoring_commitment(const std::array<std::uint64_t, Spec::num_attributes> &attributes) {
+    typedef typename std::tuple_element<Group, typename Spec::groups>::type group;
+    value_type digest = value_type(attributes[group::attributes[0]]);
+    for (std::size_t h = 1; h < group::size; ++h) {
+        digest = poseidon_hash(digest, value_type(attributes[group::attributes[h]]));
+    }
+    return digest;
+}
+
+template<typename FieldT, typename Spec>
+class scoring_component : public component<FieldT> {
+  public:
+    scoring_component(blueprint<FieldT> &bp) : component<FieldT>(bp) {
+        allocate(score_base, Spec::score_base);
+        allocate(score_min, Spec::score_min);
+        pub_hashes.allocate(this->bp, Spec::num_groups);
+        validation_results.allocate(this->bp, Spec::num_groups);
+        allocate(out, Spec::out);
+        weights.allocate(this->bp, Spec::num_weights);
+
+        attributes.allocate(this->bp, Spec::num_attributes);
+        intermediates.allocate(this->bp, Spec::intermediate(Spec::num_attributes) - Spec::intermediate(0));
+        priv_hashes.allocate(this->bp, Spec::num_groups);
+        allocate(score, Spec::score);
+        allocate(score_min_lt, Spec::score_min_lt);
+        allocate(score_min_lte, Spec::score_min_lte);
+        assert(weights.empty() || weights.back().index == Spec::num_inputs);
+        assert(priv_hashes.back().index == Spec::priv_hash(Spec::num_groups - 1));
+
+        this->bp.set_input_sizes(Spec::num_inputs);
+    }
+
+    void generate_r1cs_constraints() {
+        linear_combination<FieldT> score_terms = score_base;
+        for (std::size_t i = 0; i < Spec::num_attributes; ++i) {
+            generate_range_check(i);
+            if (!Spec::weighted[i]) {
+                continue;
+            }
+            const blueprint_variable<FieldT> &w = weights[Spec::weight_of(i)];
+            const blueprint_variable<FieldT> &x = attributes[i];
+            const std::size_t first = Spec::intermediate(i) - Spec::intermediate(0);
+            blueprint_variable<FieldT> term = intermediates[first];
+            if (Spec::intermediates[i] == 2) {
+                this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(x, x, intermediates[first]));
+                term = intermediates[first + 1];
+                this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(intermediates[first], w, term));
+            } else {
+                this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(x, w, term));
+            }
+            score_terms = Spec::subtracted[i] ? score_terms - term : score_terms + term;
+        }
+        this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(score_terms, 1, score));
+
+        score_min_comparator.reset(
+            new comparison<FieldT>(this->bp, Spec::comparison_bits, score_min, score, score_min_lt, score_min_lte));
+        assert(this->bp.num_variables() + 1 == Spec::comparison_alpha + Spec::comparison_bits + 3);
+        score_min_comparator->generate_r1cs_constraints();
+        this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(score_min_lte, 1, out));
+
+        generate_commitments(std::make_index_sequence<Spec::num_groups>());
+        for (std::size_t g = 0; g < Spec::num_groups; ++g) {
+            this->bp.add_r1cs_constraint(
+                r1cs_constraint<FieldT>(priv_hashes[g] - pub_hashes[g], 1, validation_results[g]));
+        }
+        assert(this->bp.num_variables() == Spec::num_variables);
+    }
+
+  private:
+    void allocate(blueprint_variable<FieldT> &variable, std::size_t index) {
+        variable.allocate(this->bp);
+        assert(variable.index == index);
+        (void)index;
+    }
+
+    // width boolean bits, most significant first, packing to the attribute
+    void generate_range_check(std::size_t i) {
+        blueprint_variable_vector<FieldT> bits;
+        bits.allocate(this->bp, Spec::widths[i]);
+        assert(bits[0].index == Spec::bits(i));
+
+        linear_combination<FieldT> packed;
+        for (std::size_t b = 0; b < bits.size(); ++b) {
+            this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(bits[b], 1 - bits[b], 0));
+            packed.add_term(bits[b], typename FieldT::value_type(2).pow(bits.size() - 1 - b));
+        }
+        this->bp.add_r1cs_constraint(r1cs_constraint<FieldT>(packed, 1, attributes[i]));
+    }
+
+    template<std::size_t... G>
+    void generate_commitments(std::index_sequence<G...>) {
+        (generate_commitment<G>(), ...);
+    }
+
+    template<std::size_t G>
+    void generate_commitment() {
+        typedef typename std::tuple_element<G, typename Spec::groups>::type group;
+
+        blueprint_variable_vector<FieldT> digests;
+        digests.allocate(this->bp, group::size - 2);
+        digests.push_back(priv_hashes[G]);
+
+        blueprint_variable<FieldT> digest = attributes[group::attributes[0]];
+        for (std::size_t h = 0; h + 1 < group::size; ++h) {
+            std::shared_ptr<poseidon_component<FieldT>> hash(
+                new poseidon_component<FieldT>(this->bp, digest, attributes[group::attributes[h + 1]], digests[h]));
+            assert(hash->first_variable() == Spec::group_poseidon(G, h));
+            hash->generate_r1cs_constraints();
+            commitments.push_back(hash);
+            digest = digests[h];
+        }
+    }
+
+    blueprint_variable<FieldT> score_base, score_min, out, score, score_min_lt, score_min_lte;
+    blueprint_variable_vector<FieldT> pub_hashes, validation_results, weights;
+    blueprint_variable_vector<FieldT> attributes, intermediates, priv_hashes;
+
+    std::shared_ptr<comparison<FieldT>> score_min_comparator;
+    std::vector<std::shared_ptr<poseidon_component<FieldT>>> commitments;
+};
+
+// scoring_component compiled once, like multiscore_circuit: linear constraints eliminated and the
+// system padded to a radix-2 domain
+template<typename Spec>
+class scoring_circuit {
+  public:
+    scoring_circuit() {
+        blueprint<field_type> bp;
+        scoring_component<field_type, Spec> component(bp);
+        component.generate_r1cs_constraints();
+
+        constraint_system = bp.get_constraint_system();
+        reduction = eliminate_linear_constraints(constraint_system);
+        padding_constraints = pad_to_radix2_domain(constraint_system);
+    }
+
+    r1cs_constraint_system<field_type> constraint_system;
+    r1cs_reduction<field_type> reduction;
+    std::size_t padding_constraints = 0;
+};
+
+// Values of one applicant for a compiled scoring circuit. The attributes are unrolled at compile
+// time; each one writes its value, bits and term to the indices of the spec.
+template<typename Spec>
+class scoring_witness {
+  public:
+    typedef std::array<std::uint64_t, Spec::num_attributes> attribute_values;
+
+    explicit scoring_witness(const scoring_circuit<Spec> &circuit) :
+        circuit(circuit), assignment(Spec::num_variables, value_type::zero()) {
+    }
+
+    void generate_r1cs_witness(const attribute_values &attributes,
+                               const std::array<value_type, Spec::num_groups> &published_hashes,
+                               const scoring_weights<Spec::num_weights> &policy) {
+        scoped_timer timer("generate_r1cs_witness");
+        val(Spec::score_base) = value_type(policy.score_base);
+        val(Spec::score_min) = value_type(policy.score_min);
+        for (std::size_t k = 0; k < Spec::num_weights; ++k) {
+            val(Spec::weight(k)) = value_type(policy.weights[k]);
+        }
+
+        score = policy.score_base;
+        val(Spec::score) = value_type(policy.score_base);
+        set_attributes(attributes, policy, std::make_index_sequence<Spec::num_attributes>());
+
+        generate_comparison_witness(assignment, Spec::comparison_alpha, Spec::comparison_bits, Spec::score_min_lt,
+                                    Spec::score_min_lte, policy.score_min, score, val(Spec::score_min),
+                                    val(Spec::score));
+        val(Spec::out) = value_type::one();
+
+        set_commitments(published_hashes, std::make_index_sequence<Spec::num_groups>());
+    }
+
+    r1cs_primary_input<field_type> primary_input() const {
+        return r1cs_primary_input<field_type>(assignment.begin(), assignment.begin() + Spec::num_inputs);
+    }
+
+    r1cs_auxiliary_input<field_type> auxiliary_input() const {
+        return circuit.reduction.reduce(assignment);
+    }
+
+    bool is_satisfied() const {
+        return circuit.constraint_system.is_satisfied(primary_input(), auxiliary_input());
+    }
+
+    const scoring_circuit<Spec> &circuit;
+    r1cs_variable_assignment<field_type> assignment;
+    score_type score = 0;
+
+  private:
+    value_type &val(std::size_t index) {
+        return assignment[index - 1];
+    }
+
+    template<std::size_t... I>
+    void set_attributes(const attribute_values &attributes, const scoring_weights<Spec::num_weights> &policy,
+                        std::index_sequence<I...>) {
+        (set_attribute<I>(attributes[I], policy), ...);
+    }
+
+    template<std::size_t I>
+    void set_attribute(std::uint64_t x, const scoring_weights<Spec::num_weights> &policy) {
+        typedef typename std::tuple_element<I, typename Spec::attributes>::type attribute;
+
+        val(Spec::attribute(I)) = value_type(x);
+        for (std::size_t b = 0; b < attribute::width; ++b) {
+            val(Spec::bits(I) + b) = (x >> (attribute::width - 1 - b)) & 1 ? value_type::one() : value_type::zero();
+        }
+
+        if constexpr (attribute::weighted) {
+            constexpr std::size_t first = Spec::intermediate(I);
+            const std::uint64_t w = policy.weights[Spec::weight_of(I)];
+            score_type term = score_type(x) * w;
+            if constexpr (attribute::term == scoring_term::quadratic) {
+                val(first) = value_type(x) * value_type(x);
+                val(first + 1) = val(first) * value_type(w);
+                term *= x;
+            } else {
+                val(first) = value_type(x) * value_type(w);
+            }
+
+            constexpr std::size_t term_index = first + attribute::intermediates - 1;
+            if constexpr (attribute::subtract) {
+                score -= term;
+                val(Spec::score) = val(Spec::score) - val(term_index);
+            } else {
+                score += term;
+                val(Spec::score) = val(Spec::score) + val(term_index);
+            }
+        }
+    }
+
+    template<std::size_t... G>
+    void set_commitments(const std::array<value_type, Spec::num_groups> &published_hashes,
+                         std::index_sequence<G...>) {
+        (set_commitment<G>(published_hashes[G]), ...);
+    }
+
+    // The Poseidon chain of the group, every hash writing its S-box trace
+    template<std::size_t G>
+    void set_commitment(const value_type &published_hash) {
+        typedef typename std::tuple_element<G, typename Spec::groups>::type group;
+
+        value_type digest = val(Spec::attribute(group::attributes[0]));
+        for (std::size_t h = 0; h + 1 < group::size; ++h) {
+            trace.clear();
+            digest = poseidon_hash(digest, val(Spec::attribute(group::attributes[h + 1])), &trace);
+            std::copy(trace.begin(), trace.end(), assignment.begin() + (Spec::group_poseidon(G, h) - 1));
+            val(h + 2 < group::size ? Spec::group_digest(G) + h : Spec::priv_hash(G)) = digest;
+        }
+        val(Spec::pub_hash(G)) = published_hash;
+        val(Spec::validation_result(G)) = value_type::zero();
+    }
+
+    std::vector<value_type> trace;
+};
+
+// The four multiscore attributes as a spec: id, income, overdue loans and account age, range
+// checked to 32 bits like the compact circuit and committed in pairs with Poseidon like the
+// poseidon one, so its data hashes are those of --circuit poseidon
+typedef scoring_spec<48,
+                     attribute_list<scoring_attribute<32>,
+                                    scoring_attribute<32, scoring_term::linear>,
+                                    scoring_attribute<32, scoring_term::quadratic, true>,
+                                    scoring_attribute<32, scoring_term::linear>>,
+                     commitment_groups<commitment_group<0, 1>, commitment_group<2, 3>>>
+    multiscore_spec;
+
+#endif    // CLI_SCORING_CIRCUIT_HPP
@@ -23,194 +23,316 @@
 #include <nil/crypto3/zk/snark/algorithms/verify.hpp>
 #include <nil/crypto3/zk/snark/algorithms/prove.hpp>
 
-#include <nil/marshalling/status_type.hpp>
-#include <nil/crypto3/marshalling/types/zk/r1cs_gg_ppzksnark/primary_input.hpp>
-#include <nil/crypto3/marshalling/types/zk/r1cs_gg_ppzksnark/proof.hpp>
-#include <nil/crypto3/marshalling/types/zk/r1cs_gg_ppzksnark/verification_key.hpp>
-
 #include "detail/multiscore_component.hpp"
-
-using Endianness = nil::marshalling::option::big_endian;
-using unit_type = unsigned char;
+#include "detail/groth16_setup.hpp"
+#include "prover.hpp"
+#include "batch.hpp"
+#include "commit.hpp"
+#include "proof_archive.hpp"
+#include "payload.hpp"
+#include "verifier.hpp"
+#include "aggregation.hpp"
+#include "serve.hpp"
 
 boost::filesystem::path PROVING_KEY_PATH = "p_key";
 boost::filesystem::path VERIFICATION_KEY_PATH = "v_key";
 boost::filesystem::path PROOF_PATH = "proof";
 boost::filesystem::path INPUT_PATH = "pi";
-
-std::vector<std::uint8_t> readfile(boost::filesystem::path path) {
-    boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
-    auto eos = std::istreambuf_iterator<char>();
-    auto buffer = std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), eos);
-    return buffer;
+boost::filesystem::path SOCKET_PATH = "prover.sock";
+boost::filesystem::path BATCH_OUTPUT_PATH = "proofs";
+boost::filesystem::path KEY_CACHE_PATH = "key-cache";
+boost::filesystem::path AGGREGATION_SRS_PATH = "agg_srs";
+boost::filesystem::path AGGREGATE_PATH = "aggregate";
+
+// Copies a cached key to where the other commands read it, together with its digest
+bool install_key(boost::filesystem::path cached_path, boost::filesystem::path path) {
+    boost::system::error_code error;
+    boost::filesystem::remove(path, error);
+    boost::filesystem::copy_file(cached_path, path, error);
+    if (error || !write_key_digest(path)) {
+        std::cout << "Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
 }
 
-bool trusted_setup() {
+// Keys are cached under the digest of the compiled circuit, <cache>/<digest>/p_key.<format> and
+// v_key. Setup only generates keys when the cache has none for the circuit; a proving key cached
+// in another format is converted, so the pair stays the one of the cached verification key.
+bool trusted_setup(const std::string &key_format, boost::filesystem::path cache_path) {
     std::cout << std::endl;
-    std::cout << "Generating keys..." << std::endl;
+    std::cout << "Setup..." << std::endl;
     std::cout << std::endl;
-    blueprint<field_type> bp;
-    multiscore<field_type> multiscore(bp);
-    multiscore.generate_r1cs_constraints();
-
-    const r1cs_constraint_system<field_type> constraint_system = bp.get_constraint_system();
-
-    scheme_type::keypair_type keypair = generate<scheme_type>(constraint_system);
-
-    std::vector<std::uint8_t> proving_key_byteblob =
-        nil::marshalling::verifier_input_serializer_tvm<scheme_type>::process(keypair.first);
-
-    using verification_key_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_verification_key<
-        nil::marshalling::field_type<
-            Endianness>,
-        typename scheme_type::verification_key_type>;
-
-    verification_key_marshalling_type filled_verification_key_val =
-        nil::crypto3::marshalling::types::fill_r1cs_gg_ppzksnark_verification_key<
-            typename scheme_type::verification_key_type,
-            Endianness>(keypair.second);
-
-
-    std::vector<unit_type> verification_key_byteblob;
-    verification_key_byteblob.resize(filled_verification_key_val.length(), 0x00);
-    auto verification_key_write_iter = verification_key_byteblob.begin();
-
-    typename nil::marshalling::status_type status =
-        filled_verification_key_val.write(verification_key_write_iter,
-            verification_key_byteblob.size());
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    const r1cs_constraint_system<field_type> &constraint_system = circuit.constraint_system;
+    std::cout << "Constraints: " << constraint_system.num_constraints() << " (" << circuit.reduction.eliminated_constraints
+              << " linear constraints and " << circuit.reduction.eliminated_variables << " variables eliminated, "
+              << circuit.padding_constraints << " padding)" << std::endl;
+    std::cout << "Circuit digest: " << compiled_circuit_digest() << std::endl;
+
+    const boost::filesystem::path entry = cache_path / compiled_circuit_digest();
+    const boost::filesystem::path cached_proving_key = entry / ("p_key." + key_format);
+    const boost::filesystem::path cached_verification_key = entry / "v_key";
+    boost::filesystem::create_directories(entry);
+
+    if (boost::filesystem::exists(cached_verification_key) && !boost::filesystem::exists(cached_proving_key)) {
+        for (const std::string format : {"tvm", "mapped", "compressed"}) {
+            const boost::filesystem::path other = entry / ("p_key." + format);
+            typename scheme_type::proving_key_type proving_key;
+            if (boost::filesystem::exists(other) && load_proving_key(other, proving_key)) {
+                if (!save_proving_key(cached_proving_key, proving_key, key_format)) {
+                    std::cout << "Could not write " << cached_proving_key << std::endl;
+                    return false;
+                }
+                std::cout << "Cached proving key converted to " << key_format << " format" << std::endl;
+                break;
+            }
+        }
+    }
 
-    boost::filesystem::ofstream pk_out(PROVING_KEY_PATH);
-    for (const auto &v : proving_key_byteblob) {
-        pk_out << v;
+    if (boost::filesystem::exists(cached_proving_key) && check_key_digest(cached_proving_key, "Proving key") &&
+        boost::filesystem::exists(cached_verification_key) &&
+        check_key_digest(cached_verification_key, "Verification key")) {
+        std::cout << "Keys for this circuit are cached in " << entry << ", skipping key generation" << std::endl;
+    } else {
+        std::cout << "Generating keys..." << std::endl;
+        scheme_type::keypair_type keypair = groth16_setup(constraint_system, true);
+
+        std::vector<unit_type> verification_key_byteblob = verification_key_to_byteblob(keypair.second);
+        if (!save_proving_key(cached_proving_key, keypair.first, key_format) ||
+            !writefile(cached_verification_key, verification_key_byteblob) ||
+            !write_key_digest(cached_verification_key)) {
+            std::cout << "Could not write the keys to " << entry << std::endl;
+            return false;
+        }
+        write_prepared_verification_key(prepared_verification_key_path(cached_verification_key),
+                                        prepare_verification_key(keypair.second), verification_key_byteblob);
+        std::cout << "Keys are cached in " << entry << std::endl;
     }
-    pk_out.close();
-    std::cout << "Proving key is saved to " << PROVING_KEY_PATH << std::endl;
 
-    boost::filesystem::ofstream vk_out(VERIFICATION_KEY_PATH );
-    for (const auto &v : verification_key_byteblob) {
-        vk_out << v;
+    scoped_timer timer("write_files");
+    if (!install_key(cached_proving_key, PROVING_KEY_PATH) ||
+        !install_key(cached_verification_key, VERIFICATION_KEY_PATH)) {
+        return false;
     }
-    vk_out.close();
+    std::cout << "Proving key is saved to " << PROVING_KEY_PATH << " (" << key_format << " format)" << std::endl;
     std::cout << "Verification key is saved to " << VERIFICATION_KEY_PATH << std::endl;
 
+    // The prepared key is rebuilt on first use when it does not match, copying it saves that
+    const boost::filesystem::path cached_prepared = prepared_verification_key_path(cached_verification_key);
+    if (boost::filesystem::exists(cached_prepared)) {
+        const boost::filesystem::path prepared = prepared_verification_key_path(VERIFICATION_KEY_PATH);
+        boost::system::error_code error;
+        boost::filesystem::remove(prepared, error);
+        boost::filesystem::copy_file(cached_prepared, prepared, error);
+    }
     return true;
 }
 
 
-bool proof_generation(uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age, std::string pa_data_hash, std::string fi_data_hash) {
+bool proof_generation(uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age, std::string pa_data_hash, std::string fi_data_hash,
+                      boost::filesystem::path archive_path) {
+    applicant_record applicant;
+    applicant.pa_id = pa_id;
+    applicant.pa_income = pa_income;
+    applicant.fi_overdue_loans = fi_overdue_loans;
+    applicant.fi_account_age = fi_account_age;
+    applicant.pa_data_hash = pa_data_hash;
+    applicant.fi_data_hash = fi_data_hash;
+
+    // Ineligible applicants are rejected before the key is loaded or the circuit compiled
+    std::string reason;
+    if (!evaluate_applicant(applicant, reason)) {
+        std::cout << "Applicant is not eligible: " << reason << std::endl;
+        return false;
+    }
+
     std::cout << std::endl;
     std::cout << "Proving..." << std::endl;
     std::cout << std::endl;
 
-    std::vector<std::uint8_t> proving_key_byteblob = readfile(PROVING_KEY_PATH);
-    nil::marshalling::status_type provingProcessingStatus = nil::marshalling::status_type::success;
-    typename scheme_type::proving_key_type proving_key = nil::marshalling::verifier_input_deserializer_tvm<scheme_type>::proving_key_process(
-        proving_key_byteblob.cbegin(),
-        proving_key_byteblob.cend(),
-        provingProcessingStatus);
-
-    std::vector<std::uint8_t> ver_key_byteblob = readfile(VERIFICATION_KEY_PATH);
-    nil::marshalling::status_type verProcessingStatus = nil::marshalling::status_type::success;
-    typename scheme_type::verification_key_type verification_key = nil::marshalling::verifier_input_deserializer_tvm<scheme_type>::verification_key_process(
-        ver_key_byteblob.cbegin(),
-        ver_key_byteblob.cend(),
-        verProcessingStatus);
-
-    blueprint<field_type> bp;
-    multiscore<field_type> multiscore(bp);
-    multiscore.generate_r1cs_constraints();
-    multiscore.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
-
-    std::cout << "Blueprint is satisfied: " << bp.is_satisfied() << std::endl;
-    if (!bp.is_satisfied()) {
+    groth16_proving_key proving_key;
+    if (!load_groth16_proving_key(PROVING_KEY_PATH, proving_key)) {
         return false;
     }
 
+    if (!archive_path.empty()) {
+        proof_archive_writer archive;
+        if (!archive.open(archive_path)) {
+            return false;
+        }
+        multiscore_witness<field_type> witness(compiled_circuit());
+        typename scheme_type::proof_type proof;
+        r1cs_primary_input<field_type> primary_input;
+        if (!prove_applicant(witness, proving_key, applicant, proof, primary_input, true)) {
+            return false;
+        }
+        if (!archive.append(pa_id, proof, primary_input) || !archive.close()) {
+            std::cout << "Could not write the proof to " << archive_path << std::endl;
+            return false;
+        }
+        std::cout << "Proof is appended to " << archive_path << std::endl;
+        return true;
+    }
 
+    std::vector<unit_type> proof_byteblob, primary_input_byteblob;
+    auto started = std::chrono::steady_clock::now();
+    if (!generate_proof(proving_key, applicant, proof_byteblob, primary_input_byteblob, true)) {
+        return false;
+    }
+    std::cout << "Proved in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+                     .count()
+              << " ms, peak RSS " << (peak_rss_kb() >> 10) << " MB" << std::endl;
+
+    {
+        scoped_timer timer("write_files");
+        if (!writefile(PROOF_PATH, proof_byteblob) || !writefile(INPUT_PATH, primary_input_byteblob)) {
+            std::cout << "Could not write " << PROOF_PATH << " and " << INPUT_PATH << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Proof is saved to " << PROOF_PATH << std::endl;
+    std::cout << "Primary input is saved to " << INPUT_PATH << std::endl;
+    return true;
+}
 
-    // Proof
-    const scheme_type::proof_type proof = prove<scheme_type>(proving_key, bp.primary_input(), bp.auxiliary_input());
-
-
-
-    // PROOF AND INPUT FILE EXPORT
-    // (new marshalling)
-    // ===============================================================================
-
-    using proof_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_proof<
-        nil::marshalling::field_type<
-            Endianness>,
-        typename scheme_type::proof_type>;
-
-    proof_marshalling_type filled_proof_val =
-        nil::crypto3::marshalling::types::fill_r1cs_gg_ppzksnark_proof<
-            typename scheme_type::proof_type,
-            Endianness>(proof);
-
-    using primary_input_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_primary_input<
-        nil::marshalling::field_type<
-            Endianness>,
-        typename scheme_type::primary_input_type>;
-
-    primary_input_marshalling_type filled_primary_input_val =
-        nil::crypto3::marshalling::types::fill_r1cs_gg_ppzksnark_primary_input<
-            typename scheme_type::primary_input_type,
-            Endianness>(bp.primary_input());
-
-    /* std::cout << "Marshalling types filled." << std::endl; */
-
-    std::vector<unit_type> proof_byteblob;
-    proof_byteblob.resize(filled_proof_val.length(), 0x00);
-    auto proof_write_iter = proof_byteblob.begin();
-
-    typename nil::marshalling::status_type status;
-    status = filled_proof_val.write(proof_write_iter,
-            proof_byteblob.size());
-
-    std::vector<unit_type> primary_input_byteblob;
-
-    primary_input_byteblob.resize(filled_primary_input_val.length(), 0x00);
-    auto primary_input_write_iter = primary_input_byteblob.begin();
-
-    status = filled_primary_input_val.write(primary_input_write_iter,
-            primary_input_byteblob.size());
-
-    /* std::cout << "Byteblobs filled." << std::endl; */
+// Latest archived proof of the applicant, written to the paths --verify reads
+bool extract_archived_proof(boost::filesystem::path archive_path, uint pa_id) {
+    proof_archive_reader archive;
+    archived_proof proof;
+    std::string error;
+    if (!archive.open(archive_path, error) || !archive.find(pa_id, proof, error)) {
+        std::cout << "Archive " << archive_path << ": " << error << std::endl;
+        return false;
+    }
 
-    boost::filesystem::ofstream proof_out(PROOF_PATH);
-    for (const auto &v : proof_byteblob) {
-        proof_out << v;
+    std::cout << "Proof of applicant " << proof.applicant_id << " archived at " << proof.timestamp_ms
+              << " ms since the epoch for circuit " << proof.circuit_digest << std::endl;
+    if (!boost::iequals(proof.circuit_digest, compiled_circuit_digest())) {
+        std::cout << "The proof is for another circuit than the current one" << std::endl;
+    }
+    if (!writefile(PROOF_PATH, proof.proof) || !writefile(INPUT_PATH, proof.primary_input)) {
+        std::cout << "Could not write " << PROOF_PATH << " and " << INPUT_PATH << std::endl;
+        return false;
     }
-    proof_out.close();
     std::cout << "Proof is saved to " << PROOF_PATH << std::endl;
+    std::cout << "Primary input is saved to " << INPUT_PATH << std::endl;
+    return true;
+}
+
+bool export_proving_key(boost::filesystem::path output_path, const std::string &key_format) {
+    auto started = std::chrono::steady_clock::now();
+    typename scheme_type::proving_key_type proving_key;
+    if (!load_proving_key(PROVING_KEY_PATH, proving_key)) {
+        return false;
+    }
+    std::cout << "Proving key " << PROVING_KEY_PATH << " loaded in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+                     .count()
+              << " ms" << std::endl;
 
-    boost::filesystem::ofstream primary_input_out(INPUT_PATH);
-    for (const auto &v : primary_input_byteblob) {
-        primary_input_out << v;
+    if (!save_proving_key(output_path, proving_key, key_format)) {
+        std::cout << "Could not write " << output_path << std::endl;
+        return false;
     }
-    primary_input_out.close();
-    std::cout << "Primary input is saved to " << INPUT_PATH << std::endl;
+    std::cout << "Proving key is exported to " << output_path << " (" << key_format << " format)" << std::endl;
+    return true;
+}
 
+// Writes the current proving key in every format and times loading each of them back
+bool benchmark_key_formats() {
+    typename scheme_type::proving_key_type proving_key;
+    if (!load_proving_key(PROVING_KEY_PATH, proving_key)) {
+        return false;
+    }
 
+    std::cout << "format,size_bytes,load_ms" << std::endl;
+    for (const std::string format : {"tvm", "mapped", "compressed"}) {
+        boost::filesystem::path path = PROVING_KEY_PATH.string() + "." + format;
+        if (!save_proving_key(path, proving_key, format)) {
+            std::cout << "Could not write " << path << std::endl;
+            return false;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        groth16_proving_key loaded;
+        bool ok = load_groth16_proving_key(path, loaded);
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+
+        std::cout << format << "," << boost::filesystem::file_size(path) << "," << elapsed << std::endl;
+        boost::filesystem::remove(path);
+        boost::filesystem::remove(key_digest_path(path));
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // TEST VERIFICATION
-    // ===============================================================================
+// Commitments a data provider publishes for the attributes, as the selected circuit computes them
+bool print_commitments(uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age) {
+    std::cout << "PA data hash: "
+              << field_element_to_hex(multiscore_commitment_hash(circuit_widths, pa_id, pa_income)) << std::endl;
+    std::cout << "FI data hash: "
+              << field_element_to_hex(multiscore_commitment_hash(circuit_widths, fi_overdue_loans, fi_account_age))
+              << std::endl;
+    return true;
+}
 
-    /* std::cout << std::endl; */
-    /* std::cout << "Verification..." << std::endl; */
-    /* using basic_proof_system = r1cs_gg_ppzksnark<curve_type>; */
-    /* const bool verified = verify<basic_proof_system>(verification_key, bp.primary_input(), proof); */
-    /* std::cout << "Proof is verified: " << verified << std::endl; */
+// The primary input written by --proof has to state an accepted applicant under the lender's policy,
+// whatever the proof says. The data hashes are checked when given; a packed primary input only shows
+// its digest, which is recomputed from the policy and the data hashes, so it needs them.
+bool check_primary_input_policy(boost::filesystem::path primary_input_path, const scoring_policy &policy,
+                                std::string pa_data_hash, std::string fi_data_hash) {
+    typename scheme_type::primary_input_type primary_input;
+    if (!byteblob_to_primary_input(readfile(primary_input_path), primary_input)) {
+        std::cout << "Primary input " << primary_input_path << " is missing or malformed" << std::endl;
+        return false;
+    }
+    const bool with_hashes = circuit_widths.packed_inputs || !pa_data_hash.empty() || !fi_data_hash.empty();
+    if (with_hashes && (!is_field_element_hex(pa_data_hash) || !is_field_element_hex(fi_data_hash))) {
+        std::cout << "Data hashes must be " << 2 * modulus_chunks << " hex digits" << std::endl;
+        return false;
+    }
+    bool matches;
+    if (circuit_widths.packed_inputs) {
+        matches = primary_input == packed_public_input(policy, hex_to_field_element(pa_data_hash),
+                                                       hex_to_field_element(fi_data_hash));
+    } else if (with_hashes) {
+        matches = primary_input_has_policy(compiled_circuit().layout, primary_input, policy,
+                                           hex_to_field_element(pa_data_hash), hex_to_field_element(fi_data_hash));
+    } else {
+        matches = primary_input_has_policy(compiled_circuit().layout, primary_input, policy);
+    }
+    std::cout << "Primary input follows the policy: " << matches << std::endl;
+    return matches;
+}
 
-    // ===============================================================================
-    // ===============================================================================
+// Every command reading v_key first checks it is the key of the compiled circuit
+bool verification_key_matches() {
+    return check_key_digest(VERIFICATION_KEY_PATH, "Verification key");
+}
 
+bool write_metrics(boost::filesystem::path path) {
+    boost::filesystem::ofstream stream(path);
+    stream << metrics_registry::instance().to_json();
+    if (!stream) {
+        std::cout << "Could not write metrics to " << path << std::endl;
+        return false;
+    }
+    std::cout << "Metrics are saved to " << path << std::endl;
     return true;
 }
 
-
 int main(int argc, char *argv[]) {
     uint pa_id, pa_income, fi_overdue_loans, fi_account_age;
+    unsigned short metrics_port;
+    std::size_t threads;
+    std::size_t memory_budget_mb;
+    std::size_t serve_proofs;
+    std::string key_format, circuit_variant;
     std::string pa_data_hash, fi_data_hash;
 
     boost::program_options::options_description options(
@@ -220,6 +342,64 @@ int main(int argc, char *argv[]) {
     ("help", "Display help message")
     ("setup", "Trusted setup phase: key generation")
     ("proof", "Proof generation")
+    ("key-cache", boost::program_options::value<std::string>()->default_value(KEY_CACHE_PATH.string()),
+        "Directory --setup keeps keys in, one entry per circuit digest")
+    ("circuit", boost::program_options::value<std::string>(&circuit_variant)->default_value("compact"),
+        "Circuit variant: compact (range checked 32-bit attributes), poseidon (Poseidon commitments) or wide "
+        "(256-bit attribute words, commitments not bound, unsound); keys are generated for one variant")
+    ("pack-inputs", "Commit every public value of --circuit to a single public input; --verify --policy then "
+        "needs --pa-data-hash and --fi-data-hash")
+    ("policy", boost::program_options::value<std::string>(),
+        "JSON scoring policy (score_base, score_min, w_income, w_overdue_loans, w_account_age) to prove "
+        "under, or for --verify to require of the primary input")
+    ("commit", "Print the data hashes of --id, --income, --overdue-loans and --account-age for --circuit")
+    ("commit-batch", boost::program_options::value<std::string>(),
+        "Compute the data hashes of every <reference>,<left>,<right> record of a CSV file for --circuit")
+    ("commit-output", boost::program_options::value<std::string>()->default_value("commitments.csv"),
+        "Output file of --commit-batch, one <reference>,<hash> line per record")
+    ("key-format", boost::program_options::value<std::string>(&key_format)->default_value("tvm"),
+        "Proving key format written by --setup and --export-key: tvm, mapped or compressed")
+    ("export-key", boost::program_options::value<std::string>(),
+        "Convert the proving key to --key-format and write it to the given path")
+    ("benchmark-key-formats", "Compare size and load time of the proving key in every format")
+    ("serve", "Keep the proving key loaded and serve proof requests over a local socket")
+    ("socket", boost::program_options::value<std::string>()->default_value(SOCKET_PATH.string()),
+        "Unix socket path for --serve")
+    ("metrics-port", boost::program_options::value<unsigned short>(&metrics_port)->default_value(0),
+        "Serve Prometheus metrics over HTTP on 127.0.0.1 with --serve, 0 to disable")
+    ("serve-proofs", boost::program_options::value<std::size_t>(&serve_proofs)->default_value(1),
+        "Proofs --serve computes at a time, sharing --threads and --memory-budget; other requests wait")
+    ("metrics-json", boost::program_options::value<std::string>(),
+        "Write per-phase timings, allocations and peak memory of the run as JSON")
+    ("proof-batch", boost::program_options::value<std::string>(),
+        "Prove every applicant of a CSV or JSONL file")
+    ("output-dir", boost::program_options::value<std::string>()->default_value(BATCH_OUTPUT_PATH.string()),
+        "Directory for --proof-batch proofs and report")
+    ("archive", boost::program_options::value<std::string>(),
+        "Append proofs of --proof and --proof-batch to this archive instead of writing proof files")
+    ("archive-get", boost::program_options::value<uint>(),
+        "Write the latest proof of an applicant id in --archive to the files --verify reads")
+    ("build-payload", boost::program_options::value<std::string>(),
+        "Write proof ++ pi ++ v_key, the blob the contract passes to tvm.vergrth16, to this path and as hex to "
+        "<path>.hex")
+    ("preflight", boost::program_options::value<std::vector<std::string>>()->multitoken(),
+        "Check payload files (binary, or one hex payload per line) the way tvm.vergrth16 reads them")
+    ("verify", "Verify the proof and primary input written by --proof")
+    ("verify-batch", boost::program_options::value<std::string>(),
+        "Verify every <name>.proof / <name>.pi pair of a directory at once")
+    ("aggregation-setup", boost::program_options::value<std::size_t>(),
+        "Generate the structured reference string of --aggregate for up to this many proofs")
+    ("aggregate", boost::program_options::value<std::string>(),
+        "Aggregate every <name>.proof / <name>.pi pair of a directory into one proof of logarithmic size")
+    ("verify-aggregate", boost::program_options::value<std::string>(),
+        "Verify the aggregate written by --aggregate against the primary inputs of the directory")
+    ("benchmark-aggregation", boost::program_options::value<std::string>(),
+        "Compare aggregating and verifying 2, 4, ... proofs of a directory with verifying each of them")
+    ("threads", boost::program_options::value<std::size_t>(&threads)->default_value(0),
+        "Worker threads for the prover, batch proving and key decompression, 0 for one per core")
+    ("memory-budget", boost::program_options::value<std::size_t>(&memory_budget_mb)->default_value(0),
+        "MB the proofs of --proof, --proof-batch and --serve may hold at a time; the proving key, in the mapped or "
+        "compressed format, is streamed from disk in chunks that fit. 0 keeps the whole key in memory")
     ("id,a", boost::program_options::value<uint>(&pa_id)->default_value(123))
     ("income,b", boost::program_options::value<uint>(&pa_income)->default_value(100))
     ("overdue-loans,c", boost::program_options::value<uint>(&fi_overdue_loans)->default_value(0))
@@ -234,10 +414,114 @@ int main(int argc, char *argv[]) {
     if (vm.count("help") || argc < 2) {
         std::cout << options << std::endl;
         return 0;
-    } else if (vm.count("setup")) {
-        trusted_setup();
+    }
+
+    if (key_format != "tvm" && key_format != "mapped" && key_format != "compressed") {
+        std::cout << "Unknown key format " << key_format << std::endl;
+        return 1;
+    }
+    if (!parse_circuit_variant(circuit_variant, circuit_widths)) {
+        std::cout << "Unknown circuit variant " << circuit_variant << std::endl;
+        return 1;
+    }
+    circuit_widths.packed_inputs = vm.count("pack-inputs") > 0;
+    if (vm.count("policy") && !read_scoring_policy(vm["policy"].as<std::string>(), active_policy)) {
+        return 1;
+    }
+    worker_threads = threads;
+    prove_memory_budget = memory_budget_mb << 20;
+
+    const boost::filesystem::path archive_path =
+        vm.count("archive") ? boost::filesystem::path(vm["archive"].as<std::string>()) : boost::filesystem::path();
+
+    int status = 0;
+    if (vm.count("setup")) {
+        status = trusted_setup(key_format, vm["key-cache"].as<std::string>()) ? 0 : 1;
+    } else if (vm.count("commit")) {
+        print_commitments(pa_id, pa_income, fi_overdue_loans, fi_account_age);
+    } else if (vm.count("commit-batch")) {
+        status = commit_batch(vm["commit-batch"].as<std::string>(), vm["commit-output"].as<std::string>(), threads) ?
+                     0 :
+                     1;
     } else if (vm.count("proof")) {
-        proof_generation(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+        status = proof_generation(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash,
+                                  archive_path) ? 0 : 1;
+    } else if (vm.count("proof-batch")) {
+        status = proof_batch(vm["proof-batch"].as<std::string>(), PROVING_KEY_PATH,
+                             vm["output-dir"].as<std::string>(), threads, archive_path) ? 0 : 1;
+    } else if (vm.count("archive-get")) {
+        if (archive_path.empty()) {
+            std::cout << "--archive-get needs --archive" << std::endl;
+            return 1;
+        }
+        status = extract_archived_proof(archive_path, vm["archive-get"].as<uint>()) ? 0 : 1;
+    } else if (vm.count("verify")) {
+        status = verification_key_matches() && verify_proof_files(PROOF_PATH, INPUT_PATH, VERIFICATION_KEY_PATH) &&
+                         (!vm.count("policy") || check_primary_input_policy(INPUT_PATH, active_policy, pa_data_hash,
+                                                                            fi_data_hash)) ?
+                     0 :
+                     1;
+    } else if (vm.count("build-payload")) {
+        status = verification_key_matches() &&
+                         build_payload(PROOF_PATH, INPUT_PATH, VERIFICATION_KEY_PATH,
+                                       vm["build-payload"].as<std::string>()) ?
+                     0 :
+                     1;
+    } else if (vm.count("preflight")) {
+        const std::vector<std::string> paths = vm["preflight"].as<std::vector<std::string>>();
+        status = verification_key_matches() &&
+                         preflight(std::vector<boost::filesystem::path>(paths.begin(), paths.end()),
+                                   VERIFICATION_KEY_PATH) ?
+                     0 :
+                     1;
+    } else if (vm.count("verify-batch")) {
+        if (vm.count("policy") && circuit_widths.packed_inputs) {
+            std::cout << "--verify-batch --policy cannot check packed primary inputs, which need the data hashes of "
+                         "each proof; check them one by one with --verify"
+                      << std::endl;
+            return 1;
+        }
+        std::function<bool(const typename scheme_type::primary_input_type &)> accepts_input;
+        if (vm.count("policy")) {
+            accepts_input = [&](const typename scheme_type::primary_input_type &primary_input) {
+                return primary_input_has_policy(compiled_circuit().layout, primary_input, active_policy);
+            };
+        }
+        status = verification_key_matches() &&
+                         verify_batch(vm["verify-batch"].as<std::string>(), VERIFICATION_KEY_PATH, accepts_input) ?
+                     0 :
+                     1;
+    } else if (vm.count("aggregation-setup")) {
+        status = aggregation_setup_file(AGGREGATION_SRS_PATH, vm["aggregation-setup"].as<std::size_t>()) ? 0 : 1;
+    } else if (vm.count("aggregate")) {
+        status = verification_key_matches() &&
+                         aggregate_directory(vm["aggregate"].as<std::string>(), AGGREGATION_SRS_PATH,
+                                             VERIFICATION_KEY_PATH, AGGREGATE_PATH) ?
+                     0 :
+                     1;
+    } else if (vm.count("verify-aggregate")) {
+        status = verification_key_matches() &&
+                         verify_aggregate_file(vm["verify-aggregate"].as<std::string>(), AGGREGATION_SRS_PATH,
+                                               VERIFICATION_KEY_PATH, AGGREGATE_PATH) ?
+                     0 :
+                     1;
+    } else if (vm.count("benchmark-aggregation")) {
+        status = verification_key_matches() &&
+                         benchmark_aggregation(vm["benchmark-aggregation"].as<std::string>(), AGGREGATION_SRS_PATH,
+                                               VERIFICATION_KEY_PATH) ?
+                     0 :
+                     1;
+    } else if (vm.count("export-key")) {
+        status = export_proving_key(vm["export-key"].as<std::string>(), key_format) ? 0 : 1;
+    } else if (vm.count("benchmark-key-formats")) {
+        status = benchmark_key_formats() ? 0 : 1;
+    } else if (vm.count("serve")) {
+        prover_service service(vm["socket"].as<std::string>(), PROVING_KEY_PATH, metrics_port, serve_proofs);
+        status = service.run();
+    }
+
+    if (vm.count("metrics-json") && !write_metrics(vm["metrics-json"].as<std::string>())) {
+        return 1;
     }
-    return 0;
+    return status;
 }
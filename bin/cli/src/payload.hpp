@@ -0,0 +1,247 @@
+#ifndef CLI_PAYLOAD_HPP
+#define CLI_PAYLOAD_HPP
+
+#include <cctype>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "verifier.hpp"
+
+// The blob the VerifyGroth16 contract hands to tvm.vergrth16: proof ++ pi ++ m_vkey, each in the
+// marshalling --proof and --setup write. The builtin reads the three parts one after another from
+// the front, the proof of fixed size and the primary input and key with their own size fields, and
+// nothing may follow the key. A payload that passes the pre-flight check below is split and
+// verified exactly that way, and its key must be the deployed one.
+
+std::vector<unit_type> vergrth16_payload(const std::vector<unit_type> &proof_byteblob,
+                                         const std::vector<unit_type> &primary_input_byteblob,
+                                         const std::vector<unit_type> &verification_key_byteblob) {
+    std::vector<unit_type> payload;
+    payload.reserve(proof_byteblob.size() + primary_input_byteblob.size() + verification_key_byteblob.size());
+    payload.insert(payload.end(), proof_byteblob.begin(), proof_byteblob.end());
+    payload.insert(payload.end(), primary_input_byteblob.begin(), primary_input_byteblob.end());
+    payload.insert(payload.end(), verification_key_byteblob.begin(), verification_key_byteblob.end());
+    return payload;
+}
+
+// The parts of a payload; the key bytes are kept to share its preparation between payloads
+struct vergrth16_parts {
+    typename scheme_type::proof_type proof;
+    typename scheme_type::primary_input_type primary_input;
+    std::vector<unit_type> verification_key_byteblob;
+};
+
+bool split_vergrth16_payload(const std::vector<unit_type> &payload, vergrth16_parts &parts, std::string &error) {
+    using proof_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_proof<
+        nil::marshalling::field_type<Endianness>, typename scheme_type::proof_type>;
+    using primary_input_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_primary_input<
+        nil::marshalling::field_type<Endianness>, typename scheme_type::primary_input_type>;
+    using verification_key_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_verification_key<
+        nil::marshalling::field_type<Endianness>, typename scheme_type::verification_key_type>;
+
+    auto iter = payload.begin();
+    auto remaining = [&]() { return std::size_t(std::distance(iter, payload.end())); };
+
+    proof_marshalling_type proof;
+    if (proof.read(iter, remaining()) != nil::marshalling::status_type::success) {
+        error = "malformed proof";
+        return false;
+    }
+    primary_input_marshalling_type primary_input;
+    if (primary_input.read(iter, remaining()) != nil::marshalling::status_type::success) {
+        error = "malformed primary input";
+        return false;
+    }
+    const auto verification_key_begin = iter;
+    verification_key_marshalling_type verification_key;
+    if (verification_key.read(iter, remaining()) != nil::marshalling::status_type::success) {
+        error = "malformed verification key";
+        return false;
+    }
+    if (remaining() != 0) {
+        error = std::to_string(remaining()) + " trailing bytes after the verification key";
+        return false;
+    }
+
+    parts.proof = nil::crypto3::marshalling::types::make_r1cs_gg_ppzksnark_proof<typename scheme_type::proof_type,
+                                                                                 Endianness>(proof);
+    parts.primary_input = nil::crypto3::marshalling::types::make_r1cs_gg_ppzksnark_primary_input<
+        typename scheme_type::primary_input_type, Endianness>(primary_input);
+    parts.verification_key_byteblob.assign(verification_key_begin, payload.end());
+    return true;
+}
+
+// Prepared verification keys by their bytes. Payloads normally all carry the deployed key, which
+// is then prepared once for all of them.
+class prepared_key_cache {
+  public:
+    std::shared_ptr<const prepared_verification_key> get(const std::vector<unit_type> &verification_key_byteblob) {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto found = keys.find(verification_key_byteblob);
+            if (found != keys.end()) {
+                return found->second;
+            }
+        }
+        typename scheme_type::verification_key_type verification_key;
+        if (!byteblob_to_verification_key(verification_key_byteblob, verification_key)) {
+            return nullptr;
+        }
+        auto prepared = std::make_shared<const prepared_verification_key>(prepare_verification_key(verification_key));
+
+        std::lock_guard<std::mutex> guard(mutex);
+        return keys.emplace(verification_key_byteblob, prepared).first->second;
+    }
+
+  private:
+    std::mutex mutex;
+    std::map<std::vector<unit_type>, std::shared_ptr<const prepared_verification_key>> keys;
+};
+
+// Payloads of a file: one payload in binary, or one hex payload per line as they are submitted
+bool read_payloads(boost::filesystem::path path, std::vector<std::vector<unit_type>> &payloads,
+                   std::vector<std::string> &names) {
+    std::vector<unit_type> content = readfile(path);
+    const bool hex = !content.empty() && std::all_of(content.begin(), content.end(), [](unit_type c) {
+        return std::isxdigit(c) || std::isspace(c);
+    });
+    if (!hex) {
+        payloads.push_back(std::move(content));
+        names.push_back(path.filename().string());
+        return true;
+    }
+
+    std::string text(content.begin(), content.end());
+    std::vector<std::string> lines;
+    boost::split(lines, text, boost::is_any_of("\n"));
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        const std::string line = boost::trim_copy(lines[i]);
+        if (line.empty()) {
+            continue;
+        }
+        payloads.emplace_back();
+        try {
+            boost::algorithm::unhex(line, std::back_inserter(payloads.back()));
+        } catch (const std::exception &) {
+            payloads.back().clear();
+        }
+        names.push_back(path.filename().string() + ":" + std::to_string(i + 1));
+    }
+    return true;
+}
+
+// Splits and verifies every payload, the payloads of each key in one batch (see verify_batch_range).
+// A payload carrying another key than deployed_key_byteblob fails.
+std::vector<verification_item> preflight_payloads(const std::vector<std::vector<unit_type>> &payloads,
+                                                  const std::vector<std::string> &names,
+                                                  const std::vector<unit_type> &deployed_key_byteblob,
+                                                  prepared_key_cache &keys) {
+    std::vector<verification_item> items(payloads.size());
+    std::vector<std::shared_ptr<const prepared_verification_key>> item_keys(payloads.size());
+
+    parallel_for(payloads.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        vergrth16_parts parts;
+        for (std::size_t i = begin; i < end; ++i) {
+            verification_item &item = items[i];
+            item.name = names[i];
+            if (!split_vergrth16_payload(payloads[i], parts, item.reason)) {
+                continue;
+            }
+            if (parts.verification_key_byteblob != deployed_key_byteblob) {
+                item.reason = "verification key is not the deployed v_key";
+                continue;
+            }
+            item_keys[i] = keys.get(parts.verification_key_byteblob);
+            if (!item_keys[i]) {
+                item.reason = "malformed verification key";
+                continue;
+            }
+            if (parts.primary_input.size() != item_keys[i]->verification_key.gamma_ABC_g1.domain_size()) {
+                item.reason = "primary input size does not match the verification key";
+                continue;
+            }
+            item.proof = parts.proof;
+            item.primary_input = std::move(parts.primary_input);
+            item.accumulated_input = accumulate_primary_input(item_keys[i]->verification_key, item.primary_input);
+            item.loaded = true;
+        }
+    });
+
+    std::map<const prepared_verification_key *, std::vector<verification_item *>> by_key;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (items[i].loaded) {
+            by_key[item_keys[i].get()].push_back(&items[i]);
+        }
+    }
+    for (const auto &group : by_key) {
+        find_invalid_proofs(*group.first, group.second, 0, group.second.size());
+    }
+    return items;
+}
+
+// Writes the payload of the proof, primary input and verification key files in binary and as hex
+bool build_payload(boost::filesystem::path proof_path,
+                   boost::filesystem::path primary_input_path,
+                   boost::filesystem::path verification_key_path,
+                   boost::filesystem::path payload_path) {
+    for (const boost::filesystem::path &path : {proof_path, primary_input_path, verification_key_path}) {
+        if (!boost::filesystem::exists(path)) {
+            std::cout << path << " not found" << std::endl;
+            return false;
+        }
+    }
+    const std::vector<unit_type> payload =
+        vergrth16_payload(readfile(proof_path), readfile(primary_input_path), readfile(verification_key_path));
+
+    const boost::filesystem::path hex_path = payload_path.string() + ".hex";
+    boost::filesystem::ofstream hex(hex_path, std::ios::out | std::ios::trunc);
+    hex << byteblob_to_hex(payload) << std::endl;
+    if (!writefile(payload_path, payload) || !hex.good()) {
+        std::cout << "Could not write " << payload_path << std::endl;
+        return false;
+    }
+    std::cout << "Payload of " << payload.size() << " bytes is saved to " << payload_path << " and " << hex_path
+              << std::endl;
+    return true;
+}
+
+// Pre-flight check of payload files, each either binary or hex lines, against the deployed key
+bool preflight(const std::vector<boost::filesystem::path> &paths, boost::filesystem::path verification_key_path) {
+    if (!boost::filesystem::exists(verification_key_path)) {
+        std::cout << "Verification key " << verification_key_path << " not found" << std::endl;
+        return false;
+    }
+    const std::vector<unit_type> deployed_key_byteblob = readfile(verification_key_path);
+
+    std::vector<std::vector<unit_type>> payloads;
+    std::vector<std::string> names;
+    for (const boost::filesystem::path &path : paths) {
+        if (!boost::filesystem::exists(path)) {
+            std::cout << "Payload file " << path << " not found" << std::endl;
+            return false;
+        }
+        read_payloads(path, payloads, names);
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    prepared_key_cache keys;
+    const std::vector<verification_item> items = preflight_payloads(payloads, names, deployed_key_byteblob, keys);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::size_t valid = 0;
+    for (const verification_item &item : items) {
+        valid += item.valid;
+        if (!item.valid) {
+            std::cout << item.name << ": " << item.reason << std::endl;
+        }
+    }
+    std::cout << "Pre-flight passed " << valid << " of " << items.size() << " payloads in " << elapsed << " s ("
+              << (elapsed > 0 ? items.size() / elapsed : 0) << " payloads/s)" << std::endl;
+    return valid == items.size();
+}
+
+#endif    // CLI_PAYLOAD_HPP
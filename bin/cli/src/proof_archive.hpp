@@ -0,0 +1,342 @@
+#ifndef CLI_PROOF_ARCHIVE_HPP
+#define CLI_PROOF_ARCHIVE_HPP
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "prover.hpp"
+
+// Append-only archive of proofs, two files:
+//
+//   <archive>        records: header | proof | primary input, one after another
+//   <archive>.index  one fixed-size entry per record: applicant id and record offset
+//
+// The record header holds the applicant id, the time the proof was archived, the digest of the
+// circuit it was proved for, both blob sizes and a CRC-32 of the blobs. A record is written before
+// its index entry, so an interrupted write leaves at most a record without an entry, which is
+// never found. Records of the same applicant are all kept; the last one is the current one.
+//
+// Readers map both files and hash the index once, 16 bytes per proof, keeping the latest record of
+// every applicant. A lookup then touches the one record it finds; the records are never scanned.
+
+constexpr const std::array<char, 8> proof_archive_magic = {'M', 'S', 'C', 'O', 'R', 'E', 'P', 'R'};
+
+struct proof_archive_record_header {
+    std::array<char, 8> magic;
+    std::uint32_t applicant_id;
+    std::uint32_t checksum;
+    std::uint64_t timestamp_ms;
+    std::array<std::uint8_t, 32> circuit_digest;
+    std::uint32_t proof_size;
+    std::uint32_t primary_input_size;
+};
+
+struct proof_archive_index_entry {
+    std::uint32_t applicant_id;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+};
+
+static_assert(sizeof(proof_archive_record_header) == 64, "record headers are packed");
+static_assert(sizeof(proof_archive_index_entry) == 16, "index entries are packed");
+
+boost::filesystem::path proof_archive_index_path(boost::filesystem::path archive_path) {
+    return archive_path.string() + ".index";
+}
+
+// One archived proof as a reader finds it
+struct archived_proof {
+    uint applicant_id = 0;
+    std::uint64_t timestamp_ms = 0;
+    std::string circuit_digest;
+    std::vector<unit_type> proof;
+    std::vector<unit_type> primary_input;
+};
+
+// Appends proofs from a background thread. append() only queues the proof; marshalling, the
+// checksum and the writes happen on the writer thread while the caller proves the next one. The
+// queue is bounded, so a slow disk holds the provers back instead of piling up proofs in memory.
+// The archive is locked for the lifetime of the writer, a second writer is refused.
+class proof_archive_writer {
+  public:
+    static constexpr const std::size_t max_pending = 256;
+
+    proof_archive_writer() = default;
+    proof_archive_writer(const proof_archive_writer &) = delete;
+    proof_archive_writer &operator=(const proof_archive_writer &) = delete;
+
+    ~proof_archive_writer() {
+        close();
+    }
+
+    bool open(boost::filesystem::path path) {
+        archive_path = path;
+
+        // flock rather than fcntl locks: those are per process and drop when any descriptor of
+        // the file closes
+        lock_descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (lock_descriptor < 0) {
+            std::cout << "Could not open archive " << path << std::endl;
+            return false;
+        }
+        if (::flock(lock_descriptor, LOCK_EX | LOCK_NB) != 0) {
+            std::cout << "Archive " << path << " is in use by another writer" << std::endl;
+            ::close(lock_descriptor);
+            lock_descriptor = -1;
+            return false;
+        }
+
+        records.open(path, std::ios::out | std::ios::binary | std::ios::app);
+        index.open(proof_archive_index_path(path), std::ios::out | std::ios::binary | std::ios::app);
+        if (!records || !index) {
+            std::cout << "Could not open archive " << path << std::endl;
+            return false;
+        }
+        offset = boost::filesystem::file_size(path);
+
+        const std::string &digest = compiled_circuit_digest();
+        boost::algorithm::unhex(digest.begin(), digest.end(), circuit_digest.begin());
+
+        running = true;
+        writer = std::thread([this]() { run(); });
+        return true;
+    }
+
+    // False once the writer is closed, the proof is not archived then
+    bool append(uint applicant_id, const typename scheme_type::proof_type &proof,
+                const r1cs_primary_input<field_type> &primary_input) {
+        std::unique_lock<std::mutex> guard(mutex);
+        space.wait(guard, [this]() { return pending.size() < max_pending || !running; });
+        if (!running) {
+            return false;
+        }
+        pending.push_back({applicant_id, proof, primary_input, now_ms()});
+        ready.notify_one();
+        return true;
+    }
+
+    // Writes everything queued and stops the writer; false if any write failed
+    bool close() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            running = false;
+        }
+        ready.notify_all();
+        space.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (records.is_open()) {
+            records.close();
+            index.close();
+        }
+        if (lock_descriptor >= 0) {
+            ::close(lock_descriptor);
+            lock_descriptor = -1;
+        }
+        return !failed;
+    }
+
+    std::size_t written() const {
+        return written_records;
+    }
+
+  private:
+    struct pending_proof {
+        uint applicant_id;
+        typename scheme_type::proof_type proof;
+        r1cs_primary_input<field_type> primary_input;
+        std::uint64_t timestamp_ms;
+    };
+
+    static std::uint64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void run() {
+        std::deque<pending_proof> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                ready.wait(guard, [this]() { return !pending.empty() || !running; });
+                if (pending.empty()) {
+                    return;
+                }
+                batch.swap(pending);
+            }
+            space.notify_all();
+
+            scoped_timer timer("archive_write");
+            for (const pending_proof &item : batch) {
+                write(item);
+            }
+            batch.clear();
+
+            // Records reach the disk before the index entries pointing at them. The lock descriptor
+            // is open on the record file, so syncing it syncs what the stream wrote.
+            records.flush();
+            if (!records.good() || ::fdatasync(lock_descriptor) != 0) {
+                failed = true;
+                continue;
+            }
+            for (const proof_archive_index_entry &entry : unflushed_entries) {
+                index.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            }
+            index.flush();
+            unflushed_entries.clear();
+            if (!records.good() || !index.good()) {
+                failed = true;
+            }
+        }
+    }
+
+    void write(const pending_proof &item) {
+        const std::vector<unit_type> proof_byteblob = proof_to_byteblob(item.proof);
+        const std::vector<unit_type> primary_input_byteblob = primary_input_to_byteblob(item.primary_input);
+
+        proof_archive_record_header header {};
+        header.magic = proof_archive_magic;
+        header.applicant_id = item.applicant_id;
+        header.timestamp_ms = item.timestamp_ms;
+        header.circuit_digest = circuit_digest;
+        header.proof_size = proof_byteblob.size();
+        header.primary_input_size = primary_input_byteblob.size();
+
+        boost::crc_32_type crc;
+        crc.process_bytes(proof_byteblob.data(), proof_byteblob.size());
+        crc.process_bytes(primary_input_byteblob.data(), primary_input_byteblob.size());
+        header.checksum = crc.checksum();
+
+        records.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        records.write(reinterpret_cast<const char *>(proof_byteblob.data()), proof_byteblob.size());
+        records.write(reinterpret_cast<const char *>(primary_input_byteblob.data()), primary_input_byteblob.size());
+
+        unflushed_entries.push_back({item.applicant_id, 0, offset});
+        offset += sizeof(header) + proof_byteblob.size() + primary_input_byteblob.size();
+        ++written_records;
+    }
+
+    boost::filesystem::path archive_path;
+    int lock_descriptor = -1;
+    boost::filesystem::ofstream records, index;
+    std::uint64_t offset = 0;
+    std::array<std::uint8_t, 32> circuit_digest {};
+
+    std::mutex mutex;
+    std::condition_variable ready, space;
+    std::deque<pending_proof> pending;
+    bool running = false;
+
+    std::thread writer;
+    std::vector<proof_archive_index_entry> unflushed_entries;
+    std::size_t written_records = 0;
+    bool failed = false;
+};
+
+// Maps an archive and its index for lookups
+class proof_archive_reader {
+  public:
+    bool open(boost::filesystem::path path, std::string &error) {
+        const boost::filesystem::path index_path = proof_archive_index_path(path);
+        if (!boost::filesystem::exists(path) || !boost::filesystem::exists(index_path)) {
+            error = "archive or index not found";
+            return false;
+        }
+        try {
+            if (boost::filesystem::file_size(path) > 0) {
+                records_mapping = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+                records_region = boost::interprocess::mapped_region(records_mapping, boost::interprocess::read_only);
+            }
+            if (boost::filesystem::file_size(index_path) > 0) {
+                index_mapping = boost::interprocess::file_mapping(index_path.c_str(), boost::interprocess::read_only);
+                index_region = boost::interprocess::mapped_region(index_mapping, boost::interprocess::read_only);
+            }
+        } catch (const boost::interprocess::interprocess_exception &e) {
+            error = e.what();
+            return false;
+        }
+
+        const unsigned char *index = static_cast<const unsigned char *>(index_region.get_address());
+        latest.clear();
+        latest.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            proof_archive_index_entry entry;
+            std::memcpy(&entry, index + i * sizeof(entry), sizeof(entry));
+            latest[entry.applicant_id] = entry.offset;
+        }
+        return true;
+    }
+
+    // Entries whose records are complete
+    std::size_t size() const {
+        return index_region.get_size() / sizeof(proof_archive_index_entry);
+    }
+
+    // The latest proof of the applicant
+    bool find(uint applicant_id, archived_proof &proof, std::string &error) const {
+        const auto found = latest.find(applicant_id);
+        if (found == latest.end()) {
+            error = "no proof of applicant " + std::to_string(applicant_id);
+            return false;
+        }
+        return read(found->second, proof, error);
+    }
+
+  private:
+    bool read(std::uint64_t offset, archived_proof &proof, std::string &error) const {
+        const unsigned char *records = static_cast<const unsigned char *>(records_region.get_address());
+        const std::size_t records_size = records_region.get_size();
+
+        proof_archive_record_header header;
+        if (offset + sizeof(header) > records_size) {
+            error = "index points past the end of the archive";
+            return false;
+        }
+        std::memcpy(&header, records + offset, sizeof(header));
+        const unsigned char *blobs = records + offset + sizeof(header);
+        if (header.magic != proof_archive_magic ||
+            offset + sizeof(header) + header.proof_size + header.primary_input_size > records_size) {
+            error = "malformed record";
+            return false;
+        }
+
+        boost::crc_32_type crc;
+        crc.process_bytes(blobs, header.proof_size + header.primary_input_size);
+        if (crc.checksum() != header.checksum) {
+            error = "checksum mismatch";
+            return false;
+        }
+
+        proof.applicant_id = header.applicant_id;
+        proof.timestamp_ms = header.timestamp_ms;
+        proof.circuit_digest.clear();
+        boost::algorithm::hex_lower(header.circuit_digest.begin(), header.circuit_digest.end(),
+                                    std::back_inserter(proof.circuit_digest));
+        proof.proof.assign(blobs, blobs + header.proof_size);
+        proof.primary_input.assign(blobs + header.proof_size, blobs + header.proof_size + header.primary_input_size);
+        return true;
+    }
+
+    boost::interprocess::file_mapping records_mapping, index_mapping;
+    boost::interprocess::mapped_region records_region, index_region;
+    std::unordered_map<std::uint32_t, std::uint64_t> latest;
+};
+
+#endif    // CLI_PROOF_ARCHIVE_HPP
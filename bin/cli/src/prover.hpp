@@ -0,0 +1,389 @@
+#ifndef CLI_PROVER_HPP
+#define CLI_PROVER_HPP
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "utils.hpp"
+#include "proving_key_file.hpp"
+#include "detail/circuit_digest.hpp"
+#include "detail/groth16_prover.hpp"
+#include "detail/multiscore_circuit.hpp"
+
+struct applicant_record {
+    uint pa_id = 0;
+    uint pa_income = 0;
+    uint fi_overdue_loans = 0;
+    uint fi_account_age = 0;
+    std::string pa_data_hash;
+    std::string fi_data_hash;
+};
+
+// Circuit variant of the process, set from --circuit before the circuit is first used. The wide
+// variant does not bind its commitments to the attributes, so it is never the default.
+multiscore_widths circuit_widths = multiscore_widths::compact();
+
+// Scoring policy every proof of the process is made under, set from --policy
+scoring_policy active_policy;
+
+// Bytes the proofs of the process may hold at a time, set from --memory-budget; 0 keeps the whole
+// proving key in memory
+std::size_t prove_memory_budget = 0;
+
+// JSON object with any of score_base, score_min, w_income, w_overdue_loans and w_account_age; the
+// values it leaves out keep their defaults
+bool read_scoring_policy(boost::filesystem::path path, scoring_policy &policy) {
+    if (!boost::filesystem::exists(path)) {
+        std::cout << "Policy file " << path << " not found" << std::endl;
+        return false;
+    }
+
+    scoring_policy read;
+    try {
+        boost::property_tree::ptree tree;
+        boost::property_tree::read_json(path.string(), tree);
+        read.score_base = tree.get<std::uint64_t>("score_base", read.score_base);
+        read.score_min = tree.get<std::uint64_t>("score_min", read.score_min);
+        read.w_income = tree.get<std::uint64_t>("w_income", read.w_income);
+        read.w_overdue_loans = tree.get<std::uint64_t>("w_overdue_loans", read.w_overdue_loans);
+        read.w_account_age = tree.get<std::uint64_t>("w_account_age", read.w_account_age);
+    } catch (const std::exception &) {
+        std::cout << "Policy file " << path << " is malformed" << std::endl;
+        return false;
+    }
+
+    std::string error;
+    if (!read.validate(error)) {
+        std::cout << "Policy file " << path << " is out of range: " << error << std::endl;
+        return false;
+    }
+    policy = read;
+    return true;
+}
+
+// Compiled on first use and shared by every proof of the process
+const multiscore_circuit<field_type> &compiled_circuit() {
+    static const multiscore_circuit<field_type> circuit(circuit_widths);
+    return circuit;
+}
+
+// Digest of the compiled circuit that keys are generated for and checked against
+const std::string &compiled_circuit_digest() {
+    static const std::string digest = circuit_digest(compiled_circuit().constraint_system);
+    return digest;
+}
+
+// Every key is tied to the digest of the circuit it was generated for. A proving key file carries
+// it in its header. The TVM proving key and v_key are used byte for byte, so theirs goes to
+// <key>.digest together with the SHA-256 of the key; a sidecar left next to another key is refused.
+boost::filesystem::path key_digest_path(boost::filesystem::path key_path) {
+    return key_path.string() + ".digest";
+}
+
+std::string key_bytes_digest(boost::filesystem::path key_path) {
+    const std::vector<unit_type> bytes = readfile(key_path);
+    std::string digest = nil::crypto3::hash<nil::crypto3::hashes::sha2<256>>(bytes.begin(), bytes.end());
+    return digest;
+}
+
+bool write_key_digest(boost::filesystem::path key_path) {
+    const boost::filesystem::path sidecar = key_digest_path(key_path);
+    if (is_proving_key_file(key_path)) {
+        boost::system::error_code ignored;
+        boost::filesystem::remove(sidecar, ignored);
+        return proving_key_file_digest(key_path) == compiled_circuit_digest();
+    }
+    boost::filesystem::ofstream stream(sidecar, std::ios::out | std::ios::trunc);
+    stream << compiled_circuit_digest() << " " << key_bytes_digest(key_path) << std::endl;
+    return stream.good();
+}
+
+bool check_key_digest(boost::filesystem::path key_path, const std::string &kind) {
+    std::string digest;
+    if (is_proving_key_file(key_path)) {
+        digest = proving_key_file_digest(key_path);
+    } else {
+        boost::filesystem::ifstream stream(key_digest_path(key_path));
+        std::string key_digest;
+        if (!(stream >> digest >> key_digest)) {
+            digest.clear();
+        } else if (key_digest != key_bytes_digest(key_path)) {
+            std::cout << kind << " " << key_path << " is not the key its digest file was written for, run --setup again"
+                      << std::endl;
+            return false;
+        }
+    }
+    if (digest.empty()) {
+        std::cout << kind << " " << key_path << " has no circuit digest, run --setup again" << std::endl;
+        return false;
+    }
+    if (digest != compiled_circuit_digest()) {
+        std::cout << kind << " " << key_path << " was generated for circuit " << digest
+                  << ", not for the current multiscore circuit " << compiled_circuit_digest()
+                  << ", run --setup again" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool open_proving_key_file(boost::filesystem::path path, mapped_proving_key &mapped) {
+    if (!check_key_digest(path, "Proving key")) {
+        return false;
+    }
+    std::string error;
+    if (!mapped.open(path, error)) {
+        std::cout << "Proving key " << path << " is malformed: " << error << std::endl;
+        return false;
+    }
+    if (!mapped.matches(compiled_circuit().constraint_system)) {
+        std::cout << "Proving key " << path << " does not match the multiscore circuit, run --setup again"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_proving_key(boost::filesystem::path path, typename scheme_type::proving_key_type &proving_key) {
+    scoped_timer timer("load_proving_key");
+    if (!boost::filesystem::exists(path)) {
+        std::cout << "Proving key " << path << " not found, run --setup first" << std::endl;
+        return false;
+    }
+
+    const r1cs_constraint_system<field_type> &circuit_constraint_system = compiled_circuit().constraint_system;
+
+    if (is_proving_key_file(path)) {
+        mapped_proving_key mapped;
+        if (!open_proving_key_file(path, mapped)) {
+            return false;
+        }
+        std::string error;
+        if (!mapped.to_proving_key(circuit_constraint_system, proving_key, error)) {
+            std::cout << "Proving key " << path << " is malformed: " << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    if (!check_key_digest(path, "Proving key")) {
+        return false;
+    }
+    std::vector<std::uint8_t> proving_key_byteblob = readfile(path);
+    nil::marshalling::status_type provingProcessingStatus = nil::marshalling::status_type::success;
+    proving_key = deserializer_tvm::proving_key_process(
+        proving_key_byteblob.cbegin(),
+        proving_key_byteblob.cend(),
+        provingProcessingStatus);
+
+    if (provingProcessingStatus != nil::marshalling::status_type::success) {
+        std::cout << "Proving key " << path << " is malformed" << std::endl;
+        return false;
+    }
+
+    // The key has to be produced by --setup for the circuit this binary proves
+    const r1cs_constraint_system<field_type> &key_constraint_system = proving_key.constraint_system;
+    if (key_constraint_system.num_inputs() != circuit_constraint_system.num_inputs() ||
+        key_constraint_system.num_variables() != circuit_constraint_system.num_variables() ||
+        key_constraint_system.num_constraints() != circuit_constraint_system.num_constraints()) {
+        std::cout << "Proving key " << path << " does not match the multiscore circuit, run --setup again"
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Key that streams its queries from a proving key file, with chunks sized so that
+// concurrent_proofs proofs of proof_threads threads each stay within prove_memory_budget
+bool open_streamed_proving_key(boost::filesystem::path path,
+                               groth16_proving_key &key,
+                               std::size_t concurrent_proofs,
+                               std::size_t proof_threads) {
+    scoped_timer timer("load_proving_key");
+    if (!boost::filesystem::exists(path)) {
+        std::cout << "Proving key " << path << " not found, run --setup first" << std::endl;
+        return false;
+    }
+    if (!is_proving_key_file(path)) {
+        std::cout << "Proving key " << path << " is in the tvm format, --memory-budget needs the mapped or "
+                  << "compressed one (see --key-format and --export-key)" << std::endl;
+        return false;
+    }
+    if (!check_key_digest(path, "Proving key")) {
+        return false;
+    }
+
+    auto reader = std::make_shared<proving_key_file_reader>();
+    std::string error;
+    if (!reader->open(path, error)) {
+        std::cout << "Proving key " << path << " is malformed: " << error << std::endl;
+        return false;
+    }
+    const r1cs_constraint_system<field_type> &constraint_system = compiled_circuit().constraint_system;
+    if (!reader->matches(constraint_system)) {
+        std::cout << "Proving key " << path << " does not match the multiscore circuit, run --setup again"
+                  << std::endl;
+        return false;
+    }
+
+    const std::size_t buffer_bytes =
+        groth16_proof_buffer_bytes(constraint_system.num_variables(), reader->count(section_H_query),
+                                   reader->count(section_B_query_indices));
+    const std::size_t chunk_points = groth16_stream_chunk_points(prove_memory_budget / concurrent_proofs,
+                                                                 buffer_bytes, reader->compressed(), proof_threads);
+    if (!chunk_points) {
+        std::cout << "Memory budget of " << (prove_memory_budget >> 20) << " MB is too small for "
+                  << concurrent_proofs << " concurrent proofs, each holds about " << (buffer_bytes >> 20)
+                  << " MB besides the key" << std::endl;
+        return false;
+    }
+    if (!groth16_proving_key::from_stream(reader, chunk_points, key)) {
+        std::cout << "Proving key " << path << " is malformed" << std::endl;
+        return false;
+    }
+    std::cout << "Streaming the proving key in chunks of " << chunk_points << " points, "
+              << concurrent_proofs << " proofs within " << (prove_memory_budget >> 20) << " MB" << std::endl;
+    return true;
+}
+
+// Key for the native prover. An uncompressed mapped file is used in place; every other format is
+// decoded into memory first. Under a memory budget the queries are streamed from the file instead,
+// see open_streamed_proving_key.
+bool load_groth16_proving_key(boost::filesystem::path path,
+                              groth16_proving_key &key,
+                              std::size_t concurrent_proofs = 1,
+                              std::size_t proof_threads = worker_threads) {
+    if (prove_memory_budget) {
+        return open_streamed_proving_key(path, key, concurrent_proofs, proof_threads);
+    }
+    if (boost::filesystem::exists(path) && is_proving_key_file(path)) {
+        scoped_timer timer("load_proving_key");
+        auto mapped = std::make_shared<mapped_proving_key>();
+        if (!open_proving_key_file(path, *mapped)) {
+            return false;
+        }
+        if (!mapped->compressed()) {
+            key = groth16_proving_key::from_mapping(std::move(mapped));
+            return true;
+        }
+    }
+
+    typename scheme_type::proving_key_type proving_key;
+    if (!load_proving_key(path, proving_key)) {
+        return false;
+    }
+    key = groth16_proving_key::from_proving_key(std::move(proving_key));
+    return true;
+}
+
+// Writes the proving key either in the TVM serialization or as a mappable proving key file. The
+// key is the one of the compiled circuit, whose digest goes with it (see write_key_digest).
+bool save_proving_key(boost::filesystem::path path, const typename scheme_type::proving_key_type &proving_key,
+                      const std::string &format) {
+    const bool written = format == "mapped" || format == "compressed" ?
+                             write_proving_key_file(path, proving_key, format == "compressed",
+                                                    compiled_circuit_digest()) :
+                             writefile(path, serializer_tvm::process(proving_key));
+    return written && write_key_digest(path);
+}
+
+// Pre-flight of an applicant: the commitments and the score comparison the circuit enforces,
+// evaluated natively in microseconds without keys, blueprint or witness. An applicant it rejects
+// leaves the blueprint unsatisfied, so callers run it before loading keys and proving and report
+// reason instead.
+bool evaluate_applicant(const applicant_record &applicant,
+                        const scoring_policy &policy,
+                        const multiscore_widths &widths,
+                        std::string &reason) {
+    if (!is_field_element_hex(applicant.pa_data_hash) || !is_field_element_hex(applicant.fi_data_hash)) {
+        reason = "data hashes must be " + std::to_string(2 * modulus_chunks) + " hex digits";
+        return false;
+    }
+
+    const score_type score = policy.score(applicant.pa_income, applicant.fi_overdue_loans, applicant.fi_account_age);
+    if (score < score_type(policy.score_min)) {
+        reason = "score " + score.str() + " is below score_min " + std::to_string(policy.score_min);
+        return false;
+    }
+
+    if (multiscore_commitment_hash(widths, applicant.pa_id, applicant.pa_income) !=
+        hex_to_field_element(applicant.pa_data_hash)) {
+        reason = "PA data hash does not match id and income";
+        return false;
+    }
+    if (multiscore_commitment_hash(widths, applicant.fi_overdue_loans, applicant.fi_account_age) !=
+        hex_to_field_element(applicant.fi_data_hash)) {
+        reason = "FI data hash does not match overdue loans and account age";
+        return false;
+    }
+    return true;
+}
+
+bool evaluate_applicant(const applicant_record &applicant, std::string &reason) {
+    scoped_timer timer("evaluate_applicant");
+    const bool eligible = evaluate_applicant(applicant, active_policy, circuit_widths, reason);
+    if (!eligible) {
+        metrics_registry::instance().increment("proofs_ineligible_total");
+    }
+    return eligible;
+}
+
+// Fills the witness of the compiled circuit and proves it; the witness buffer is reused by the caller
+bool prove_applicant(multiscore_witness<field_type> &witness,
+                     const groth16_proving_key &proving_key,
+                     const applicant_record &applicant,
+                     typename scheme_type::proof_type &proof,
+                     r1cs_primary_input<field_type> &primary_input,
+                     bool verbose = false,
+                     std::size_t threads = worker_threads) {
+    witness.generate_r1cs_witness(applicant.pa_id, applicant.pa_income, applicant.fi_overdue_loans,
+                                  applicant.fi_account_age, applicant.pa_data_hash, applicant.fi_data_hash,
+                                  active_policy);
+
+    const bool satisfied = witness.is_satisfied();
+    if (verbose) {
+        witness.print(std::cout);
+        std::cout << "Blueprint is satisfied: " << satisfied << std::endl;
+    }
+    if (!satisfied) {
+        metrics_registry::instance().increment("proofs_unsatisfied_total");
+        return false;
+    }
+
+    primary_input = witness.primary_input();
+    proof = groth16_prove(proving_key, witness.circuit.constraint_system, primary_input, witness.auxiliary_input(),
+                          threads);
+    metrics_registry::instance().increment("proofs_total");
+    return true;
+}
+
+// Same, marshalled for the files and the contract
+bool generate_proof(multiscore_witness<field_type> &witness,
+                    const groth16_proving_key &proving_key,
+                    const applicant_record &applicant,
+                    std::vector<unit_type> &proof_byteblob,
+                    std::vector<unit_type> &primary_input_byteblob,
+                    bool verbose = false,
+                    std::size_t threads = worker_threads) {
+    typename scheme_type::proof_type proof;
+    r1cs_primary_input<field_type> primary_input;
+    if (!prove_applicant(witness, proving_key, applicant, proof, primary_input, verbose, threads)) {
+        return false;
+    }
+
+    scoped_timer timer("marshal");
+    proof_byteblob = proof_to_byteblob(proof);
+    primary_input_byteblob = primary_input_to_byteblob(primary_input);
+    return true;
+}
+
+bool generate_proof(const groth16_proving_key &proving_key,
+                    const applicant_record &applicant,
+                    std::vector<unit_type> &proof_byteblob,
+                    std::vector<unit_type> &primary_input_byteblob,
+                    bool verbose = false) {
+    multiscore_witness<field_type> witness(compiled_circuit());
+    return generate_proof(witness, proving_key, applicant, proof_byteblob, primary_input_byteblob, verbose);
+}
+
+#endif    // CLI_PROVER_HPP
@@ -0,0 +1,586 @@
+#ifndef CLI_PROVING_KEY_FILE_HPP
+#define CLI_PROVING_KEY_FILE_HPP
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+#include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+#include "detail/point_encoding.hpp"
+
+// Proving key container meant to be mmap'ed. Points are stored exactly as the prover holds them in
+// memory (projective coordinates in Montgomery form), so opening a key decodes nothing: the
+// sections are used in place. The layout is therefore tied to the build that wrote it; element
+// sizes are recorded in the header and checked on open.
+//
+//   header | section table | padding | sections, each aligned to proving_key_file_alignment
+//
+// The constraint system is not stored, it comes from the compiled circuit. Its sizes are recorded
+// so a key produced for another circuit is refused.
+//
+// The header also carries the digest of the circuit the key was generated for (see
+// circuit_digest.hpp), which every load checks against the compiled circuit.
+//
+// With proving_key_file_compressed set the point sections hold compressed points instead. Such a
+// file is about a third of the mapped one and portable across builds, but loading has to
+// decompress every point.
+
+static_assert(std::is_trivially_copyable<g1_value_type>::value, "G1 points have to be plain limb arrays");
+static_assert(std::is_trivially_copyable<g2_value_type>::value, "G2 points have to be plain limb arrays");
+
+constexpr const std::array<char, 8> proving_key_file_magic = {'M', 'S', 'C', 'O', 'R', 'E', 'P', 'K'};
+constexpr const std::uint32_t proving_key_file_version = 2;
+constexpr const std::size_t proving_key_file_alignment = 64;
+
+constexpr const std::uint32_t proving_key_file_compressed = 1;
+
+enum proving_key_file_section_id : std::uint32_t {
+    section_alpha_g1,
+    section_beta_g1,
+    section_beta_g2,
+    section_delta_g1,
+    section_delta_g2,
+    section_A_query,
+    section_B_query_indices,
+    section_B_query_g,
+    section_B_query_h,
+    section_H_query,
+    section_L_query,
+    proving_key_file_section_count
+};
+
+struct proving_key_file_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint32_t g1_size;
+    std::uint32_t g2_size;
+    std::uint32_t section_count;
+    // CRC-32 of every byte after the section table
+    std::uint32_t checksum;
+    std::uint64_t num_inputs;
+    std::uint64_t num_variables;
+    std::uint64_t num_constraints;
+    std::uint64_t B_query_domain_size;
+    std::array<std::uint8_t, 32> circuit_digest;
+};
+
+struct proving_key_file_section {
+    std::uint32_t id;
+    std::uint32_t element_size;
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+constexpr std::size_t proving_key_file_payload_offset() {
+    return (sizeof(proving_key_file_header) +
+            proving_key_file_section_count * sizeof(proving_key_file_section) + proving_key_file_alignment - 1) /
+           proving_key_file_alignment * proving_key_file_alignment;
+}
+
+std::uint32_t proving_key_file_element_size(std::uint32_t id, bool compressed) {
+    switch (id) {
+        case section_B_query_indices:
+            return sizeof(std::uint64_t);
+        case section_beta_g2:
+        case section_delta_g2:
+        case section_B_query_g:
+            return compressed ? compressed_g2_size : sizeof(g2_value_type);
+        default:
+            return compressed ? compressed_g1_size : sizeof(g1_value_type);
+    }
+}
+
+bool is_proving_key_file(boost::filesystem::path path) {
+    boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+    std::array<char, 8> magic {};
+    stream.read(magic.data(), magic.size());
+    return stream.good() && magic == proving_key_file_magic;
+}
+
+// Circuit digest of a proving key file in hex, empty when the file has no header of this version
+std::string proving_key_file_digest(boost::filesystem::path path) {
+    boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+    proving_key_file_header header {};
+    stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!stream.good() || header.magic != proving_key_file_magic || header.version != proving_key_file_version) {
+        return std::string();
+    }
+    std::string digest;
+    boost::algorithm::hex_lower(header.circuit_digest.begin(), header.circuit_digest.end(), std::back_inserter(digest));
+    return digest;
+}
+
+// Contiguous run of elements inside the mapping
+template<typename T>
+struct mapped_section {
+    const T *data = nullptr;
+    std::size_t size = 0;
+
+    const T *begin() const {
+        return data;
+    }
+    const T *end() const {
+        return data + size;
+    }
+    const T &operator[](std::size_t i) const {
+        return data[i];
+    }
+};
+
+typedef std::array<proving_key_file_section, proving_key_file_section_count> proving_key_file_table;
+
+// Section counts against the sizes of the circuit recorded in the header, which matches() compares
+// with the compiled one. The prover indexes the assignment by these counts: A has one point per
+// variable and the constant, L one per auxiliary variable, and H one less than the radix-2 QAP
+// domain the circuit is padded to (see pad_to_radix2_domain).
+bool check_proving_key_file_counts(const proving_key_file_header &header,
+                                   const proving_key_file_table &table,
+                                   std::string &error) {
+    constexpr std::uint64_t max_size = std::uint64_t(1) << 40;
+    if (header.num_variables >= max_size || header.num_constraints >= max_size ||
+        header.num_inputs > header.num_variables) {
+        error = "inconsistent circuit sizes";
+        return false;
+    }
+    std::uint64_t domain_size = 1;
+    while (domain_size < header.num_constraints + header.num_inputs + 1) {
+        domain_size <<= 1;
+    }
+    const auto count = [&](proving_key_file_section_id id) { return table[id].count; };
+    if (header.B_query_domain_size != header.num_variables + 1 ||
+        count(section_alpha_g1) != 1 || count(section_beta_g1) != 1 || count(section_beta_g2) != 1 ||
+        count(section_delta_g1) != 1 || count(section_delta_g2) != 1 ||
+        count(section_A_query) != header.num_variables + 1 ||
+        count(section_B_query_g) != count(section_B_query_indices) ||
+        count(section_B_query_h) != count(section_B_query_indices) ||
+        count(section_B_query_indices) > header.B_query_domain_size || count(section_H_query) != domain_size - 1 ||
+        count(section_L_query) != header.num_variables - header.num_inputs) {
+        error = "inconsistent section sizes";
+        return false;
+    }
+    return true;
+}
+
+// Header and section table of a file of file_size bytes as this build reads them
+bool check_proving_key_file_layout(const proving_key_file_header &header,
+                                   const proving_key_file_table &table,
+                                   std::size_t file_size,
+                                   std::string &error) {
+    const bool compressed = header.flags & proving_key_file_compressed;
+    if (header.magic != proving_key_file_magic) {
+        error = "not a proving key file";
+        return false;
+    }
+    if (header.version != proving_key_file_version) {
+        error = "unsupported version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.section_count != proving_key_file_section_count) {
+        error = "unexpected section count";
+        return false;
+    }
+    if (!compressed && (header.g1_size != sizeof(g1_value_type) || header.g2_size != sizeof(g2_value_type))) {
+        error = "point layout differs from this build, re-export the key";
+        return false;
+    }
+
+    for (const proving_key_file_section &section : table) {
+        if (section.id >= proving_key_file_section_count ||
+            section.element_size != proving_key_file_element_size(section.id, compressed) ||
+            table[section.id].id != section.id) {
+            error = "malformed section table";
+            return false;
+        }
+        if (section.offset % proving_key_file_alignment || section.offset > file_size ||
+            section.count > (file_size - section.offset) / section.element_size) {
+            error = "section " + std::to_string(section.id) + " is out of bounds";
+            return false;
+        }
+    }
+    return check_proving_key_file_counts(header, table, error);
+}
+
+// Every entry of the B query indices has to index the full variable assignment, which the prover
+// reads without bounds checks
+bool check_proving_key_file_indices(const proving_key_file_header &header,
+                                    const std::uint64_t *indices,
+                                    std::size_t count,
+                                    std::string &error) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (indices[i] > header.num_variables) {
+            error = "B query index " + std::to_string(indices[i]) + " is out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+// circuit_digest is the hex digest of the circuit the key belongs to
+bool write_proving_key_file(boost::filesystem::path path,
+                            const typename scheme_type::proving_key_type &proving_key,
+                            bool compressed,
+                            const std::string &circuit_digest) {
+    struct section_source {
+        const void *data;
+        std::uint64_t count;
+    };
+
+    const auto &B_query = proving_key.B_query;
+    std::vector<std::uint64_t> B_query_indices(B_query.indices.begin(), B_query.indices.end());
+    std::vector<g2_value_type> B_query_g;
+    std::vector<g1_value_type> B_query_h;
+    B_query_g.reserve(B_query.values.size());
+    B_query_h.reserve(B_query.values.size());
+    for (const auto &value : B_query.values) {
+        B_query_g.push_back(value.g);
+        B_query_h.push_back(value.h);
+    }
+
+    std::array<section_source, proving_key_file_section_count> sources = {{
+        {&proving_key.alpha_g1, 1},
+        {&proving_key.beta_g1, 1},
+        {&proving_key.beta_g2, 1},
+        {&proving_key.delta_g1, 1},
+        {&proving_key.delta_g2, 1},
+        {proving_key.A_query.data(), proving_key.A_query.size()},
+        {B_query_indices.data(), B_query_indices.size()},
+        {B_query_g.data(), B_query_g.size()},
+        {B_query_h.data(), B_query_h.size()},
+        {proving_key.H_query.data(), proving_key.H_query.size()},
+        {proving_key.L_query.data(), proving_key.L_query.size()},
+    }};
+
+    std::array<std::vector<unsigned char>, proving_key_file_section_count> encoded;
+    if (compressed) {
+        for (std::uint32_t i = 0; i < proving_key_file_section_count; ++i) {
+            if (i == section_B_query_indices) {
+                continue;
+            }
+            if (proving_key_file_element_size(i, true) == compressed_g2_size) {
+                encoded[i] = compress_points(static_cast<const g2_value_type *>(sources[i].data), sources[i].count);
+            } else {
+                encoded[i] = compress_points(static_cast<const g1_value_type *>(sources[i].data), sources[i].count);
+            }
+            sources[i].data = encoded[i].data();
+        }
+    }
+
+    proving_key_file_header header {};
+    header.magic = proving_key_file_magic;
+    header.version = proving_key_file_version;
+    header.flags = compressed ? proving_key_file_compressed : 0;
+    header.g1_size = sizeof(g1_value_type);
+    header.g2_size = sizeof(g2_value_type);
+    header.section_count = proving_key_file_section_count;
+    header.num_inputs = proving_key.constraint_system.num_inputs();
+    header.num_variables = proving_key.constraint_system.num_variables();
+    header.num_constraints = proving_key.constraint_system.num_constraints();
+    header.B_query_domain_size = B_query.domain_size();
+    if (circuit_digest.size() != 2 * header.circuit_digest.size()) {
+        return false;
+    }
+    boost::algorithm::unhex(circuit_digest.begin(), circuit_digest.end(), header.circuit_digest.begin());
+
+    proving_key_file_table table {};
+    std::uint64_t offset = proving_key_file_payload_offset();
+    for (std::uint32_t i = 0; i < proving_key_file_section_count; ++i) {
+        table[i] = {i, proving_key_file_element_size(i, compressed), offset, sources[i].count};
+        offset += table[i].element_size * sources[i].count;
+        offset = (offset + proving_key_file_alignment - 1) / proving_key_file_alignment * proving_key_file_alignment;
+    }
+
+    boost::filesystem::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(table.data()), sizeof(proving_key_file_section) * table.size());
+
+    boost::crc_32_type crc;
+    const std::array<char, proving_key_file_alignment> padding {};
+    std::uint64_t position = sizeof(header) + sizeof(proving_key_file_section) * table.size();
+    for (std::uint32_t i = 0; i < proving_key_file_section_count; ++i) {
+        if (position < table[i].offset) {
+            stream.write(padding.data(), table[i].offset - position);
+            crc.process_bytes(padding.data(), table[i].offset - position);
+        }
+        std::size_t bytes = table[i].element_size * sources[i].count;
+        stream.write(static_cast<const char *>(sources[i].data), bytes);
+        crc.process_bytes(sources[i].data, bytes);
+        position = table[i].offset + bytes;
+    }
+
+    header.checksum = crc.checksum();
+    stream.seekp(0);
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    return stream.good();
+}
+
+// Read-only mapping of a proving key file. Sections point into the mapping and stay valid as long
+// as the object lives. Typed point sections are only set for uncompressed files.
+class mapped_proving_key {
+  public:
+    bool open(boost::filesystem::path path, std::string &error) {
+        try {
+            mapping = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+            region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+        } catch (const boost::interprocess::interprocess_exception &e) {
+            error = e.what();
+            return false;
+        }
+
+        const unsigned char *base = static_cast<const unsigned char *>(region.get_address());
+        const std::size_t file_size = region.get_size();
+        if (file_size < proving_key_file_payload_offset()) {
+            error = "truncated header";
+            return false;
+        }
+
+        std::memcpy(&header, base, sizeof(header));
+        std::memcpy(table.data(), base + sizeof(header), sizeof(proving_key_file_section) * table.size());
+        if (!check_proving_key_file_layout(header, table, file_size, error)) {
+            return false;
+        }
+
+        boost::crc_32_type crc;
+        crc.process_bytes(base + sizeof(header) + sizeof(proving_key_file_section) * table.size(),
+                          file_size - sizeof(header) - sizeof(proving_key_file_section) * table.size());
+        if (crc.checksum() != header.checksum) {
+            error = "checksum mismatch";
+            return false;
+        }
+
+        B_query_indices = section<std::uint64_t>(section_B_query_indices);
+        if (!check_proving_key_file_indices(header, B_query_indices.data, B_query_indices.size, error)) {
+            return false;
+        }
+        if (compressed()) {
+            return true;
+        }
+
+        alpha_g1 = section<g1_value_type>(section_alpha_g1)[0];
+        beta_g1 = section<g1_value_type>(section_beta_g1)[0];
+        beta_g2 = section<g2_value_type>(section_beta_g2)[0];
+        delta_g1 = section<g1_value_type>(section_delta_g1)[0];
+        delta_g2 = section<g2_value_type>(section_delta_g2)[0];
+        A_query = section<g1_value_type>(section_A_query);
+        B_query_g = section<g2_value_type>(section_B_query_g);
+        B_query_h = section<g1_value_type>(section_B_query_h);
+        H_query = section<g1_value_type>(section_H_query);
+        L_query = section<g1_value_type>(section_L_query);
+        return true;
+    }
+
+    // The section counts were checked against these sizes on open
+    bool matches(const r1cs_constraint_system<field_type> &constraint_system) const {
+        return header.num_inputs == constraint_system.num_inputs() &&
+               header.num_variables == constraint_system.num_variables() &&
+               header.num_constraints == constraint_system.num_constraints();
+    }
+
+    bool compressed() const {
+        return header.flags & proving_key_file_compressed;
+    }
+
+    // Builds the library proving key, which owns its points: mapped points are copied in bulk
+    // without decoding anything, compressed ones are decompressed and checked across all threads.
+    // Only groth16_proving_key::from_mapping uses a mapped key in place.
+    bool to_proving_key(const r1cs_constraint_system<field_type> &constraint_system,
+                        typename scheme_type::proving_key_type &proving_key,
+                        std::string &error) const {
+        std::vector<g1_value_type> alpha_g1, beta_g1, delta_g1, A_query, B_query_h, H_query, L_query;
+        std::vector<g2_value_type> beta_g2, delta_g2, B_query_g;
+
+        if (compressed()) {
+            if (!decompress_section(section_alpha_g1, alpha_g1) || !decompress_section(section_beta_g1, beta_g1) ||
+                !decompress_section(section_beta_g2, beta_g2) || !decompress_section(section_delta_g1, delta_g1) ||
+                !decompress_section(section_delta_g2, delta_g2) || !decompress_section(section_A_query, A_query) ||
+                !decompress_section(section_B_query_g, B_query_g) ||
+                !decompress_section(section_B_query_h, B_query_h) ||
+                !decompress_section(section_H_query, H_query) || !decompress_section(section_L_query, L_query)) {
+                error = "invalid compressed point";
+                return false;
+            }
+        } else {
+            alpha_g1.assign(1, this->alpha_g1);
+            beta_g1.assign(1, this->beta_g1);
+            beta_g2.assign(1, this->beta_g2);
+            delta_g1.assign(1, this->delta_g1);
+            delta_g2.assign(1, this->delta_g2);
+            A_query.assign(this->A_query.begin(), this->A_query.end());
+            B_query_g.assign(this->B_query_g.begin(), this->B_query_g.end());
+            B_query_h.assign(this->B_query_h.begin(), this->B_query_h.end());
+            H_query.assign(this->H_query.begin(), this->H_query.end());
+            L_query.assign(this->L_query.begin(), this->L_query.end());
+        }
+
+        if (alpha_g1.size() != 1 || beta_g1.size() != 1 || beta_g2.size() != 1 || delta_g1.size() != 1 ||
+            delta_g2.size() != 1 || B_query_g.size() != B_query_h.size() ||
+            B_query_g.size() != B_query_indices.size) {
+            error = "inconsistent section sizes";
+            return false;
+        }
+
+        knowledge_commitment_vector<typename curve_type::g2_type, typename curve_type::g1_type> B_query;
+        B_query.domain_size_ = header.B_query_domain_size;
+        B_query.indices.assign(B_query_indices.begin(), B_query_indices.end());
+        B_query.values.reserve(B_query_g.size());
+        for (std::size_t i = 0; i < B_query_g.size(); ++i) {
+            B_query.values.emplace_back(B_query_g[i], B_query_h[i]);
+        }
+
+        proving_key = typename scheme_type::proving_key_type(
+            std::move(alpha_g1[0]), std::move(beta_g1[0]), std::move(beta_g2[0]), std::move(delta_g1[0]),
+            std::move(delta_g2[0]), std::move(A_query), std::move(B_query), std::move(H_query), std::move(L_query),
+            r1cs_constraint_system<field_type>(constraint_system));
+        return true;
+    }
+
+    std::size_t size() const {
+        return region.get_size();
+    }
+
+    proving_key_file_header header {};
+
+    g1_value_type alpha_g1, beta_g1, delta_g1;
+    g2_value_type beta_g2, delta_g2;
+    mapped_section<g1_value_type> A_query;
+    mapped_section<std::uint64_t> B_query_indices;
+    mapped_section<g2_value_type> B_query_g;
+    mapped_section<g1_value_type> B_query_h;
+    mapped_section<g1_value_type> H_query;
+    mapped_section<g1_value_type> L_query;
+
+  private:
+    template<typename PointType>
+    bool decompress_section(proving_key_file_section_id id, std::vector<PointType> &points) const {
+        mapped_section<unsigned char> bytes = section<unsigned char>(id);
+        return decompress_points(bytes.data, table[id].count, points);
+    }
+
+    template<typename T>
+    mapped_section<T> section(proving_key_file_section_id id) const {
+        const proving_key_file_section &entry = table[id];
+        mapped_section<T> result;
+        result.data = reinterpret_cast<const T *>(static_cast<const unsigned char *>(region.get_address()) +
+                                                  entry.offset);
+        result.size = entry.count;
+        return result;
+    }
+
+    boost::interprocess::file_mapping mapping;
+    boost::interprocess::mapped_region region;
+    proving_key_file_table table {};
+};
+
+// Reads ranges of a proving key file through a descriptor instead of mapping it, so that only the
+// range being read is ever held in memory. Opening checks the layout and the checksum in one pass
+// of fixed-size blocks. The reads are positioned, one reader serves any number of threads.
+class proving_key_file_reader {
+  public:
+    static constexpr const std::size_t checksum_block_size = 1 << 20;
+
+    proving_key_file_reader() = default;
+    proving_key_file_reader(const proving_key_file_reader &) = delete;
+    proving_key_file_reader &operator=(const proving_key_file_reader &) = delete;
+
+    ~proving_key_file_reader() {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+
+    bool open(boost::filesystem::path path, std::string &error) {
+        descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            error = "cannot open";
+            return false;
+        }
+        const std::size_t file_size = boost::filesystem::file_size(path);
+        if (file_size < proving_key_file_payload_offset() || !read_bytes(0, &header, sizeof(header)) ||
+            !read_bytes(sizeof(header), table.data(), sizeof(proving_key_file_section) * table.size())) {
+            error = "truncated header";
+            return false;
+        }
+        if (!check_proving_key_file_layout(header, table, file_size, error)) {
+            return false;
+        }
+
+        boost::crc_32_type crc;
+        std::vector<unsigned char> block(checksum_block_size);
+        for (std::size_t offset = sizeof(header) + sizeof(proving_key_file_section) * table.size();
+             offset < file_size; offset += block.size()) {
+            const std::size_t bytes = std::min(block.size(), file_size - offset);
+            if (!read_bytes(offset, block.data(), bytes)) {
+                error = "read failed";
+                return false;
+            }
+            crc.process_bytes(block.data(), bytes);
+        }
+        if (crc.checksum() != header.checksum) {
+            error = "checksum mismatch";
+            return false;
+        }
+        return true;
+    }
+
+    bool matches(const r1cs_constraint_system<field_type> &constraint_system) const {
+        return header.num_inputs == constraint_system.num_inputs() &&
+               header.num_variables == constraint_system.num_variables() &&
+               header.num_constraints == constraint_system.num_constraints();
+    }
+
+    bool compressed() const {
+        return header.flags & proving_key_file_compressed;
+    }
+
+    std::size_t count(proving_key_file_section_id id) const {
+        return table[id].count;
+    }
+
+    // Elements [begin, begin + count) of a section, points decompressed when the file is compressed
+    template<typename T>
+    bool read(proving_key_file_section_id id, std::size_t begin, std::size_t count, std::vector<T> &elements) const {
+        const proving_key_file_section &entry = table[id];
+        if (begin + count > entry.count) {
+            return false;
+        }
+        const std::uint64_t offset = entry.offset + begin * entry.element_size;
+        if constexpr (!std::is_integral<T>::value) {
+            if (compressed()) {
+                std::vector<unsigned char> bytes(count * entry.element_size);
+                return read_bytes(offset, bytes.data(), bytes.size()) &&
+                       decompress_points(bytes.data(), count, elements);
+            }
+        }
+        elements.resize(count);
+        return read_bytes(offset, elements.data(), count * sizeof(T));
+    }
+
+    proving_key_file_header header {};
+
+  private:
+    bool read_bytes(std::uint64_t offset, void *data, std::size_t size) const {
+        unsigned char *position = static_cast<unsigned char *>(data);
+        while (size > 0) {
+            const ssize_t read = ::pread(descriptor, position, size, offset);
+            if (read <= 0) {
+                return false;
+            }
+            position += read;
+            offset += read;
+            size -= read;
+        }
+        return true;
+    }
+
+    int descriptor = -1;
+    proving_key_file_table table {};
+};
+
+#endif    // CLI_PROVING_KEY_FILE_HPP
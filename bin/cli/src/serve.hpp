@@ -0,0 +1,350 @@
+#ifndef CLI_SERVE_HPP
+#define CLI_SERVE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include "prover.hpp"
+
+// Long-running prover: the proving key is deserialized and checked once and every request
+// only pays for the witness and the prover.
+//
+// Protocol is line based over a local stream socket, one request per line:
+//   prove <id> <income> <overdue-loans> <account-age> <pa-data-hash> <fi-data-hash>
+//     -> ok <latency-us> <proof-hex> <primary-input-hex>
+//   reload
+//     -> ok reloaded, once the key at the configured path is loaded and checked
+//   metrics
+//     -> the Prometheus exposition, then an empty line
+// Any failure is answered with "error <reason>". SIGHUP reloads the key as well. Clients of the
+// socket cannot point the service at another file, only the command line chooses the path.
+// With a metrics port the same exposition is served over HTTP on 127.0.0.1 for scraping.
+//
+// Every connection is read on its own thread, but at most concurrent_proofs proofs run at a time;
+// the other requests wait for a slot. The threads and a memory budget are divided between the
+// slots the same way --proof-batch divides them between its workers. On SIGINT/SIGTERM run() shuts
+// the connections down and waits for their threads and any reload before it returns.
+class prover_service {
+    using proving_key_type = groth16_proving_key;
+    using stream_protocol = boost::asio::local::stream_protocol;
+
+  public:
+    prover_service(boost::filesystem::path socket_path, boost::filesystem::path proving_key_path,
+                   unsigned short metrics_port = 0, std::size_t concurrent_proofs = 1) :
+        socket_path(socket_path), proving_key_path(proving_key_path), metrics_port(metrics_port),
+        concurrent_proofs(std::max<std::size_t>(concurrent_proofs, 1)),
+        proof_threads(std::max<std::size_t>(resolve_threads() / this->concurrent_proofs, 1)),
+        free_slots(this->concurrent_proofs), acceptor(io), metrics_acceptor(io), signals(io) {
+    }
+
+    bool reload_key() {
+        std::unique_lock<std::mutex> lock(reload_mutex);
+        auto started = std::chrono::steady_clock::now();
+        auto loaded = std::make_shared<proving_key_type>();
+        if (!load_groth16_proving_key(proving_key_path, *loaded, concurrent_proofs, proof_threads)) {
+            std::cout << "Keeping the previous proving key" << std::endl;
+            return false;
+        }
+
+        // Requests in flight keep their own reference to the old key
+        std::atomic_store(&proving_key, std::shared_ptr<const proving_key_type>(std::move(loaded)));
+        std::cout << "Proving key " << proving_key_path << " loaded in " << elapsed_ms(started) << " ms" << std::endl;
+        return true;
+    }
+
+    int run() {
+        if (!reload_key()) {
+            return 1;
+        }
+
+        boost::system::error_code ec;
+        boost::filesystem::remove(socket_path, ec);
+        stream_protocol::endpoint endpoint(socket_path.string());
+        acceptor.open(endpoint.protocol());
+        acceptor.bind(endpoint);
+        acceptor.listen();
+
+        if (metrics_port) {
+            boost::asio::ip::tcp::endpoint metrics_endpoint(boost::asio::ip::address_v4::loopback(), metrics_port);
+            metrics_acceptor.open(metrics_endpoint.protocol());
+            metrics_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+            metrics_acceptor.bind(metrics_endpoint, ec);
+            if (ec) {
+                std::cout << "Could not listen on metrics port " << metrics_port << ": " << ec.message() << std::endl;
+                return 1;
+            }
+            metrics_acceptor.listen();
+            accept_metrics();
+            std::cout << "Serving metrics on http://127.0.0.1:" << metrics_port << "/metrics" << std::endl;
+        }
+
+        signals.add(SIGHUP);
+        signals.add(SIGINT);
+        signals.add(SIGTERM);
+        wait_signal();
+        accept();
+
+        std::cout << "Serving proofs on " << socket_path << std::endl;
+        io.run();
+
+        // Blocked reads return once their sockets are shut down, proofs in flight are finished
+        std::unique_lock<std::mutex> lock(threads_mutex);
+        for (const std::shared_ptr<stream_protocol::socket> &socket : connections) {
+            socket->shutdown(stream_protocol::socket::shutdown_both, ec);
+        }
+        if (running_threads) {
+            std::cout << "Waiting for " << running_threads << " connections and reloads" << std::endl;
+        }
+        threads_finished.wait(lock, [this]() { return running_threads == 0; });
+
+        boost::filesystem::remove(socket_path, ec);
+        return 0;
+    }
+
+  private:
+    static long long elapsed_ms(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+            .count();
+    }
+
+    void accept() {
+        auto socket = std::make_shared<stream_protocol::socket>(io);
+        acceptor.async_accept(*socket, [this, socket](const boost::system::error_code &ec) {
+            if (ec) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> guard(threads_mutex);
+                connections.insert(socket);
+            }
+            spawn([this, socket]() {
+                serve_connection(socket);
+                std::lock_guard<std::mutex> guard(threads_mutex);
+                connections.erase(socket);
+            });
+            accept();
+        });
+    }
+
+    // Answers any request with the exposition. Scrapes are rare and cheap and are served on the io
+    // thread, asynchronously and within a deadline so a silent client cannot stall it.
+    void accept_metrics() {
+        auto socket = std::make_shared<boost::asio::ip::tcp::socket>(io);
+        metrics_acceptor.async_accept(*socket, [this, socket](const boost::system::error_code &ec) {
+            if (ec) {
+                return;
+            }
+            serve_metrics(socket);
+            accept_metrics();
+        });
+    }
+
+    void serve_metrics(std::shared_ptr<boost::asio::ip::tcp::socket> socket) {
+        auto deadline = std::make_shared<boost::asio::steady_timer>(io, std::chrono::seconds(5));
+        deadline->async_wait([socket](const boost::system::error_code &ec) {
+            if (!ec) {
+                boost::system::error_code ignored;
+                socket->close(ignored);
+            }
+        });
+
+        auto request = std::make_shared<boost::asio::streambuf>();
+        boost::asio::async_read_until(
+            *socket, *request, "\r\n\r\n",
+            [socket, request, deadline](const boost::system::error_code &ec, std::size_t) {
+                if (ec) {
+                    deadline->cancel();
+                    return;
+                }
+                const std::string body = metrics_registry::instance().to_prometheus();
+                auto response = std::make_shared<std::string>(
+                    "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\n\r\n" + body);
+                boost::asio::async_write(*socket, boost::asio::buffer(*response),
+                                         [socket, response, deadline](const boost::system::error_code &, std::size_t) {
+                                             deadline->cancel();
+                                             boost::system::error_code ignored;
+                                             socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+                                         });
+            });
+    }
+
+    void wait_signal() {
+        signals.async_wait([this](const boost::system::error_code &ec, int signal) {
+            if (ec) {
+                return;
+            }
+            if (signal == SIGHUP) {
+                reload_async();
+                wait_signal();
+            } else {
+                acceptor.close();
+                metrics_acceptor.close();
+                io.stop();
+            }
+        });
+    }
+
+    // The new key is loaded next to the old one, which keeps serving until the swap
+    void reload_async() {
+        spawn([this]() { reload_key(); });
+    }
+
+    // Runs work on a detached thread that run() waits for. The count is released only once the
+    // thread has exited, so the service is not destroyed under it.
+    template<typename Work>
+    void spawn(Work work) {
+        {
+            std::lock_guard<std::mutex> guard(threads_mutex);
+            ++running_threads;
+        }
+        std::thread([this, work]() {
+            work();
+            std::unique_lock<std::mutex> lock(threads_mutex);
+            --running_threads;
+            std::notify_all_at_thread_exit(threads_finished, std::move(lock));
+        }).detach();
+    }
+
+    void serve_connection(std::shared_ptr<stream_protocol::socket> socket) {
+        boost::asio::streambuf buffer;
+        boost::system::error_code ec;
+
+        for (;;) {
+            boost::asio::read_until(*socket, buffer, '\n', ec);
+            if (ec) {
+                break;
+            }
+
+            std::istream stream(&buffer);
+            std::string line;
+            std::getline(stream, line);
+
+            std::string response = handle_request(line) + "\n";
+            boost::asio::write(*socket, boost::asio::buffer(response), ec);
+            if (ec) {
+                break;
+            }
+        }
+    }
+
+    std::string handle_request(const std::string &line) {
+        std::istringstream request(line);
+        std::string command;
+        request >> command;
+
+        if (command == "metrics") {
+            return metrics_registry::instance().to_prometheus();
+        }
+
+        metrics_registry::instance().increment("requests_total");
+        if (command == "reload") {
+            std::string argument;
+            if (request >> argument) {
+                metrics_registry::instance().increment("request_errors_total");
+                return "error reload takes no arguments, the key path is set on the command line";
+            }
+            // The connection has its own thread, other requests keep being served meanwhile
+            if (!reload_key()) {
+                metrics_registry::instance().increment("request_errors_total");
+                return "error could not load " + proving_key_path.string() + ", keeping the previous key";
+            }
+            return "ok reloaded";
+        }
+
+        if (command != "prove") {
+            metrics_registry::instance().increment("request_errors_total");
+            return "error unknown command '" + command + "'";
+        }
+
+        applicant_record applicant;
+        if (!(request >> applicant.pa_id >> applicant.pa_income >> applicant.fi_overdue_loans >>
+              applicant.fi_account_age >> applicant.pa_data_hash >> applicant.fi_data_hash)) {
+            metrics_registry::instance().increment("request_errors_total");
+            return "error expected: prove <id> <income> <overdue-loans> <account-age> <pa-data-hash> "
+                   "<fi-data-hash>";
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        std::string reason;
+        if (!evaluate_applicant(applicant, reason)) {
+            return "error " + reason;
+        }
+        std::shared_ptr<const proving_key_type> key = std::atomic_load(&proving_key);
+
+        std::vector<unit_type> proof_byteblob, primary_input_byteblob;
+        try {
+            proof_slot slot(*this);
+            multiscore_witness<field_type> witness(compiled_circuit());
+            if (!generate_proof(witness, *key, applicant, proof_byteblob, primary_input_byteblob, false,
+                                proof_threads)) {
+                metrics_registry::instance().increment("request_errors_total");
+                return "error blueprint is not satisfied";
+            }
+        } catch (const std::exception &e) {
+            metrics_registry::instance().increment("request_errors_total");
+            return std::string("error ") + e.what();
+        }
+
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                            started).count();
+        std::cout << "Proof for id " << applicant.pa_id << " generated in " << latency << " us" << std::endl;
+
+        return "ok " + std::to_string(latency) + " " + byteblob_to_hex(proof_byteblob) + " " +
+               byteblob_to_hex(primary_input_byteblob);
+    }
+
+    // Holds one of the concurrent_proofs slots for its lifetime
+    class proof_slot {
+      public:
+        explicit proof_slot(prover_service &service) : service(service) {
+            std::unique_lock<std::mutex> lock(service.slots_mutex);
+            service.slot_freed.wait(lock, [this]() { return this->service.free_slots > 0; });
+            --service.free_slots;
+        }
+
+        ~proof_slot() {
+            {
+                std::lock_guard<std::mutex> guard(service.slots_mutex);
+                ++service.free_slots;
+            }
+            service.slot_freed.notify_one();
+        }
+
+      private:
+        prover_service &service;
+    };
+
+    const boost::filesystem::path socket_path;
+    const boost::filesystem::path proving_key_path;
+    unsigned short metrics_port;
+
+    const std::size_t concurrent_proofs;
+    const std::size_t proof_threads;
+    std::size_t free_slots;
+    std::mutex slots_mutex;
+    std::condition_variable slot_freed;
+
+    std::shared_ptr<const proving_key_type> proving_key;
+    std::mutex reload_mutex;
+
+    std::size_t running_threads = 0;
+    std::set<std::shared_ptr<stream_protocol::socket>> connections;
+    std::mutex threads_mutex;
+    std::condition_variable threads_finished;
+
+    boost::asio::io_context io;
+    stream_protocol::acceptor acceptor;
+    boost::asio::ip::tcp::acceptor metrics_acceptor;
+    boost::asio::signal_set signals;
+};
+
+#endif    // CLI_SERVE_HPP
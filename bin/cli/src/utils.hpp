@@ -1,8 +1,23 @@
+#ifndef CLI_UTILS_HPP
+#define CLI_UTILS_HPP
+
+#include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <stdexcept>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include <nil/crypto3/zk/snark/schemes/ppzksnark/r1cs_gg_ppzksnark.hpp>
 #include <nil/crypto3/zk/snark/schemes/ppzksnark/r1cs_gg_ppzksnark/marshalling.hpp>
 
+#include <nil/marshalling/status_type.hpp>
+#include <nil/crypto3/marshalling/types/zk/r1cs_gg_ppzksnark/primary_input.hpp>
+#include <nil/crypto3/marshalling/types/zk/r1cs_gg_ppzksnark/proof.hpp>
+#include <nil/crypto3/marshalling/types/zk/r1cs_gg_ppzksnark/verification_key.hpp>
+
 
 typedef algebra::curves::bls12<381> curve_type;
 typedef curve_type::scalar_field_type field_type;
@@ -11,6 +26,9 @@ typedef zk::snark::r1cs_gg_ppzksnark<curve_type> scheme_type;
 typedef nil::marshalling::verifier_input_serializer_tvm<scheme_type> serializer_tvm;
 typedef nil::marshalling::verifier_input_deserializer_tvm<scheme_type> deserializer_tvm;
 
+using Endianness = nil::marshalling::option::big_endian;
+using unit_type = unsigned char;
+
 constexpr const std::size_t modulus_bits = field_type::modulus_bits;
 constexpr const std::size_t modulus_chunks = modulus_bits / 8 + (modulus_bits % 8 ? 1 : 0);
 
@@ -45,7 +63,18 @@ std::string field_element_to_hex(value_type element) {
     return hex;
 }
 
+// A data hash as the command line and the socket take it: one field element in hex
+bool is_field_element_hex(const std::string &hex) {
+    return hex.size() == 2 * modulus_chunks &&
+           std::all_of(hex.begin(), hex.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); });
+}
+
+// Anything but is_field_element_hex would not fit the buffer and is rejected
 value_type hex_to_field_element(const std::string& hex) {
+    if (!is_field_element_hex(hex)) {
+        throw std::invalid_argument("expected " + std::to_string(2 * modulus_chunks) + " hex digits, got '" + hex +
+                                    "'");
+    }
     std::vector<uint8_t> hash_bytes(modulus_chunks);
     boost::algorithm::unhex(hex.begin(), hex.end(), hash_bytes.begin());
 
@@ -55,3 +84,142 @@ value_type hex_to_field_element(const std::string& hex) {
 
     return result;
 }
+
+
+std::vector<std::uint8_t> readfile(boost::filesystem::path path) {
+    boost::filesystem::ifstream stream(path, std::ios::in | std::ios::binary);
+    auto eos = std::istreambuf_iterator<char>();
+    auto buffer = std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), eos);
+    return buffer;
+}
+
+bool writefile(boost::filesystem::path path, const std::vector<unit_type> &byteblob) {
+    boost::filesystem::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char *>(byteblob.data()), byteblob.size());
+    return stream.good();
+}
+
+std::string byteblob_to_hex(const std::vector<unit_type> &byteblob) {
+    std::string hex;
+    boost::algorithm::hex(byteblob.begin(), byteblob.end(), std::back_inserter(hex));
+    return hex;
+}
+
+
+// Byteblobs in the layout the VerifyGroth16 contract concatenates before tvm.vergrth16
+std::vector<unit_type> proof_to_byteblob(const scheme_type::proof_type &proof) {
+    using proof_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_proof<
+        nil::marshalling::field_type<
+            Endianness>,
+        typename scheme_type::proof_type>;
+
+    proof_marshalling_type filled_proof_val =
+        nil::crypto3::marshalling::types::fill_r1cs_gg_ppzksnark_proof<
+            typename scheme_type::proof_type,
+            Endianness>(proof);
+
+    std::vector<unit_type> proof_byteblob;
+    proof_byteblob.resize(filled_proof_val.length(), 0x00);
+    auto proof_write_iter = proof_byteblob.begin();
+
+    filled_proof_val.write(proof_write_iter, proof_byteblob.size());
+    return proof_byteblob;
+}
+
+std::vector<unit_type> primary_input_to_byteblob(const scheme_type::primary_input_type &primary_input) {
+    using primary_input_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_primary_input<
+        nil::marshalling::field_type<
+            Endianness>,
+        typename scheme_type::primary_input_type>;
+
+    primary_input_marshalling_type filled_primary_input_val =
+        nil::crypto3::marshalling::types::fill_r1cs_gg_ppzksnark_primary_input<
+            typename scheme_type::primary_input_type,
+            Endianness>(primary_input);
+
+    std::vector<unit_type> primary_input_byteblob;
+    primary_input_byteblob.resize(filled_primary_input_val.length(), 0x00);
+    auto primary_input_write_iter = primary_input_byteblob.begin();
+
+    filled_primary_input_val.write(primary_input_write_iter, primary_input_byteblob.size());
+    return primary_input_byteblob;
+}
+
+std::vector<unit_type> verification_key_to_byteblob(const scheme_type::verification_key_type &verification_key) {
+    using verification_key_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_verification_key<
+        nil::marshalling::field_type<
+            Endianness>,
+        typename scheme_type::verification_key_type>;
+
+    verification_key_marshalling_type filled_verification_key_val =
+        nil::crypto3::marshalling::types::fill_r1cs_gg_ppzksnark_verification_key<
+            typename scheme_type::verification_key_type,
+            Endianness>(verification_key);
+
+    std::vector<unit_type> verification_key_byteblob;
+    verification_key_byteblob.resize(filled_verification_key_val.length(), 0x00);
+    auto verification_key_write_iter = verification_key_byteblob.begin();
+
+    filled_verification_key_val.write(verification_key_write_iter, verification_key_byteblob.size());
+    return verification_key_byteblob;
+}
+
+// Inverse of the functions above; false if the byteblob does not parse
+bool byteblob_to_proof(const std::vector<unit_type> &byteblob, scheme_type::proof_type &proof) {
+    using proof_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_proof<
+        nil::marshalling::field_type<
+            Endianness>,
+        typename scheme_type::proof_type>;
+
+    proof_marshalling_type filled_proof_val;
+    auto proof_read_iter = byteblob.begin();
+    if (filled_proof_val.read(proof_read_iter, byteblob.size()) != nil::marshalling::status_type::success) {
+        return false;
+    }
+
+    proof = nil::crypto3::marshalling::types::make_r1cs_gg_ppzksnark_proof<
+        typename scheme_type::proof_type,
+        Endianness>(filled_proof_val);
+    return true;
+}
+
+bool byteblob_to_primary_input(const std::vector<unit_type> &byteblob, scheme_type::primary_input_type &primary_input) {
+    using primary_input_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_primary_input<
+        nil::marshalling::field_type<
+            Endianness>,
+        typename scheme_type::primary_input_type>;
+
+    primary_input_marshalling_type filled_primary_input_val;
+    auto primary_input_read_iter = byteblob.begin();
+    if (filled_primary_input_val.read(primary_input_read_iter, byteblob.size()) !=
+        nil::marshalling::status_type::success) {
+        return false;
+    }
+
+    primary_input = nil::crypto3::marshalling::types::make_r1cs_gg_ppzksnark_primary_input<
+        typename scheme_type::primary_input_type,
+        Endianness>(filled_primary_input_val);
+    return true;
+}
+
+bool byteblob_to_verification_key(const std::vector<unit_type> &byteblob,
+                                  scheme_type::verification_key_type &verification_key) {
+    using verification_key_marshalling_type = nil::crypto3::marshalling::types::r1cs_gg_ppzksnark_verification_key<
+        nil::marshalling::field_type<
+            Endianness>,
+        typename scheme_type::verification_key_type>;
+
+    verification_key_marshalling_type filled_verification_key_val;
+    auto verification_key_read_iter = byteblob.begin();
+    if (filled_verification_key_val.read(verification_key_read_iter, byteblob.size()) !=
+        nil::marshalling::status_type::success) {
+        return false;
+    }
+
+    verification_key = nil::crypto3::marshalling::types::make_r1cs_gg_ppzksnark_verification_key<
+        typename scheme_type::verification_key_type,
+        Endianness>(filled_verification_key_val);
+    return true;
+}
+
+#endif    // CLI_UTILS_HPP
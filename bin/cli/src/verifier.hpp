@@ -0,0 +1,450 @@
+#ifndef CLI_VERIFIER_HPP
+#define CLI_VERIFIER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include <boost/crc.hpp>
+
+#include "utils.hpp"
+#include "detail/metrics.hpp"
+#include "detail/parallel.hpp"
+#include "detail/point_encoding.hpp"
+
+typedef typename curve_type::pairing pairing_policy;
+typedef typename curve_type::gt_type::value_type gt_value_type;
+typedef typename pairing_policy::g2_precomp g2_precomp_type;
+typedef typename decltype(g2_precomp_type::coeffs)::value_type ell_coeffs_type;
+
+// One (proof, primary input) pair of a batch, with the primary input already folded into
+// gamma_ABC_g1
+struct verification_item {
+    std::string name;
+    typename scheme_type::proof_type proof;
+    typename scheme_type::primary_input_type primary_input;
+    g1_value_type accumulated_input;
+    bool loaded = false;
+    bool valid = false;
+    std::string reason;
+};
+
+// Verification key with everything that does not depend on the proof computed up front: the line
+// coefficients of the Miller loops over gamma and delta, and e(alpha, beta), which the verification
+// key already carries.
+struct prepared_verification_key {
+    typename scheme_type::verification_key_type verification_key;
+    gt_value_type alpha_g1_beta_g2;
+    g2_precomp_type gamma_g2_precomp;
+    g2_precomp_type delta_g2_precomp;
+};
+
+prepared_verification_key prepare_verification_key(const typename scheme_type::verification_key_type &verification_key) {
+    prepared_verification_key prepared;
+    prepared.verification_key = verification_key;
+    prepared.alpha_g1_beta_g2 = verification_key.alpha_g1_beta_g2;
+    prepared.gamma_g2_precomp = pairing_policy::precompute_g2(verification_key.gamma_g2);
+    prepared.delta_g2_precomp = pairing_policy::precompute_g2(verification_key.delta_g2);
+    return prepared;
+}
+
+// The prepared key is cached next to the verification key as <v_key>.prepared:
+//
+//   header | e(alpha, beta) | gamma QX, QY, coefficients | delta QX, QY, coefficients
+//
+// Elements are stored in their in-memory layout like in the mapped proving key, so the cache is
+// tied to the build; it also records the size and CRC-32 of the verification key it was prepared
+// from and is rebuilt whenever either differs.
+
+static_assert(std::is_standard_layout<gt_value_type>::value, "GT elements have to be plain limb arrays");
+static_assert(std::is_standard_layout<ell_coeffs_type>::value, "line coefficients have to be plain limb arrays");
+
+constexpr const std::array<char, 8> prepared_verification_key_magic = {'M', 'S', 'C', 'O', 'R', 'E', 'V', 'K'};
+constexpr const std::uint32_t prepared_verification_key_version = 1;
+
+struct prepared_verification_key_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t gt_size;
+    std::uint32_t fp2_size;
+    std::uint32_t ell_coeffs_size;
+    std::uint64_t gamma_coeffs;
+    std::uint64_t delta_coeffs;
+    std::uint64_t verification_key_size;
+    std::uint32_t verification_key_checksum;
+    // CRC-32 of every byte after the header
+    std::uint32_t checksum;
+};
+
+boost::filesystem::path prepared_verification_key_path(boost::filesystem::path verification_key_path) {
+    return verification_key_path.string() + ".prepared";
+}
+
+std::uint32_t byteblob_checksum(const std::vector<unit_type> &byteblob) {
+    boost::crc_32_type crc;
+    crc.process_bytes(byteblob.data(), byteblob.size());
+    return crc.checksum();
+}
+
+template<typename T>
+void append_raw(std::vector<unit_type> &byteblob, const T *data, std::size_t count) {
+    const unit_type *bytes = reinterpret_cast<const unit_type *>(data);
+    byteblob.insert(byteblob.end(), bytes, bytes + sizeof(T) * count);
+}
+
+template<typename T>
+bool read_raw(const std::vector<unit_type> &byteblob, std::size_t &position, T *data, std::size_t count) {
+    if (byteblob.size() - position < sizeof(T) * count) {
+        return false;
+    }
+    std::memcpy(static_cast<void *>(data), byteblob.data() + position, sizeof(T) * count);
+    position += sizeof(T) * count;
+    return true;
+}
+
+bool write_prepared_verification_key(boost::filesystem::path path,
+                                     const prepared_verification_key &prepared,
+                                     const std::vector<unit_type> &verification_key_byteblob) {
+    std::vector<unit_type> payload;
+    append_raw(payload, &prepared.alpha_g1_beta_g2, 1);
+    for (const g2_precomp_type *precomp : {&prepared.gamma_g2_precomp, &prepared.delta_g2_precomp}) {
+        append_raw(payload, &precomp->QX, 1);
+        append_raw(payload, &precomp->QY, 1);
+        append_raw(payload, precomp->coeffs.data(), precomp->coeffs.size());
+    }
+
+    prepared_verification_key_header header {};
+    header.magic = prepared_verification_key_magic;
+    header.version = prepared_verification_key_version;
+    header.gt_size = sizeof(gt_value_type);
+    header.fp2_size = sizeof(fp2_value_type);
+    header.ell_coeffs_size = sizeof(ell_coeffs_type);
+    header.gamma_coeffs = prepared.gamma_g2_precomp.coeffs.size();
+    header.delta_coeffs = prepared.delta_g2_precomp.coeffs.size();
+    header.verification_key_size = verification_key_byteblob.size();
+    header.verification_key_checksum = byteblob_checksum(verification_key_byteblob);
+    header.checksum = byteblob_checksum(payload);
+
+    std::vector<unit_type> byteblob;
+    append_raw(byteblob, &header, 1);
+    byteblob.insert(byteblob.end(), payload.begin(), payload.end());
+    return writefile(path, byteblob);
+}
+
+// False if the cache is missing, damaged, from another build or for another verification key
+bool read_prepared_verification_key(boost::filesystem::path path,
+                                    const std::vector<unit_type> &verification_key_byteblob,
+                                    prepared_verification_key &prepared) {
+    if (!boost::filesystem::exists(path)) {
+        return false;
+    }
+    std::vector<unit_type> byteblob = readfile(path);
+
+    prepared_verification_key_header header;
+    std::size_t position = 0;
+    if (!read_raw(byteblob, position, &header, 1) || header.magic != prepared_verification_key_magic ||
+        header.version != prepared_verification_key_version || header.gt_size != sizeof(gt_value_type) ||
+        header.fp2_size != sizeof(fp2_value_type) || header.ell_coeffs_size != sizeof(ell_coeffs_type) ||
+        header.verification_key_size != verification_key_byteblob.size() ||
+        header.verification_key_checksum != byteblob_checksum(verification_key_byteblob)) {
+        return false;
+    }
+
+    boost::crc_32_type crc;
+    crc.process_bytes(byteblob.data() + position, byteblob.size() - position);
+    if (crc.checksum() != header.checksum) {
+        return false;
+    }
+
+    if ((header.gamma_coeffs + header.delta_coeffs) * sizeof(ell_coeffs_type) > byteblob.size()) {
+        return false;
+    }
+    prepared.gamma_g2_precomp.coeffs.resize(header.gamma_coeffs);
+    prepared.delta_g2_precomp.coeffs.resize(header.delta_coeffs);
+    if (!read_raw(byteblob, position, &prepared.alpha_g1_beta_g2, 1)) {
+        return false;
+    }
+    for (g2_precomp_type *precomp : {&prepared.gamma_g2_precomp, &prepared.delta_g2_precomp}) {
+        if (!read_raw(byteblob, position, &precomp->QX, 1) || !read_raw(byteblob, position, &precomp->QY, 1) ||
+            !read_raw(byteblob, position, precomp->coeffs.data(), precomp->coeffs.size())) {
+            return false;
+        }
+    }
+    return position == byteblob.size();
+}
+
+// Loads the verification key and its prepared form, from the cache when it is up to date and
+// otherwise by preparing it and refreshing the cache
+bool load_prepared_verification_key(boost::filesystem::path verification_key_path,
+                                    prepared_verification_key &prepared) {
+    scoped_timer timer("load_verification_key");
+    if (!boost::filesystem::exists(verification_key_path)) {
+        std::cout << "Verification key " << verification_key_path << " not found, run --setup first" << std::endl;
+        return false;
+    }
+    std::vector<unit_type> verification_key_byteblob = readfile(verification_key_path);
+
+    typename scheme_type::verification_key_type verification_key;
+    if (!byteblob_to_verification_key(verification_key_byteblob, verification_key)) {
+        std::cout << "Verification key " << verification_key_path << " is malformed" << std::endl;
+        return false;
+    }
+
+    boost::filesystem::path cache_path = prepared_verification_key_path(verification_key_path);
+    if (read_prepared_verification_key(cache_path, verification_key_byteblob, prepared)) {
+        prepared.verification_key = verification_key;
+        return true;
+    }
+
+    prepared = prepare_verification_key(verification_key);
+    if (!write_prepared_verification_key(cache_path, prepared, verification_key_byteblob)) {
+        std::cout << "Could not write " << cache_path << ", continuing without the cache" << std::endl;
+    }
+    return true;
+}
+
+g1_value_type accumulate_primary_input(const typename scheme_type::verification_key_type &verification_key,
+                                       const typename scheme_type::primary_input_type &primary_input) {
+    return verification_key.gamma_ABC_g1
+        .template accumulate_chunk<field_type>(primary_input.begin(), primary_input.end(), 0)
+        .first;
+}
+
+// Single proof check with the gamma and delta Miller loops driven by the prepared coefficients:
+//   e(A, B) * e(acc, gamma)^-1 * e(C, delta)^-1 = e(alpha, beta)
+bool verify_proof(const prepared_verification_key &prepared,
+                  const typename scheme_type::primary_input_type &primary_input,
+                  const typename scheme_type::proof_type &proof) {
+    scoped_timer timer("verify");
+    if (primary_input.size() != prepared.verification_key.gamma_ABC_g1.domain_size()) {
+        return false;
+    }
+    const g1_value_type accumulated_input = accumulate_primary_input(prepared.verification_key, primary_input);
+
+    const gt_value_type proof_miller_loop = pairing_policy::miller_loop(pairing_policy::precompute_g1(proof.g_A),
+                                                                        pairing_policy::precompute_g2(proof.g_B));
+    const gt_value_type key_miller_loops =
+        pairing_policy::double_miller_loop(pairing_policy::precompute_g1(accumulated_input), prepared.gamma_g2_precomp,
+                                           pairing_policy::precompute_g1(proof.g_C), prepared.delta_g2_precomp);
+
+    return pairing_policy::final_exponentiation(proof_miller_loop * key_miller_loops.unitary_inversed()) ==
+           prepared.alpha_g1_beta_g2;
+}
+
+// Checks the proof and primary input files written by --proof
+bool verify_proof_files(boost::filesystem::path proof_path,
+                        boost::filesystem::path primary_input_path,
+                        boost::filesystem::path verification_key_path) {
+    std::cout << std::endl;
+    std::cout << "Verification..." << std::endl;
+    std::cout << std::endl;
+
+    auto started = std::chrono::steady_clock::now();
+    prepared_verification_key prepared;
+    if (!load_prepared_verification_key(verification_key_path, prepared)) {
+        return false;
+    }
+    auto loaded = std::chrono::steady_clock::now();
+
+    typename scheme_type::proof_type proof;
+    typename scheme_type::primary_input_type primary_input;
+    if (!boost::filesystem::exists(proof_path) || !byteblob_to_proof(readfile(proof_path), proof)) {
+        std::cout << "Proof " << proof_path << " is missing or malformed" << std::endl;
+        return false;
+    }
+    if (!boost::filesystem::exists(primary_input_path) ||
+        !byteblob_to_primary_input(readfile(primary_input_path), primary_input)) {
+        std::cout << "Primary input " << primary_input_path << " is missing or malformed" << std::endl;
+        return false;
+    }
+
+    const bool verified = verify_proof(prepared, primary_input, proof);
+    auto finished = std::chrono::steady_clock::now();
+
+    std::cout << "Verification key loaded in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(loaded - started).count() << " us"
+              << std::endl;
+    std::cout << "Proof checked in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(finished - loaded).count() << " us"
+              << std::endl;
+    std::cout << "Proof is verified: " << verified << std::endl;
+    return verified;
+}
+
+// Every <name>.proof of the directory paired with <name>.pi, as written by --proof-batch
+std::vector<verification_item> read_verification_items(boost::filesystem::path directory,
+                                                       const typename scheme_type::verification_key_type &verification_key) {
+    std::vector<boost::filesystem::path> proof_paths;
+    for (const boost::filesystem::directory_entry &entry : boost::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".proof") {
+            proof_paths.push_back(entry.path());
+        }
+    }
+    std::sort(proof_paths.begin(), proof_paths.end());
+
+    std::vector<verification_item> items(proof_paths.size());
+    parallel_for(items.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; ++i) {
+            verification_item &item = items[i];
+            item.name = proof_paths[i].stem().string();
+
+            boost::filesystem::path primary_input_path = proof_paths[i];
+            primary_input_path.replace_extension(".pi");
+            if (!boost::filesystem::exists(primary_input_path)) {
+                item.reason = "primary input not found";
+            } else if (!byteblob_to_proof(readfile(proof_paths[i]), item.proof)) {
+                item.reason = "malformed proof";
+            } else if (!byteblob_to_primary_input(readfile(primary_input_path), item.primary_input)) {
+                item.reason = "malformed primary input";
+            } else if (item.primary_input.size() != verification_key.gamma_ABC_g1.domain_size()) {
+                item.reason = "primary input size does not match the verification key";
+            } else {
+                item.accumulated_input = accumulate_primary_input(verification_key, item.primary_input);
+                item.loaded = true;
+            }
+        }
+    });
+    return items;
+}
+
+// Checks items[begin, end) at once. With random nonzero 64-bit rho_i every Groth16 equation
+//   e(A_i, B_i) = e(alpha, beta) * e(acc_i, gamma) * e(C_i, delta)
+// is raised to rho_i and all of them are multiplied together:
+//   prod e(rho_i * A_i, B_i) * e(-sum rho_i * acc_i, gamma) * e(-sum rho_i * C_i, delta) = e(alpha, beta)^sum rho_i
+// That is one Miller loop per proof plus two shared ones and a single final exponentiation. An
+// invalid proof passes with probability about 2^-63.
+bool verify_batch_range(const prepared_verification_key &prepared,
+                        const std::vector<verification_item *> &items,
+                        std::size_t begin,
+                        std::size_t end) {
+    scoped_timer timer("verify_batch");
+    const std::size_t count = end - begin;
+
+    std::vector<std::uint64_t> rho(count);
+    std::mt19937_64 rho_generator(std::random_device {}());
+    for (std::uint64_t &r : rho) {
+        r = rho_generator() | 1;
+    }
+
+    struct partial_product {
+        gt_value_type miller_loops = gt_value_type::one();
+        g1_value_type accumulated_input = g1_value_type::zero();
+        g1_value_type C = g1_value_type::zero();
+    };
+    std::vector<partial_product> partials(resolve_threads());
+
+    parallel_for(count, [&](std::size_t chunk_begin, std::size_t chunk_end, std::size_t chunk) {
+        partial_product partial;
+        for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+            const verification_item &item = *items[begin + i];
+            partial.miller_loops =
+                partial.miller_loops *
+                pairing_policy::miller_loop(pairing_policy::precompute_g1(mul_by_integral(item.proof.g_A, rho[i])),
+                                            pairing_policy::precompute_g2(item.proof.g_B));
+            partial.accumulated_input = partial.accumulated_input + mul_by_integral(item.accumulated_input, rho[i]);
+            partial.C = partial.C + mul_by_integral(item.proof.g_C, rho[i]);
+        }
+        partials[chunk] = partial;
+    });
+
+    partial_product total;
+    for (const partial_product &partial : partials) {
+        total.miller_loops = total.miller_loops * partial.miller_loops;
+        total.accumulated_input = total.accumulated_input + partial.accumulated_input;
+        total.C = total.C + partial.C;
+    }
+
+    value_type rho_sum = value_type::zero();
+    for (std::uint64_t r : rho) {
+        rho_sum = rho_sum + value_type(r);
+    }
+
+    const gt_value_type shared_miller_loops =
+        pairing_policy::double_miller_loop(pairing_policy::precompute_g1(-total.accumulated_input),
+                                           prepared.gamma_g2_precomp, pairing_policy::precompute_g1(-total.C),
+                                           prepared.delta_g2_precomp);
+
+    return pairing_policy::final_exponentiation(total.miller_loops * shared_miller_loops) ==
+           prepared.alpha_g1_beta_g2.pow(typename field_type::integral_type(rho_sum.data));
+}
+
+// Bisects a failing range down to the proofs that do not verify. known_invalid skips the check of
+// a range whose sibling passed, since the parent failing already says it holds a bad proof.
+void find_invalid_proofs(const prepared_verification_key &prepared,
+                         const std::vector<verification_item *> &items,
+                         std::size_t begin,
+                         std::size_t end,
+                         bool known_invalid = false) {
+    if (begin == end) {
+        return;
+    }
+    if (!known_invalid && verify_batch_range(prepared, items, begin, end)) {
+        for (std::size_t i = begin; i < end; ++i) {
+            items[i]->valid = true;
+        }
+        return;
+    }
+    if (end - begin == 1) {
+        items[begin]->valid = false;
+        items[begin]->reason = "proof does not verify";
+        return;
+    }
+
+    const std::size_t middle = begin + (end - begin) / 2;
+    find_invalid_proofs(prepared, items, begin, middle);
+    const bool left_valid = std::all_of(items.begin() + begin, items.begin() + middle,
+                                        [](const verification_item *item) { return item->valid; });
+    find_invalid_proofs(prepared, items, middle, end, left_valid);
+}
+
+// Verifies every proof of the directory against the verification key and reports the ones that fail.
+// A proof whose primary input accepts_input rejects fails without being checked.
+bool verify_batch(boost::filesystem::path directory, boost::filesystem::path verification_key_path,
+                  const std::function<bool(const typename scheme_type::primary_input_type &)> &accepts_input = {}) {
+    std::cout << std::endl;
+    std::cout << "Batch verification..." << std::endl;
+    std::cout << std::endl;
+
+    if (!boost::filesystem::is_directory(directory)) {
+        std::cout << "Proof directory " << directory << " not found" << std::endl;
+        return false;
+    }
+
+    prepared_verification_key prepared;
+    if (!load_prepared_verification_key(verification_key_path, prepared)) {
+        return false;
+    }
+
+    std::vector<verification_item> items = read_verification_items(directory, prepared.verification_key);
+    std::vector<verification_item *> loaded;
+    for (verification_item &item : items) {
+        if (item.loaded && accepts_input && !accepts_input(item.primary_input)) {
+            item.loaded = false;
+            item.reason = "primary input does not follow the policy";
+        }
+        if (item.loaded) {
+            loaded.push_back(&item);
+        }
+    }
+    std::cout << "Verifying " << loaded.size() << " of " << items.size() << " proofs" << std::endl;
+
+    auto started = std::chrono::steady_clock::now();
+    find_invalid_proofs(prepared, loaded, 0, loaded.size());
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::size_t valid = 0;
+    for (const verification_item &item : items) {
+        valid += item.valid;
+        if (!item.valid) {
+            std::cout << item.name << ": " << item.reason << std::endl;
+        }
+    }
+
+    std::cout << "Verified " << valid << " of " << items.size() << " proofs in " << elapsed << " s ("
+              << (loaded.empty() ? 0 : elapsed * 1000000 / loaded.size()) << " us per proof)" << std::endl;
+    return valid == items.size();
+}
+
+#endif    // CLI_VERIFIER_HPP
@@ -1,6 +1,25 @@
 #define BOOST_TEST_MODULE circuit_test
 #include <boost/test/included/unit_test.hpp>
 
+#include <nil/crypto3/zk/snark/algorithms/generate.hpp>
+#include <nil/crypto3/zk/snark/algorithms/verify.hpp>
+
+#include "detail/groth16_setup.hpp"
+#include "detail/multiscore_circuit.hpp"
+#include "detail/scoring_circuit.hpp"
+#include "aggregation.hpp"
+#include "batch.hpp"
+#include "commit.hpp"
+#include "payload.hpp"
+#include "proof_archive.hpp"
+#include "prover.hpp"
+#include "verifier.hpp"
+
+std::string knapsack_hash_hex(uint left, uint right) {
+    return field_element_to_hex(knapsack_crh_with_field_out_component<field_type>::get_hash(
+        merge_vectors(uint_to_bitvector(left), uint_to_bitvector(right)))[0]);
+}
+
 BOOST_AUTO_TEST_SUITE(circuit_test_suite)
 
 BOOST_AUTO_TEST_CASE(circuit_test) {
@@ -9,4 +28,748 @@ BOOST_AUTO_TEST_CASE(circuit_test) {
     BOOST_CHECK(1 == 0);
 }
 
+BOOST_AUTO_TEST_CASE(multiscore_native_witness_matches_blueprint) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+    const std::string pa_data_hash = knapsack_hash_hex(pa_id, pa_income);
+    const std::string fi_data_hash = knapsack_hash_hex(fi_overdue_loans, fi_account_age);
+
+    blueprint<field_type> bp;
+    multiscore<field_type> component(bp);
+    component.verbose = false;
+    component.generate_r1cs_constraints();
+    component.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(bp.is_satisfied());
+
+    multiscore_circuit<field_type> circuit;
+    BOOST_CHECK_EQUAL(circuit.constraint_system.num_constraints(),
+                      bp.num_constraints() - circuit.reduction.eliminated_constraints + circuit.padding_constraints);
+
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(witness.is_satisfied());
+    BOOST_CHECK(witness.primary_input() == bp.primary_input());
+    BOOST_CHECK(witness.assignment == bp.full_variable_assignment());
+
+    // The buffer is reused: a rejected applicant must not leave stale values behind
+    witness.generate_r1cs_witness(pa_id, 0, 9, 0, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(!witness.is_satisfied());
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(witness.assignment == bp.full_variable_assignment());
+}
+
+BOOST_AUTO_TEST_CASE(scoring_policy_is_public_input) {
+    const uint pa_id = 123, pa_income = 0, fi_overdue_loans = 9, fi_account_age = 0;
+    const std::string pa_data_hash = knapsack_hash_hex(pa_id, pa_income);
+    const std::string fi_data_hash = knapsack_hash_hex(fi_overdue_loans, fi_account_age);
+
+    scoring_policy lenient;
+    lenient.score_base = 1000000;
+    lenient.w_overdue_loans = 100;
+    std::string error;
+    BOOST_CHECK(lenient.validate(error));
+
+    blueprint<field_type> bp;
+    multiscore<field_type> component(bp);
+    component.verbose = false;
+    component.generate_r1cs_constraints();
+    component.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash,
+                                    lenient);
+    BOOST_CHECK(bp.is_satisfied());
+
+    // The same compiled circuit rejects the applicant under the default policy and accepts it under
+    // the lenient one, whose values end up in the primary input
+    const multiscore_circuit<field_type> circuit;
+    BOOST_CHECK_EQUAL(circuit.layout.num_inputs, 10);
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(!witness.is_satisfied());
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash,
+                                  lenient);
+    BOOST_CHECK(witness.is_satisfied());
+    BOOST_CHECK(witness.score == 1000000 - 81 * 100);
+    BOOST_CHECK(witness.assignment == bp.full_variable_assignment());
+    BOOST_CHECK(primary_input_has_policy(circuit.layout, witness.primary_input(), lenient));
+    BOOST_CHECK(!primary_input_has_policy(circuit.layout, witness.primary_input(), scoring_policy()));
+
+    scoring_policy heavy;
+    heavy.w_account_age = scoring_policy::max_weight + 1;
+    BOOST_CHECK(!heavy.validate(error));
+}
+
+BOOST_AUTO_TEST_CASE(policy_check_rejects_ineligible_proofs) {
+    const uint pa_id = 123, pa_income = 0, fi_overdue_loans = 9, fi_account_age = 0;
+    const std::string pa_data_hash = knapsack_hash_hex(pa_id, pa_income);
+    const std::string fi_data_hash = knapsack_hash_hex(fi_overdue_loans, fi_account_age);
+
+    // The circuit only ties out to the comparison, so a rejected applicant with out = 0 has a
+    // valid proof; only the check of the primary input tells it apart
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(!witness.is_satisfied());
+    witness.assignment[circuit.layout.out - 1] = value_type::zero();
+    BOOST_REQUIRE(witness.is_satisfied());
+
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+    const scheme_type::proof_type proof =
+        groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input());
+    BOOST_CHECK(verify<scheme_type>(keypair.second, witness.primary_input(), proof));
+    BOOST_CHECK(!primary_input_has_policy(circuit.layout, witness.primary_input(), scoring_policy()));
+
+    // The published hashes are compared when given, and a failed hash validation is rejected
+    scoring_policy lenient;
+    lenient.score_base = 1000000;
+    lenient.w_overdue_loans = 100;
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash,
+                                  lenient);
+    r1cs_primary_input<field_type> primary_input = witness.primary_input();
+    BOOST_CHECK(primary_input_has_policy(circuit.layout, primary_input, lenient));
+    BOOST_CHECK(primary_input_has_policy(circuit.layout, primary_input, lenient, hex_to_field_element(pa_data_hash),
+                                         hex_to_field_element(fi_data_hash)));
+    BOOST_CHECK(!primary_input_has_policy(circuit.layout, primary_input, lenient, hex_to_field_element(fi_data_hash),
+                                          hex_to_field_element(pa_data_hash)));
+    primary_input[circuit.layout.HASH_PA_validation_result - 1] = value_type::one();
+    BOOST_CHECK(!primary_input_has_policy(circuit.layout, primary_input, lenient));
+}
+
+BOOST_AUTO_TEST_CASE(compact_multiscore_keeps_commitments) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+    const std::string pa_data_hash = knapsack_hash_hex(pa_id, pa_income);
+    const std::string fi_data_hash = knapsack_hash_hex(fi_overdue_loans, fi_account_age);
+
+    blueprint<field_type> bp;
+    multiscore<field_type> component(bp, multiscore_widths::compact());
+    component.verbose = false;
+    component.generate_r1cs_constraints();
+    component.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(bp.is_satisfied());
+
+    multiscore_circuit<field_type> wide;
+    multiscore_circuit<field_type> compact(multiscore_widths::compact());
+    BOOST_CHECK_LT(compact.layout.num_variables, wide.layout.num_variables);
+    BOOST_CHECK_EQUAL(compact.layout.num_inputs, wide.layout.num_inputs);
+
+    multiscore_witness<field_type> witness(compact);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(witness.is_satisfied());
+    BOOST_CHECK(witness.primary_input() == bp.primary_input());
+    BOOST_CHECK(witness.assignment == bp.full_variable_assignment());
+
+    // An attribute wider than its declared width fails the range check
+    multiscore_widths narrow = multiscore_widths::compact();
+    narrow.account_age = 4;
+    multiscore_circuit<field_type> narrow_circuit(narrow);
+    multiscore_witness<field_type> narrow_witness(narrow_circuit);
+    narrow_witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, 15, pa_data_hash,
+                                         knapsack_hash_hex(fi_overdue_loans, 15));
+    BOOST_CHECK(narrow_witness.is_satisfied());
+    narrow_witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, 16, pa_data_hash,
+                                         knapsack_hash_hex(fi_overdue_loans, 16));
+    BOOST_CHECK(!narrow_witness.is_satisfied());
+}
+
+BOOST_AUTO_TEST_CASE(poseidon_matches_reference_and_circuit) {
+    // x5_255_3 test vector of the Poseidon reference implementation
+    poseidon_state state = {value_type(0), value_type(1), value_type(2)};
+    poseidon_permute(state);
+    BOOST_CHECK(state[0] == value_type(field_type::integral_type(
+                                "0x28ce19420fc246a05553ad1e8c98f5c9d67166be2c18e9e4cb4b4e317dd2a78a")));
+    BOOST_CHECK(state[1] == value_type(field_type::integral_type(
+                                "0x51f3e312c95343a896cfd8945ea82ba956c1118ce9b9859b6ea56637b4b1ddc4")));
+    BOOST_CHECK(state[2] == value_type(field_type::integral_type(
+                                "0x3b2b69139b235626a0bfb56c9527ae66a7bf486ad8c11c14d1da0c69bbe0f79a")));
+
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+    const multiscore_widths widths = multiscore_widths::poseidon();
+    const std::string pa_data_hash = field_element_to_hex(multiscore_commitment_hash(widths, pa_id, pa_income));
+    const std::string fi_data_hash =
+        field_element_to_hex(multiscore_commitment_hash(widths, fi_overdue_loans, fi_account_age));
+
+    blueprint<field_type> bp;
+    multiscore<field_type> component(bp, widths);
+    component.verbose = false;
+    component.generate_r1cs_constraints();
+    component.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(bp.is_satisfied());
+
+    multiscore_circuit<field_type> circuit(widths);
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age, pa_data_hash, fi_data_hash);
+    BOOST_CHECK(witness.is_satisfied());
+    BOOST_CHECK(witness.primary_input() == bp.primary_input());
+    BOOST_CHECK(witness.assignment == bp.full_variable_assignment());
+
+    // Knapsack commitments do not open a Poseidon circuit
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  knapsack_hash_hex(pa_id, pa_income), fi_data_hash);
+    BOOST_CHECK(!witness.is_satisfied());
+}
+
+BOOST_AUTO_TEST_CASE(packed_public_input_matches_verifier) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+    multiscore_widths widths = multiscore_widths::poseidon();
+    widths.packed_inputs = true;
+    const value_type pa_hash = multiscore_commitment_hash(widths, pa_id, pa_income);
+    const value_type fi_hash = multiscore_commitment_hash(widths, fi_overdue_loans, fi_account_age);
+
+    blueprint<field_type> bp;
+    multiscore<field_type> component(bp, widths);
+    component.verbose = false;
+    component.generate_r1cs_constraints();
+    component.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                    field_element_to_hex(pa_hash), field_element_to_hex(fi_hash));
+    BOOST_CHECK(bp.is_satisfied());
+
+    const multiscore_circuit<field_type> circuit(widths);
+    BOOST_CHECK_EQUAL(circuit.layout.num_inputs, 1);
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  field_element_to_hex(pa_hash), field_element_to_hex(fi_hash));
+    BOOST_CHECK(witness.is_satisfied());
+    BOOST_CHECK(witness.assignment == bp.full_variable_assignment());
+
+    // The verifier recomputes the one public input from the values it expects
+    BOOST_CHECK(witness.primary_input() == packed_public_input(scoring_policy(), pa_hash, fi_hash));
+    scoring_policy other;
+    other.score_min = 1;
+    BOOST_CHECK(witness.primary_input() != packed_public_input(other, pa_hash, fi_hash));
+    BOOST_CHECK(witness.primary_input() != packed_public_input(scoring_policy(), fi_hash, pa_hash));
+    BOOST_CHECK(!primary_input_has_policy(circuit.layout, witness.primary_input(), scoring_policy()));
+
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system);
+    BOOST_CHECK_EQUAL(keypair.second.gamma_ABC_g1.domain_size(), 1);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+    const scheme_type::proof_type proof =
+        groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input());
+    const prepared_verification_key prepared = prepare_verification_key(keypair.second);
+    BOOST_CHECK(verify_proof(prepared, packed_public_input(scoring_policy(), pa_hash, fi_hash), proof));
+    BOOST_CHECK(!verify_proof(prepared, packed_public_input(other, pa_hash, fi_hash), proof));
+}
+
+BOOST_AUTO_TEST_CASE(scoring_circuit_specializes_attribute_lists) {
+    // multiscore as a spec scores and commits like the poseidon circuit
+    const scoring_witness<multiscore_spec>::attribute_values applicant = {123, 20000, 2, 3};
+    const scoring_circuit<multiscore_spec> circuit;
+    scoring_witness<multiscore_spec> witness(circuit);
+    scoring_weights<3> policy;
+    policy.score_base = 100000;
+    policy.score_min = 70000;
+    policy.weights = {1, 10000, 5000};
+
+    const std::array<value_type, 2> hashes = {scoring_commitment<multiscore_spec, 0>(applicant),
+                                              scoring_commitment<multiscore_spec, 1>(applicant)};
+    BOOST_CHECK(hashes[0] == multiscore_commitment_hash(multiscore_widths::poseidon(), 123, 20000));
+    BOOST_CHECK(hashes[1] == multiscore_commitment_hash(multiscore_widths::poseidon(), 2, 3));
+    witness.generate_r1cs_witness(applicant, hashes, policy);
+    BOOST_CHECK(witness.is_satisfied());
+    BOOST_CHECK(witness.score == scoring_policy().score(20000, 2, 3));
+    BOOST_CHECK_EQUAL(multiscore_spec::num_inputs, 10);
+
+    witness.generate_r1cs_witness({123, 20000, 9, 3}, hashes, policy);
+    BOOST_CHECK(!witness.is_satisfied());
+
+    // Six attributes, one of them only committed, hashed in two groups of three, in one proof
+    typedef scoring_spec<50,
+                         attribute_list<scoring_attribute<32>,
+                                        scoring_attribute<32, scoring_term::linear>,
+                                        scoring_attribute<8, scoring_term::quadratic, true>,
+                                        scoring_attribute<16, scoring_term::linear>,
+                                        scoring_attribute<16, scoring_term::quadratic>,
+                                        scoring_attribute<16, scoring_term::linear, true>>,
+                         commitment_groups<commitment_group<0, 1, 4>, commitment_group<2, 3, 5>>>
+        extended_spec;
+    BOOST_CHECK_EQUAL(extended_spec::num_weights, 5);
+
+    const scoring_witness<extended_spec>::attribute_values extended = {7, 20000, 2, 3, 10, 4};
+    const std::array<value_type, 2> extended_hashes = {scoring_commitment<extended_spec, 0>(extended),
+                                                       scoring_commitment<extended_spec, 1>(extended)};
+    BOOST_CHECK(extended_hashes[0] == poseidon_hash(poseidon_hash(value_type(7), value_type(20000)), value_type(10)));
+    scoring_weights<5> extended_policy;
+    extended_policy.score_base = 100000;
+    extended_policy.score_min = 90000;
+    extended_policy.weights = {1, 10000, 5000, 100, 2000};
+    std::string error;
+    BOOST_CHECK(extended_policy.validate(error));
+
+    const scoring_circuit<extended_spec> extended_circuit;
+    scoring_witness<extended_spec> extended_witness(extended_circuit);
+    extended_witness.generate_r1cs_witness(extended, extended_hashes, extended_policy);
+    BOOST_CHECK(extended_witness.is_satisfied());
+    BOOST_CHECK(extended_witness.score == 100000 + 20000 - 4 * 10000 + 3 * 5000 + 100 * 100 - 4 * 2000);
+
+    scheme_type::keypair_type keypair = groth16_setup(extended_circuit.constraint_system);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+    const scheme_type::proof_type proof = groth16_prove(key, extended_circuit.constraint_system,
+                                                        extended_witness.primary_input(),
+                                                        extended_witness.auxiliary_input());
+    const prepared_verification_key prepared = prepare_verification_key(keypair.second);
+    BOOST_CHECK(verify_proof(prepared, extended_witness.primary_input(), proof));
+
+    // A score below the threshold, or a hash the provider did not publish, has no witness
+    extended_policy.score_min = 100000;
+    extended_witness.generate_r1cs_witness(extended, extended_hashes, extended_policy);
+    BOOST_CHECK(!extended_witness.is_satisfied());
+    extended_policy.score_min = 90000;
+    extended_witness.generate_r1cs_witness(extended, {extended_hashes[1], extended_hashes[0]}, extended_policy);
+    BOOST_CHECK(!extended_witness.is_satisfied());
+}
+
+BOOST_AUTO_TEST_CASE(applicant_evaluation_matches_circuit) {
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    multiscore_witness<field_type> witness(circuit);
+    scoring_policy policy;
+
+    auto applicant = [](uint pa_id, uint pa_income, uint fi_overdue_loans, uint fi_account_age) {
+        applicant_record record;
+        record.pa_id = pa_id;
+        record.pa_income = pa_income;
+        record.fi_overdue_loans = fi_overdue_loans;
+        record.fi_account_age = fi_account_age;
+        record.pa_data_hash = knapsack_hash_hex(pa_id, pa_income);
+        record.fi_data_hash = knapsack_hash_hex(fi_overdue_loans, fi_account_age);
+        return record;
+    };
+    applicant_record low_score = applicant(123, 20000, 9, 3);
+    applicant_record wrong_pa_hash = applicant(123, 20000, 2, 3);
+    wrong_pa_hash.pa_data_hash = knapsack_hash_hex(124, 20000);
+    applicant_record wrong_fi_hash = applicant(123, 20000, 2, 3);
+    wrong_fi_hash.fi_data_hash = knapsack_hash_hex(2, 4);
+    applicant_record at_threshold = applicant(123, 0, 3, 0);
+    policy.score_min = 10000;
+
+    for (const applicant_record &record :
+         {applicant(123, 20000, 2, 3), low_score, wrong_pa_hash, wrong_fi_hash, at_threshold}) {
+        std::string reason;
+        const bool eligible = evaluate_applicant(record, policy, circuit.widths, reason);
+        witness.generate_r1cs_witness(record.pa_id, record.pa_income, record.fi_overdue_loans,
+                                      record.fi_account_age, record.pa_data_hash, record.fi_data_hash, policy);
+        BOOST_CHECK_EQUAL(eligible, witness.is_satisfied());
+        BOOST_CHECK_EQUAL(eligible, reason.empty());
+    }
+
+    std::string reason;
+    policy.score_min = 70000;
+    BOOST_CHECK(!evaluate_applicant(low_score, policy, circuit.widths, reason));
+    BOOST_CHECK_EQUAL(reason, "score -675000 is below score_min 70000");
+    BOOST_CHECK(!evaluate_applicant(wrong_fi_hash, policy, circuit.widths, reason));
+    BOOST_CHECK_EQUAL(reason, "FI data hash does not match overdue loans and account age");
+
+    applicant_record malformed = applicant(123, 20000, 2, 3);
+    malformed.pa_data_hash.pop_back();
+    BOOST_CHECK(!evaluate_applicant(malformed, policy, circuit.widths, reason));
+    BOOST_CHECK_THROW(hex_to_field_element(malformed.pa_data_hash), std::invalid_argument);
+    BOOST_CHECK_THROW(hex_to_field_element(knapsack_hash_hex(123, 20000) + "00"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(applicant_records_are_range_checked) {
+    const std::string hashes = "," + knapsack_hash_hex(1, 2) + "," + knapsack_hash_hex(3, 4);
+    applicant_record applicant;
+    BOOST_CHECK(parse_applicant_csv("123, 20000, 2, 3" + hashes, applicant));
+    BOOST_CHECK_EQUAL(applicant.pa_income, 20000);
+    BOOST_CHECK(parse_applicant_csv("4294967295,0,0,0" + hashes, applicant));
+    BOOST_CHECK(!parse_applicant_csv("4294967296,0,0,0" + hashes, applicant));
+    BOOST_CHECK(!parse_applicant_csv("123,-1,0,0" + hashes, applicant));
+    BOOST_CHECK(!parse_applicant_csv("123,+1,0,0" + hashes, applicant));
+    BOOST_CHECK(!parse_applicant_csv("123,1x,0,0" + hashes, applicant));
+
+    BOOST_CHECK(parse_applicant_json(
+        "{\"id\": 123, \"income\": 20000, \"overdue_loans\": 2, \"account_age\": 3, \"pa_data_hash\": \"a\", "
+        "\"fi_data_hash\": \"b\"}",
+        applicant));
+    BOOST_CHECK(!parse_applicant_json(
+        "{\"id\": 123, \"income\": -1, \"overdue_loans\": 2, \"account_age\": 3, \"pa_data_hash\": \"a\", "
+        "\"fi_data_hash\": \"b\"}",
+        applicant));
+}
+
+BOOST_AUTO_TEST_CASE(commitment_table_matches_knapsack) {
+    const knapsack_commitment_table table;
+    const std::vector<std::pair<uint, uint>> pairs = {
+        {0, 0}, {123, 20000}, {2, 3}, {0xffffffff, 1}, {0x80000000, 0xffffffff}, {0x01020304, 0xa0b0c0d0}};
+    for (const auto &pair : pairs) {
+        BOOST_CHECK_EQUAL(field_element_to_hex(table(pair.first, pair.second)), knapsack_hash_hex(pair.first, pair.second));
+    }
+
+    std::string reference;
+    uint left, right;
+    BOOST_CHECK(parse_commitment_record("cust-1, 123,20000\r", reference, left, right));
+    BOOST_CHECK_EQUAL(reference, "cust-1");
+    BOOST_CHECK_EQUAL(left, 123);
+    BOOST_CHECK_EQUAL(right, 20000);
+    BOOST_CHECK(!parse_commitment_record("reference,id,income", reference, left, right));
+    BOOST_CHECK(!parse_commitment_record("cust-1,123,4294967296", reference, left, right));
+}
+
+BOOST_AUTO_TEST_CASE(linear_constraints_are_eliminated) {
+    // x1 is the primary input: x2 * x2 = x3, 1 * (x3 + x1) = x4, x4 * x2 = 18
+    const variable<field_type> x1(1), x2(2), x3(3), x4(4);
+    r1cs_constraint_system<field_type> constraint_system;
+    constraint_system.primary_input_size = 1;
+    constraint_system.auxiliary_input_size = 3;
+    constraint_system.add_constraint(r1cs_constraint<field_type>(x2, x2, x3));
+    constraint_system.add_constraint(r1cs_constraint<field_type>(1, x3 + x1, x4));
+    constraint_system.add_constraint(r1cs_constraint<field_type>(x4, x2, 18));
+
+    const r1cs_variable_assignment<field_type> assignment = {5, 2, 4, 9};
+    BOOST_CHECK(constraint_system.is_satisfied({5}, {2, 4, 9}));
+
+    const r1cs_reduction<field_type> reduction = eliminate_linear_constraints(constraint_system);
+    BOOST_CHECK_EQUAL(reduction.eliminated_constraints, 1);
+    BOOST_CHECK_EQUAL(reduction.eliminated_variables, 1);
+    BOOST_CHECK_EQUAL(constraint_system.num_constraints(), 2);
+    BOOST_CHECK_EQUAL(constraint_system.num_variables(), 3);
+    BOOST_CHECK(constraint_system.is_satisfied({5}, reduction.reduce(assignment)));
+    BOOST_CHECK(!constraint_system.is_satisfied({5}, reduction.reduce(r1cs_variable_assignment<field_type> {5, 3, 9, 14})));
+
+    const multiscore_circuit<field_type> circuit(multiscore_widths::compact());
+    BOOST_CHECK_GT(circuit.reduction.eliminated_constraints, 0);
+    BOOST_CHECK_LT(circuit.constraint_system.num_variables(), circuit.layout.num_variables);
+}
+
+BOOST_AUTO_TEST_CASE(circuit_digest_identifies_keys) {
+    const std::string digest = circuit_digest(compiled_circuit().constraint_system);
+    BOOST_CHECK_EQUAL(digest.size(), 64);
+    BOOST_CHECK_EQUAL(digest, compiled_circuit_digest());
+    BOOST_CHECK_EQUAL(digest, circuit_digest(multiscore_circuit<field_type>(circuit_widths).constraint_system));
+    BOOST_CHECK_NE(digest, circuit_digest(multiscore_circuit<field_type>(multiscore_widths::wide()).constraint_system));
+
+    r1cs_constraint_system<field_type> changed = compiled_circuit().constraint_system;
+    changed.constraints.back().c.add_term(variable<field_type>(1), 1);
+    BOOST_CHECK_NE(digest, circuit_digest(changed));
+
+    const boost::filesystem::path key_path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("digest-%%%%-%%%%.key");
+    BOOST_REQUIRE(writefile(key_path, std::vector<unit_type> {1, 2, 3}));
+    BOOST_CHECK(!check_key_digest(key_path, "Proving key"));
+    BOOST_REQUIRE(write_key_digest(key_path));
+    BOOST_CHECK(check_key_digest(key_path, "Proving key"));
+
+    // The digest file only vouches for the key bytes it was written for
+    BOOST_REQUIRE(writefile(key_path, std::vector<unit_type> {1, 2, 4}));
+    BOOST_CHECK(!check_key_digest(key_path, "Proving key"));
+    {
+        boost::filesystem::ofstream stream(key_digest_path(key_path));
+        stream << circuit_digest(changed) << " " << key_bytes_digest(key_path) << std::endl;
+    }
+    BOOST_CHECK(!check_key_digest(key_path, "Proving key"));
+    boost::filesystem::remove(key_digest_path(key_path));
+    boost::filesystem::remove(key_path);
+}
+
+BOOST_AUTO_TEST_CASE(proof_archive_finds_latest_proof) {
+    const boost::filesystem::path archive_path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("archive-%%%%-%%%%");
+    const scheme_type::proof_type first(g1_value_type::one(), g2_value_type::one(), g1_value_type::one());
+    const scheme_type::proof_type second(g1_value_type::one().doubled(), g2_value_type::one(), g1_value_type::one());
+
+    {
+        proof_archive_writer archive;
+        BOOST_REQUIRE(archive.open(archive_path));
+        proof_archive_writer competing;
+        BOOST_CHECK(!competing.open(archive_path));
+        BOOST_CHECK(archive.append(7, first, {value_type(1), value_type(2)}));
+        BOOST_CHECK(archive.append(8, first, {value_type(3)}));
+        BOOST_CHECK(archive.append(7, second, {value_type(4)}));
+        BOOST_CHECK(archive.close());
+        BOOST_CHECK_EQUAL(archive.written(), 3);
+        BOOST_CHECK(!archive.append(9, first, {value_type(5)}));
+    }
+
+    proof_archive_reader reader;
+    archived_proof proof;
+    std::string error;
+    BOOST_REQUIRE(reader.open(archive_path, error));
+    BOOST_CHECK_EQUAL(reader.size(), 3);
+    BOOST_REQUIRE(reader.find(7, proof, error));
+    BOOST_CHECK(proof.proof == proof_to_byteblob(second));
+    BOOST_CHECK(proof.primary_input == primary_input_to_byteblob({value_type(4)}));
+    BOOST_CHECK(boost::iequals(proof.circuit_digest, compiled_circuit_digest()));
+    BOOST_REQUIRE(reader.find(8, proof, error));
+    BOOST_CHECK(proof.primary_input == primary_input_to_byteblob({value_type(3)}));
+    BOOST_CHECK(!reader.find(9, proof, error));
+
+    boost::filesystem::remove(archive_path);
+    boost::filesystem::remove(proof_archive_index_path(archive_path));
+}
+
+BOOST_AUTO_TEST_CASE(radix2_quotient_matches_r1cs_to_qap) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    const r1cs_constraint_system<field_type> &constraint_system = circuit.constraint_system;
+    const std::size_t domain_size = constraint_system.num_constraints() + constraint_system.num_inputs() + 1;
+    BOOST_REQUIRE(radix2_domain::is_supported(domain_size));
+
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  knapsack_hash_hex(pa_id, pa_income),
+                                  knapsack_hash_hex(fi_overdue_loans, fi_account_age));
+
+    const std::vector<value_type> expected =
+        reductions::r1cs_to_qap<field_type>::witness_map(constraint_system, witness.primary_input(),
+                                                         witness.auxiliary_input(), value_type::zero(),
+                                                         value_type::zero(), value_type::zero())
+            .coefficients_for_H;
+
+    std::vector<value_type> coefficients;
+    for (std::size_t threads : {1, 4}) {
+        groth16_quotient(constraint_system, witness.primary_input(), witness.auxiliary_input(), domain_size,
+                         coefficients, threads);
+        BOOST_REQUIRE_EQUAL(coefficients.size(), domain_size);
+        BOOST_CHECK(std::equal(coefficients.begin(), coefficients.end() - 1, expected.begin()));
+    }
+
+    // Forward and inverse transforms round trip, also across the cache blocks
+    const std::shared_ptr<const radix2_domain> domain = radix2_domain::get(radix2_domain::cache_block * 4);
+    std::vector<value_type> values(domain->size);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = value_type(i * i + 1);
+    }
+    std::vector<value_type> transformed = values;
+    domain->coset_fft(transformed);
+    domain->icoset_fft(transformed);
+    BOOST_CHECK(transformed == values);
+}
+
+BOOST_AUTO_TEST_CASE(native_prover_proof_verifies) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    scheme_type::keypair_type keypair = generate<scheme_type>(circuit.constraint_system);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  knapsack_hash_hex(pa_id, pa_income),
+                                  knapsack_hash_hex(fi_overdue_loans, fi_account_age));
+    BOOST_REQUIRE(witness.is_satisfied());
+
+    for (std::size_t threads : {1, 3, 8}) {
+        scheme_type::proof_type proof = groth16_prove(key, circuit.constraint_system, witness.primary_input(),
+                                                      witness.auxiliary_input(), threads);
+        BOOST_CHECK(verify<scheme_type>(keypair.second, witness.primary_input(), proof));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(streamed_proving_key_proof_verifies) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system);
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  knapsack_hash_hex(pa_id, pa_income),
+                                  knapsack_hash_hex(fi_overdue_loans, fi_account_age));
+
+    const std::size_t buffer_bytes =
+        groth16_proof_buffer_bytes(circuit.constraint_system.num_variables(), keypair.first.H_query.size(),
+                                   keypair.first.B_query.indices.size());
+    BOOST_CHECK_EQUAL(groth16_stream_chunk_points(buffer_bytes, buffer_bytes, false, 1), 0);
+    BOOST_CHECK_GT(groth16_stream_chunk_points(buffer_bytes + (64 << 20), buffer_bytes, true, 4), 1024);
+
+    const boost::filesystem::path path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("stream-%%%%-%%%%.key");
+    for (bool compressed : {false, true}) {
+        BOOST_REQUIRE(write_proving_key_file(path, keypair.first, compressed, compiled_circuit_digest()));
+        BOOST_CHECK_EQUAL(proving_key_file_digest(path), compiled_circuit_digest());
+        auto reader = std::make_shared<proving_key_file_reader>();
+        std::string error;
+        BOOST_REQUIRE(reader->open(path, error));
+        BOOST_CHECK(reader->matches(circuit.constraint_system));
+
+        // Chunks far smaller than every query, so each multiplication spans several of them
+        groth16_proving_key key;
+        BOOST_REQUIRE(groth16_proving_key::from_stream(reader, 1024, key));
+        BOOST_CHECK(key.streamed());
+        BOOST_CHECK_GT(key.A_query.size, 1024);
+        const scheme_type::proof_type proof =
+            groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input(), 3);
+        BOOST_CHECK(verify<scheme_type>(keypair.second, witness.primary_input(), proof));
+    }
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_setup_keys_verify) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+
+    const g1_value_type base = g1_value_type::one();
+    const fixed_base_table<g1_value_type> table(base, 5, 3);
+    for (const value_type scalar : {value_type::zero(), value_type(31), value_type(32), value_type(-1)}) {
+        BOOST_CHECK(table.multiply(scalar) == scalar * base);
+    }
+
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system, false, 4);
+    BOOST_CHECK_EQUAL(keypair.first.H_query.size() + 1,
+                      circuit.constraint_system.num_constraints() + circuit.constraint_system.num_inputs() + 1);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  knapsack_hash_hex(pa_id, pa_income),
+                                  knapsack_hash_hex(fi_overdue_loans, fi_account_age));
+    scheme_type::proof_type proof =
+        groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input());
+    BOOST_CHECK(verify<scheme_type>(keypair.second, witness.primary_input(), proof));
+    BOOST_CHECK(verify_proof(prepare_verification_key(keypair.second), witness.primary_input(), proof));
+}
+
+BOOST_AUTO_TEST_CASE(vergrth16_payload_preflight) {
+    const uint pa_id = 123, pa_income = 20000, fi_overdue_loans = 2, fi_account_age = 3;
+
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+
+    multiscore_witness<field_type> witness(circuit);
+    witness.generate_r1cs_witness(pa_id, pa_income, fi_overdue_loans, fi_account_age,
+                                  knapsack_hash_hex(pa_id, pa_income),
+                                  knapsack_hash_hex(fi_overdue_loans, fi_account_age));
+    const scheme_type::proof_type proof =
+        groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input());
+
+    const std::vector<unit_type> verification_key_byteblob = verification_key_to_byteblob(keypair.second);
+    const std::vector<unit_type> payload = vergrth16_payload(
+        proof_to_byteblob(proof), primary_input_to_byteblob(witness.primary_input()), verification_key_byteblob);
+
+    vergrth16_parts parts;
+    std::string error;
+    BOOST_REQUIRE(split_vergrth16_payload(payload, parts, error));
+    BOOST_CHECK(parts.primary_input == witness.primary_input());
+    BOOST_CHECK(parts.verification_key_byteblob == verification_key_byteblob);
+
+    std::vector<unit_type> trailing = payload;
+    trailing.push_back(0);
+    BOOST_CHECK(!split_vergrth16_payload(trailing, parts, error));
+
+    // A different public score threshold in the same payload must not pass
+    r1cs_primary_input<field_type> forged = witness.primary_input();
+    forged[circuit.layout.score_min - 1] = value_type(1);
+    const std::vector<unit_type> forged_payload =
+        vergrth16_payload(proof_to_byteblob(proof), primary_input_to_byteblob(forged), verification_key_byteblob);
+
+    // A payload valid under its own key fails unless that key is the deployed one
+    scheme_type::keypair_type other_keypair = groth16_setup(circuit.constraint_system);
+    typename scheme_type::proving_key_type other_proving_key = other_keypair.first;
+    groth16_proving_key other_key = groth16_proving_key::from_proving_key(std::move(other_proving_key));
+    const std::vector<unit_type> other_payload = vergrth16_payload(
+        proof_to_byteblob(
+            groth16_prove(other_key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input())),
+        primary_input_to_byteblob(witness.primary_input()), verification_key_to_byteblob(other_keypair.second));
+
+    prepared_key_cache keys;
+    const std::vector<verification_item> items = preflight_payloads(
+        {payload, forged_payload, trailing, payload, other_payload}, {"a", "b", "c", "d", "e"},
+        verification_key_byteblob, keys);
+    BOOST_CHECK(items[0].valid);
+    BOOST_CHECK(!items[1].valid);
+    BOOST_CHECK(!items[2].valid && !items[2].loaded);
+    BOOST_CHECK(items[3].valid);
+    BOOST_CHECK(!items[4].valid && !items[4].loaded);
+}
+
+BOOST_AUTO_TEST_CASE(batch_verification_finds_invalid_proof) {
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+    const prepared_verification_key prepared = prepare_verification_key(keypair.second);
+
+    std::vector<verification_item> items;
+    multiscore_witness<field_type> witness(circuit);
+    for (uint income : {20000, 30000, 40000, 50000, 60000}) {
+        witness.generate_r1cs_witness(123, income, 2, 3, knapsack_hash_hex(123, income), knapsack_hash_hex(2, 3));
+        verification_item item;
+        item.name = std::to_string(income);
+        item.proof = groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input());
+        item.primary_input = witness.primary_input();
+        item.accumulated_input = accumulate_primary_input(keypair.second, item.primary_input);
+        item.loaded = true;
+        items.push_back(item);
+    }
+    std::vector<verification_item *> pointers;
+    for (verification_item &item : items) {
+        pointers.push_back(&item);
+    }
+    BOOST_CHECK(verify_batch_range(prepared, pointers, 0, pointers.size()));
+    find_invalid_proofs(prepared, pointers, 0, pointers.size());
+    for (const verification_item &item : items) {
+        BOOST_CHECK(item.valid);
+    }
+
+    // The proof of another applicant fails the batch, and bisection finds exactly that one
+    items[3].proof = items[0].proof;
+    for (verification_item &item : items) {
+        item.valid = false;
+    }
+    BOOST_CHECK(!verify_batch_range(prepared, pointers, 0, pointers.size()));
+    find_invalid_proofs(prepared, pointers, 0, pointers.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        BOOST_CHECK_EQUAL(items[i].valid, i != 3);
+    }
+    BOOST_CHECK_EQUAL(items[3].reason, "proof does not verify");
+}
+
+BOOST_AUTO_TEST_CASE(aggregated_proofs_verify) {
+    const multiscore_circuit<field_type> &circuit = compiled_circuit();
+    scheme_type::keypair_type keypair = groth16_setup(circuit.constraint_system);
+    typename scheme_type::proving_key_type proving_key = keypair.first;
+    groth16_proving_key key = groth16_proving_key::from_proving_key(std::move(proving_key));
+    const prepared_verification_key prepared = prepare_verification_key(keypair.second);
+
+    // Three applicants, padded to four proofs
+    std::vector<typename scheme_type::proof_type> proofs;
+    std::vector<typename scheme_type::primary_input_type> primary_inputs;
+    multiscore_witness<field_type> witness(circuit);
+    for (uint income : {20000, 30000, 40000}) {
+        witness.generate_r1cs_witness(123, income, 2, 3, knapsack_hash_hex(123, income), knapsack_hash_hex(2, 3));
+        proofs.push_back(
+            groth16_prove(key, circuit.constraint_system, witness.primary_input(), witness.auxiliary_input()));
+        primary_inputs.push_back(witness.primary_input());
+    }
+
+    const aggregation_srs srs = aggregation_setup(3);
+    BOOST_CHECK_EQUAL(srs.max_proofs(), 4);
+    const aggregation_verifier_srs verifier_srs = aggregation_verifier_key(srs);
+    aggregate_proof aggregate;
+    std::string error;
+    BOOST_REQUIRE(aggregate_proofs(srs, keypair.second, proofs, primary_inputs, aggregate, error));
+    BOOST_CHECK_EQUAL(aggregate.rounds.size(), 2);
+    BOOST_CHECK(verify_aggregate_proof(verifier_srs, prepared, primary_inputs, aggregate));
+
+    aggregate_proof decoded;
+    BOOST_REQUIRE(byteblob_to_aggregate_proof(aggregate_proof_to_byteblob(aggregate), decoded));
+    BOOST_CHECK(verify_aggregate_proof(verifier_srs, prepared, primary_inputs, decoded));
+
+    // Other primary inputs, another order or a tampered round do not verify
+    std::vector<typename scheme_type::primary_input_type> swapped = primary_inputs;
+    std::swap(swapped[0], swapped[1]);
+    BOOST_CHECK(!verify_aggregate_proof(verifier_srs, prepared, swapped, aggregate));
+    BOOST_CHECK(!verify_aggregate_proof(verifier_srs, prepared, {primary_inputs[0], primary_inputs[1]}, aggregate));
+    decoded.rounds[1].zc_left = decoded.rounds[1].zc_left + verifier_srs.g;
+    BOOST_CHECK(!verify_aggregate_proof(verifier_srs, prepared, primary_inputs, decoded));
+
+    // A commitment moved out of the GT subgroup is refused when decoding
+    std::vector<unit_type> malleated = aggregate_proof_to_byteblob(aggregate);
+    malleated[sizeof(aggregate_proof_header) + fp_bytes - 1] ^= 1;
+    BOOST_CHECK(!byteblob_to_aggregate_proof(malleated, decoded));
+
+    // An invalid proof makes the aggregate fail
+    proofs[2].g_C = proofs[2].g_C + verifier_srs.g;
+    BOOST_REQUIRE(aggregate_proofs(srs, keypair.second, proofs, primary_inputs, aggregate, error));
+    BOOST_CHECK(!verify_aggregate_proof(verifier_srs, prepared, primary_inputs, aggregate));
+
+    const std::vector<typename scheme_type::proof_type> too_many(5, proofs[0]);
+    BOOST_CHECK(!aggregate_proofs(srs, keypair.second, too_many,
+                                  std::vector<typename scheme_type::primary_input_type>(5, primary_inputs[0]),
+                                  aggregate, error));
+}
+
 BOOST_AUTO_TEST_SUITE_END()